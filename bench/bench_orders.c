@@ -0,0 +1,129 @@
+// Order processing benchmark: the per-order loop (orders_fulfill_next)
+// against orders_process_batch at several batch sizes, on identical
+// inventories and queues. Outcomes must match; stock is kept tight so a
+// share of the orders fail.
+//
+//   gcc -O2 -pthread -I. -o bench_orders bench/bench_orders.c orders.c inventory.c columns.c common.c wal.c
+//   ./bench_orders [products] [orders]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "inventory.h"
+#include "orders.h"
+
+#define BENCH_MAX_LINES 4
+
+typedef struct BenchResult {
+    long long fulfilled;
+    long long stockSum;
+    double seconds;
+} BenchResult;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Deterministic xorshift so every run sees the same workload
+static unsigned long long next_random(unsigned long long* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void sum_stock(Product* p, void* ctx) {
+    *(long long*)ctx += p->stock;
+}
+
+static void setup(int products, int orders, Inventory** invOut, OrdersQueue** qOut) {
+    Inventory* inv = inventory_create();
+    Product* list = (Product*)calloc((size_t)products, sizeof(Product));
+    for (int i = 0; i < products; i++) {
+        list[i].id = 1000 + (long long)i * 7;
+        snprintf(list[i].name, sizeof(list[i].name), "P%d", i);
+        strcpy(list[i].category, "bench");
+        list[i].price = 1.0;
+        list[i].stock = 3 * orders / products + 1;
+    }
+    inventory_bulk_load(inv, list, products);
+    free(list);
+
+    OrdersQueue* q = orders_create();
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    OrderItem items[BENCH_MAX_LINES];
+    for (int i = 0; i < orders; i++) {
+        Order o;
+        memset(&o, 0, sizeof(o));
+        o.id = i;
+        strcpy(o.customer, "bench");
+        o.numItems = 1 + (int)(next_random(&state) % BENCH_MAX_LINES);
+        o.items = items;
+        for (int k = 0; k < o.numItems; k++) {
+            // Distinct products per order so both paths see the same demand
+            int slot;
+            bool repeat;
+            do {
+                slot = (int)(next_random(&state) % (unsigned long long)products);
+                repeat = false;
+                for (int j = 0; j < k; j++) repeat |= items[j].productId == 1000 + (long long)slot * 7;
+            } while (repeat);
+            items[k].productId = 1000 + (long long)slot * 7;
+            items[k].quantity = 1 + (int)(next_random(&state) % 3);
+        }
+        orders_enqueue(q, o);
+    }
+    *invOut = inv;
+    *qOut = q;
+}
+
+static BenchResult run(int products, int orders, int batch) {
+    Inventory* inv;
+    OrdersQueue* q;
+    setup(products, orders, &inv, &q);
+
+    BenchResult r = {0, 0, 0};
+    double t0 = now_seconds();
+    if (batch == 0) {
+        OrderOutcome outcome;
+        while ((outcome = orders_fulfill_next(q, inv, NULL, NULL)) != ORDER_QUEUE_EMPTY) {
+            if (outcome == ORDER_FULFILLED) r.fulfilled++;
+        }
+    } else {
+        OrderBatchStats stats;
+        while (orders_process_batch(q, inv, batch, &stats) > 0) r.fulfilled += stats.fulfilled;
+    }
+    r.seconds = now_seconds() - t0;
+    inventory_for_each(inv, sum_stock, &r.stockSum);
+
+    orders_destroy(q);
+    inventory_destroy(inv);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int products = argc > 1 ? atoi(argv[1]) : 100000;
+    int orders = argc > 2 ? atoi(argv[2]) : 500000;
+    if (products <= BENCH_MAX_LINES || orders <= 0) {
+        fprintf(stderr, "usage: %s [products > %d] [orders > 0]\n", argv[0], BENCH_MAX_LINES);
+        return 1;
+    }
+    const int batches[] = { 0, 64, 256, 1024, 16384 };
+
+    printf("%-12s %12s %12s %14s\n", "batch", "fulfilled", "seconds", "orders/s");
+    BenchResult base = {0, 0, 0};
+    for (size_t i = 0; i < sizeof(batches) / sizeof(batches[0]); i++) {
+        BenchResult r = run(products, orders, batches[i]);
+        if (i == 0) base = r;
+        else if (r.fulfilled != base.fulfilled || r.stockSum != base.stockSum) {
+            fprintf(stderr, "Error: batch %d disagrees with the per-order loop\n", batches[i]);
+        }
+        char label[32];
+        if (batches[i] == 0) strcpy(label, "per-order");
+        else snprintf(label, sizeof(label), "%d", batches[i]);
+        printf("%-12s %12lld %12.3f %14.0f\n", label, r.fulfilled, r.seconds, orders / r.seconds);
+    }
+    return 0;
+}
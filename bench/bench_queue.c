@@ -0,0 +1,100 @@
+// Order intake benchmark: P producer threads enqueue into one OrdersQueue
+// while a single consumer drains it in batches, as an ingest pipeline
+// feeding the fulfillment loop would.
+//
+//   gcc -O2 -pthread -I. -o bench_queue bench/bench_queue.c orders.c inventory.c columns.c common.c wal.c
+//   ./bench_queue [ordersPerRun]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "orders.h"
+
+#define BENCH_MAX_PRODUCERS 16
+#define BENCH_DRAIN_BATCH 256
+
+typedef struct Producer {
+    OrdersQueue* q;
+    int first;
+    int count;
+    pthread_barrier_t* start;
+} Producer;
+
+typedef struct Consumer {
+    OrdersQueue* q;
+    long long expected;
+    long long checksum;
+} Consumer;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* produce(void* arg) {
+    Producer* p = (Producer*)arg;
+    OrderItem item = { 0, 1 };
+    Order o;
+    memset(&o, 0, sizeof(o));
+    strcpy(o.customer, "bench");
+    o.numItems = 1;
+    o.items = &item;
+    pthread_barrier_wait(p->start);
+    for (int i = 0; i < p->count; i++) {
+        o.id = p->first + i;
+        item.productId = o.id;
+        orders_enqueue(p->q, o);
+    }
+    return NULL;
+}
+
+static void* consume(void* arg) {
+    Consumer* c = (Consumer*)arg;
+    static Order batch[BENCH_DRAIN_BATCH];
+    long long seen = 0;
+    while (seen < c->expected) {
+        int n = orders_dequeue_batch(c->q, batch, BENCH_DRAIN_BATCH);
+        for (int i = 0; i < n; i++) c->checksum += batch[i].id;
+        seen += n;
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int total = argc > 1 ? atoi(argv[1]) : 2000000;
+    if (total <= 0) total = 2000000;
+
+    printf("%-10s %12s %14s %14s\n", "producers", "orders", "enqueue/s", "end-to-end/s");
+    for (int producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2) {
+        OrdersQueue* q = orders_create();
+        Producer p[BENCH_MAX_PRODUCERS];
+        pthread_t threads[BENCH_MAX_PRODUCERS], consumer;
+        pthread_barrier_t start;
+        pthread_barrier_init(&start, NULL, (unsigned)producers + 1);
+
+        int per = total / producers;
+        Consumer c = { q, (long long)per * producers, 0 };
+        pthread_create(&consumer, NULL, consume, &c);
+        for (int i = 0; i < producers; i++) {
+            p[i] = (Producer){ q, i * per, per, &start };
+            pthread_create(&threads[i], NULL, produce, &p[i]);
+        }
+
+        pthread_barrier_wait(&start);
+        double t0 = now_seconds();
+        for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+        double produced = now_seconds() - t0;
+        pthread_join(consumer, NULL);
+        double drained = now_seconds() - t0;
+
+        long long n = c.expected;
+        if (c.checksum != n * (n - 1) / 2) fprintf(stderr, "Error: lost or duplicated orders\n");
+        printf("%-10d %12lld %14.0f %14.0f\n", producers, n, n / produced, n / drained);
+
+        pthread_barrier_destroy(&start);
+        orders_destroy(q);
+    }
+    return 0;
+}
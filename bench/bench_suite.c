@@ -0,0 +1,404 @@
+// Benchmark suite: a seeded synthetic workload of products, suppliers and
+// orders, driven through the public module APIs one call at a time. Each
+// benchmark reports throughput and per-call latency percentiles as JSON
+// on stdout, so runs can be diffed across commits. Functions that print
+// (order processing, search, low-stock alerts) write to /dev/null while
+// they are measured.
+//
+//   make bench [BENCH_SCALE=1k,100k] [BENCH_SEED=42]
+//   ./bench_suite [--scale 1k|100k|1m|10m[,...]] [--seed n] [--ops n]
+//                 [--search-ops n] [--label text]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "inventory.h"
+#include "orders.h"
+#include "search.h"
+#include "suppliers.h"
+
+#define BENCH_DEFAULT_SCALE 100000LL
+#define BENCH_DEFAULT_OPS 1000000LL  // Cap on calls per point-lookup benchmark
+#define BENCH_DEFAULT_SEARCH_OPS 20
+#define BENCH_ALERT_OPS 1000
+#define BENCH_MAX_SCALES 8
+#define BENCH_CATEGORIES 32
+#define BENCH_MAX_LINES 4
+
+// Workload shape at one scale; every record is a pure function of seed
+// and index, so nothing needs to be kept in memory
+typedef struct Workload {
+    unsigned long long seed;
+    long long products;
+    long long suppliers;
+    long long ops;
+    int searchOps;
+} Workload;
+
+// Per-call latencies of one benchmark
+typedef struct Recorder {
+    uint32_t* ns;
+    long long count;
+    long long capacity;
+    uint64_t total;  // Sum of the samples; setup between calls is excluded
+} Recorder;
+
+static const char* SYLLABLES[] = {
+    "al", "be", "cor", "dan", "ex", "fi", "gar", "hol", "in", "jet",
+    "ka", "lum", "mor", "nex", "or", "pro", "qua", "ros", "sil", "tor",
+};
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: a well-mixed value for any (seed, stream, index)
+static unsigned long long mix(unsigned long long seed, unsigned long long stream, unsigned long long i) {
+    unsigned long long z = seed + stream * 0xD1B54A32D192ED03ULL + (i + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Sequential generator for the random parts of the benchmark loops
+static unsigned long long next_random(unsigned long long* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Sparse SKUs in scrambled order: multiplying by an odd constant is a
+// bijection on 32 bits, so ids are distinct for any index below 2^32
+static ProductId product_id(long long i) {
+    return 1 + (ProductId)(((unsigned long long)i * 2654435761ULL) & 0xFFFFFFFFULL);
+}
+
+static void make_product(const Workload* w, long long i, Product* p) {
+    unsigned long long r = mix(w->seed, 1, (unsigned long long)i);
+    memset(p, 0, sizeof(Product));
+    p->id = product_id(i);
+    int len = 0;
+    int syllables = 2 + (int)(r % 3);
+    for (int k = 0; k < syllables; k++) {
+        len += snprintf(p->name + len, sizeof(p->name) - (size_t)len, "%s",
+                        SYLLABLES[(r >> (8 + 5 * k)) % (sizeof(SYLLABLES) / sizeof(SYLLABLES[0]))]);
+    }
+    snprintf(p->name + len, sizeof(p->name) - (size_t)len, " %04u", (unsigned)((r >> 32) % 10000));
+    snprintf(p->category, sizeof(p->category), "cat%02u", (unsigned)((r >> 44) % BENCH_CATEGORIES));
+    p->supplierId = 1 + (int)((r >> 20) % (unsigned long long)w->suppliers);
+    p->price = 1.0 + (double)((r >> 24) % 100000) / 100.0;
+    p->stock = (int)((r >> 50) % 200);
+}
+
+static void make_supplier(const Workload* w, long long i, Supplier* s) {
+    memset(s, 0, sizeof(Supplier));
+    s->id = (int)(i + 1);
+    snprintf(s->name, sizeof(s->name), "supplier%lld", i + 1);
+    double* ratings[] = { &s->ratings.quality, &s->ratings.deliveryTime, &s->ratings.price,
+                          &s->ratings.reliability, &s->ratings.customerService };
+    for (int k = 0; k < 5; k++) {
+        *ratings[k] = (double)(mix(w->seed, 2 + (unsigned long long)k, (unsigned long long)i) % 1001) / 100.0;
+    }
+}
+
+// One to BENCH_MAX_LINES lines on existing products; items must hold that many
+static void make_order(const Workload* w, long long i, Order* o, OrderItem* items) {
+    unsigned long long r = mix(w->seed, 7, (unsigned long long)i);
+    memset(o, 0, sizeof(Order));
+    o->id = (int)i;
+    snprintf(o->customer, sizeof(o->customer), "customer%u", (unsigned)(r % 1000));
+    o->numItems = 1 + (int)((r >> 10) % BENCH_MAX_LINES);
+    o->items = items;
+    for (int k = 0; k < o->numItems; k++) {
+        unsigned long long line = mix(w->seed, 8 + (unsigned long long)k, (unsigned long long)i);
+        items[k].productId = product_id((long long)(line % (unsigned long long)w->products));
+        items[k].quantity = 1 + (int)((line >> 40) % 3);
+    }
+}
+
+static bool recorder_init(Recorder* rec, long long capacity) {
+    memset(rec, 0, sizeof(Recorder));
+    rec->ns = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)(capacity > 0 ? capacity : 1));
+    rec->capacity = capacity;
+    return rec->ns != NULL;
+}
+
+static void record(Recorder* rec, uint64_t begin) {
+    uint64_t ns = clock_ns() - begin;
+    rec->total += ns;
+    if (rec->count < rec->capacity) rec->ns[rec->count++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+static int compare_ns(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t* sorted, long long count, double p) {
+    if (count == 0) return 0;
+    long long rank = (long long)(p * (double)count + 0.999999);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+// Emit one benchmark object and release the samples
+static void report(FILE* json, Recorder* rec, const char* name, bool first) {
+    qsort(rec->ns, (size_t)rec->count, sizeof(uint32_t), compare_ns);
+    double seconds = (double)rec->total / 1e9;
+    fprintf(json, "%s\n        {\"name\": \"%s\", \"ops\": %lld, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+            "\"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u, \"max_ns\": %u}",
+            first ? "" : ",", name, rec->count, seconds, seconds > 0 ? (double)rec->count / seconds : 0.0,
+            percentile(rec->ns, rec->count, 0.50), percentile(rec->ns, rec->count, 0.99),
+            percentile(rec->ns, rec->count, 0.999), rec->count ? rec->ns[rec->count - 1] : 0);
+    fflush(json);
+    free(rec->ns);
+    rec->ns = NULL;
+}
+
+// Cost of one clock_ns pair, which every sample includes
+static double timer_overhead_ns(void) {
+    const int rounds = 100000;
+    uint64_t begin = clock_ns();
+    for (int i = 0; i < rounds; i++) {
+        volatile uint64_t t = clock_ns();
+        (void)t;
+    }
+    return (double)(clock_ns() - begin) / rounds;
+}
+
+static void run_scale(FILE* json, const Workload* w) {
+    unsigned long long state = w->seed * 2 + 1;
+    Recorder rec;
+    bool first = true;
+    fprintf(json, "    {\"scale\": %lld, \"suppliers\": %lld, \"benchmarks\": [", w->products, w->suppliers);
+
+    // Suppliers
+    SuppliersDB* sdb = suppliers_create();
+    if (recorder_init(&rec, w->suppliers)) {
+        for (long long i = 0; i < w->suppliers; i++) {
+            Supplier s;
+            make_supplier(w, i, &s);
+            uint64_t begin = clock_ns();
+            suppliers_insert(sdb, s);
+            record(&rec, begin);
+        }
+        report(json, &rec, "suppliers_insert", first);
+        first = false;
+    }
+    if (recorder_init(&rec, w->ops)) {
+        for (long long i = 0; i < w->ops; i++) {
+            int id = 1 + (int)(next_random(&state) % (unsigned long long)w->suppliers);
+            uint64_t begin = clock_ns();
+            suppliers_find_by_id(sdb, id);
+            record(&rec, begin);
+        }
+        report(json, &rec, "suppliers_find_by_id", first);
+        first = false;
+    }
+
+    // Inventory
+    Inventory* inv = inventory_create();
+    if (recorder_init(&rec, w->products)) {
+        for (long long i = 0; i < w->products; i++) {
+            Product p;
+            make_product(w, i, &p);
+            uint64_t begin = clock_ns();
+            inventory_add_product(inv, p);
+            record(&rec, begin);
+        }
+        report(json, &rec, "inventory_add_product", first);
+        first = false;
+    }
+    if (recorder_init(&rec, w->ops)) {
+        for (long long i = 0; i < w->ops; i++) {
+            ProductId id = product_id((long long)(next_random(&state) % (unsigned long long)w->products));
+            uint64_t begin = clock_ns();
+            inventory_get_product(inv, id);
+            record(&rec, begin);
+        }
+        report(json, &rec, "inventory_get_product", first);
+        first = false;
+    }
+    if (recorder_init(&rec, w->ops)) {
+        for (long long i = 0; i < w->ops; i++) {
+            unsigned long long r = next_random(&state);
+            ProductId id = product_id((long long)(r % (unsigned long long)w->products));
+            uint64_t begin = clock_ns();
+            inventory_update_stock(inv, id, (int)((r >> 40) % 200));
+            record(&rec, begin);
+        }
+        report(json, &rec, "inventory_update_stock", first);
+        first = false;
+    }
+    if (recorder_init(&rec, BENCH_ALERT_OPS)) {
+        for (int i = 0; i < BENCH_ALERT_OPS; i++) {
+            uint64_t begin = clock_ns();
+            inventory_pop_low_stock_alerts(inv, 5, 10);
+            record(&rec, begin);
+        }
+        report(json, &rec, "inventory_pop_low_stock_alerts", first);
+        first = false;
+    }
+
+    // Orders: enqueue untimed, then time each FIFO processing step
+    OrdersQueue* q = orders_create();
+    OrderItem items[BENCH_MAX_LINES];
+    for (long long i = 0; i < w->ops; i++) {
+        Order o;
+        make_order(w, i, &o, items);
+        orders_enqueue(q, o);
+    }
+    if (recorder_init(&rec, w->ops)) {
+        for (long long i = 0; i < w->ops; i++) {
+            uint64_t begin = clock_ns();
+            orders_process_next(q, inv);
+            record(&rec, begin);
+        }
+        report(json, &rec, "orders_process_next", first);
+        first = false;
+    }
+    orders_destroy(q);
+
+    // Search: a rotation of typical queries, each a narrow slice of the
+    // catalog so printing does not dominate
+    if (recorder_init(&rec, w->searchOps)) {
+        for (int i = 0; i < w->searchOps; i++) {
+            unsigned long long r = next_random(&state);
+            SearchCriteria c;
+            memset(&c, 0, sizeof(c));
+            double low = 1.0 + (double)(r % 100000) / 100.0;
+            switch (i % 4) {
+                case 0:
+                    c.hasCategory = true;
+                    snprintf(c.category, sizeof(c.category), "cat%02u", (unsigned)((r >> 20) % BENCH_CATEGORIES));
+                    c.hasPriceMin = c.hasPriceMax = true;
+                    c.priceMin = low;
+                    c.priceMax = low + 10.0;
+                    c.sortBy = 'p';
+                    break;
+                case 1:
+                    c.hasNamePrefix = true;
+                    snprintf(c.namePrefix, sizeof(c.namePrefix), "%s%s",
+                             SYLLABLES[(r >> 8) % 20], SYLLABLES[(r >> 16) % 20]);
+                    c.sortBy = 'n';
+                    break;
+                case 2:
+                    c.hasPriceMin = c.hasPriceMax = true;
+                    c.priceMin = low;
+                    c.priceMax = low + 1.0;
+                    c.onlyInStock = true;
+                    break;
+                default:
+                    c.hasNameContains = true;
+                    snprintf(c.nameContains, sizeof(c.nameContains), "%s %02u",
+                             SYLLABLES[(r >> 8) % 20], (unsigned)((r >> 16) % 100));
+                    c.hasSupplierScoreMin = true;
+                    c.supplierScoreMin = 5.0;
+                    c.sortBy = 's';
+                    break;
+            }
+            uint64_t begin = clock_ns();
+            search_build_and_execute(inv, sdb, c);
+            record(&rec, begin);
+        }
+        report(json, &rec, "search_build_and_execute", first);
+        first = false;
+    }
+
+    inventory_destroy(inv);
+    suppliers_destroy(sdb);
+    fprintf(json, "\n    ]}");
+}
+
+// "1k", "100k", "1m", "10m" or a plain count
+static long long parse_scale(const char* s) {
+    char* end;
+    long long n = strtoll(s, &end, 10);
+    if (end == s || n <= 0) return -1;
+    if (*end == 'k' || *end == 'K') {
+        n *= 1000;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        n *= 1000000;
+        end++;
+    }
+    return *end ? -1 : n;
+}
+
+int main(int argc, char** argv) {
+    long long scales[BENCH_MAX_SCALES] = { BENCH_DEFAULT_SCALE };
+    int scaleCount = 1;
+    unsigned long long seed = 42;
+    long long ops = BENCH_DEFAULT_OPS;
+    int searchOps = BENCH_DEFAULT_SEARCH_OPS;
+    const char* label = "";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--scale") == 0 && hasValue) {
+            char list[256];
+            strncpy(list, argv[++i], sizeof(list) - 1);
+            list[sizeof(list) - 1] = '\0';
+            scaleCount = 0;
+            for (char* tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                long long n = parse_scale(tok);
+                if (n <= 0 || scaleCount == BENCH_MAX_SCALES) {
+                    fprintf(stderr, "Error: bad scale '%s'\n", tok);
+                    return 1;
+                }
+                scales[scaleCount++] = n;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ops") == 0 && hasValue) {
+            ops = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--search-ops") == 0 && hasValue) {
+            searchOps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--label") == 0 && hasValue) {
+            label = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--scale 1k|100k|1m|10m[,...]] [--seed n] [--ops n] "
+                    "[--search-ops n] [--label text]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (scaleCount == 0 || ops <= 0 || searchOps < 0) {
+        fprintf(stderr, "Error: nothing to run\n");
+        return 1;
+    }
+
+    // JSON goes to the real stdout; everything the modules print is dropped
+    int jsonFd = dup(STDOUT_FILENO);
+    FILE* json = jsonFd >= 0 ? fdopen(jsonFd, "w") : NULL;
+    if (!json || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Error: cannot redirect stdout\n");
+        return 1;
+    }
+
+    fprintf(json, "{\n  \"label\": \"");
+    for (const char* c = label; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', json);
+        if ((unsigned char)*c >= 0x20) fputc(*c, json);
+    }
+    fprintf(json, "\",\n  \"seed\": %llu,\n  \"timer_overhead_ns\": %.1f,\n  \"runs\": [\n",
+            seed, timer_overhead_ns());
+    for (int i = 0; i < scaleCount; i++) {
+        Workload w;
+        w.seed = seed;
+        w.products = scales[i];
+        w.suppliers = scales[i] / 10 > 0 ? scales[i] / 10 : 1;
+        w.ops = ops < scales[i] ? ops : scales[i];
+        w.searchOps = searchOps;
+        if (i > 0) fprintf(json, ",\n");
+        run_scale(json, &w);
+        fprintf(stderr, "scale %lld done\n", scales[i]);
+    }
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+    return 0;
+}
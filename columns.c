@@ -0,0 +1,265 @@
+#include "columns.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLUMNS_X86 1
+#include <immintrin.h>
+#endif
+
+// Filter kernels AND a predicate into the bitmap, 64 rows per word.
+// They only see whole words; the caller handles the ragged tail.
+typedef struct FilterKernels {
+    void (*priceRange)(const double* col, int words, double lo, double hi, uint64_t* bitmap);
+    void (*intGreater)(const int* col, int words, int value, uint64_t* bitmap);
+    void (*intEqual)(const int* col, int words, int value, uint64_t* bitmap);
+} FilterKernels;
+
+// Scalar kernels (portable fallback)
+static void price_range_scalar(const double* col, int words, double lo, double hi, uint64_t* bitmap) {
+    for (int w = 0; w < words; w++) {
+        const double* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i++) {
+            mask |= (uint64_t)(v[i] >= lo && v[i] <= hi) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+static void int_greater_scalar(const int* col, int words, int value, uint64_t* bitmap) {
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i++) {
+            mask |= (uint64_t)(v[i] > value) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+static void int_equal_scalar(const int* col, int words, int value, uint64_t* bitmap) {
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i++) {
+            mask |= (uint64_t)(v[i] == value) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+static const FilterKernels scalarKernels = {
+    price_range_scalar, int_greater_scalar, int_equal_scalar
+};
+
+#ifdef COLUMNS_X86
+// SSE2 kernels: 2 doubles / 4 ints per compare
+__attribute__((target("sse2")))
+static void price_range_sse2(const double* col, int words, double lo, double hi, uint64_t* bitmap) {
+    __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+    for (int w = 0; w < words; w++) {
+        const double* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 2) {
+            __m128d x = _mm_loadu_pd(v + i);
+            __m128d in = _mm_and_pd(_mm_cmpge_pd(x, vlo), _mm_cmple_pd(x, vhi));
+            mask |= (uint64_t)_mm_movemask_pd(in) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+__attribute__((target("sse2")))
+static void int_greater_sse2(const int* col, int words, int value, uint64_t* bitmap) {
+    __m128i vv = _mm_set1_epi32(value);
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+            mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, vv))) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+__attribute__((target("sse2")))
+static void int_equal_sse2(const int* col, int words, int value, uint64_t* bitmap) {
+    __m128i vv = _mm_set1_epi32(value);
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+            mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, vv))) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+// AVX2 kernels: 4 doubles / 8 ints per compare
+__attribute__((target("avx2")))
+static void price_range_avx2(const double* col, int words, double lo, double hi, uint64_t* bitmap) {
+    __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+    for (int w = 0; w < words; w++) {
+        const double* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 4) {
+            __m256d x = _mm256_loadu_pd(v + i);
+            __m256d in = _mm256_and_pd(_mm256_cmp_pd(x, vlo, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(x, vhi, _CMP_LE_OQ));
+            mask |= (uint64_t)_mm256_movemask_pd(in) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+__attribute__((target("avx2")))
+static void int_greater_avx2(const int* col, int words, int value, uint64_t* bitmap) {
+    __m256i vv = _mm256_set1_epi32(value);
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 8) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+            mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, vv))) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+__attribute__((target("avx2")))
+static void int_equal_avx2(const int* col, int words, int value, uint64_t* bitmap) {
+    __m256i vv = _mm256_set1_epi32(value);
+    for (int w = 0; w < words; w++) {
+        const int* v = col + (size_t)w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i += 8) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+            mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, vv))) << i;
+        }
+        bitmap[w] &= mask;
+    }
+}
+
+static const FilterKernels sse2Kernels = {
+    price_range_sse2, int_greater_sse2, int_equal_sse2
+};
+
+static const FilterKernels avx2Kernels = {
+    price_range_avx2, int_greater_avx2, int_equal_avx2
+};
+#endif
+
+static const FilterKernels* select_kernels(void) {
+#ifdef COLUMNS_X86
+    if (__builtin_cpu_supports("avx2")) return &avx2Kernels;
+    if (__builtin_cpu_supports("sse2")) return &sse2Kernels;
+#endif
+    return &scalarKernels;
+}
+
+void columns_init(ColumnStore* cs) {
+    memset(cs, 0, sizeof(ColumnStore));
+}
+
+void columns_free(ColumnStore* cs) {
+    free(cs->price);
+    free(cs->stock);
+    free(cs->supplierId);
+    free(cs->categoryId);
+    free(cs->product);
+    memset(cs, 0, sizeof(ColumnStore));
+}
+
+static bool columns_grow(ColumnStore* cs, int capacity) {
+    double* price = (double*)realloc(cs->price, sizeof(double) * capacity);
+    if (price) cs->price = price;
+    int* stock = (int*)realloc(cs->stock, sizeof(int) * capacity);
+    if (stock) cs->stock = stock;
+    int* supplierId = (int*)realloc(cs->supplierId, sizeof(int) * capacity);
+    if (supplierId) cs->supplierId = supplierId;
+    int* categoryId = (int*)realloc(cs->categoryId, sizeof(int) * capacity);
+    if (categoryId) cs->categoryId = categoryId;
+    Product** product = (Product**)realloc(cs->product, sizeof(Product*) * capacity);
+    if (product) cs->product = product;
+    
+    // Columns that did grow stay valid at the old size too
+    if (!price || !stock || !supplierId || !categoryId || !product) return false;
+    cs->capacity = capacity;
+    return true;
+}
+
+bool columns_reserve(ColumnStore* cs, int count) {
+    if (count <= cs->capacity) return true;
+    int capacity = cs->capacity ? cs->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    return columns_grow(cs, capacity);
+}
+
+int columns_append(ColumnStore* cs, Product* p, int categoryId) {
+    if (!columns_reserve(cs, cs->count + 1)) return -1;
+    int row = cs->count++;
+    cs->product[row] = p;
+    columns_update(cs, row, categoryId);
+    return row;
+}
+
+void columns_update(ColumnStore* cs, int row, int categoryId) {
+    const Product* p = cs->product[row];
+    cs->price[row] = p->price;
+    cs->stock[row] = p->stock;
+    cs->supplierId[row] = p->supplierId;
+    cs->categoryId[row] = categoryId;
+}
+
+Product* columns_remove(ColumnStore* cs, int row) {
+    int last = --cs->count;
+    if (row == last) return NULL;
+    cs->price[row] = cs->price[last];
+    cs->stock[row] = cs->stock[last];
+    cs->supplierId[row] = cs->supplierId[last];
+    cs->categoryId[row] = cs->categoryId[last];
+    cs->product[row] = cs->product[last];
+    return cs->product[row];
+}
+
+int columns_bitmap_words(const ColumnStore* cs) {
+    return (cs->count + 63) / 64;
+}
+
+int columns_filter(const ColumnStore* cs, const ColumnFilter* f, uint64_t* bitmap) {
+    int words = columns_bitmap_words(cs);
+    int fullWords = cs->count / 64;
+    int tail = cs->count % 64;
+    if (words == 0) return 0;
+    
+    // Start with every live row selected
+    for (int w = 0; w < words; w++) bitmap[w] = ~0ULL;
+    if (tail) bitmap[words - 1] = (1ULL << tail) - 1;
+    
+    const FilterKernels* k = select_kernels();
+    bool hasPrice = f->hasPriceMin || f->hasPriceMax;
+    double lo = f->hasPriceMin ? f->priceMin : -INFINITY;
+    double hi = f->hasPriceMax ? f->priceMax : INFINITY;
+    
+    if (hasPrice) k->priceRange(cs->price, fullWords, lo, hi, bitmap);
+    if (f->onlyInStock) k->intGreater(cs->stock, fullWords, 0, bitmap);
+    if (f->hasCategory) k->intEqual(cs->categoryId, fullWords, f->categoryId, bitmap);
+    if (f->hasSupplier) k->intEqual(cs->supplierId, fullWords, f->supplierId, bitmap);
+    
+    // Ragged tail in scalar code
+    for (int row = fullWords * 64; row < cs->count; row++) {
+        bool keep = !hasPrice || (cs->price[row] >= lo && cs->price[row] <= hi);
+        if (f->onlyInStock && cs->stock[row] <= 0) keep = false;
+        if (f->hasCategory && cs->categoryId[row] != f->categoryId) keep = false;
+        if (f->hasSupplier && cs->supplierId[row] != f->supplierId) keep = false;
+        if (!keep) bitmap[fullWords] &= ~(1ULL << (row % 64));
+    }
+    
+    int matches = 0;
+    for (int w = 0; w < words; w++) matches += __builtin_popcountll(bitmap[w]);
+    return matches;
+}
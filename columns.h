@@ -0,0 +1,51 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "common.h"
+
+// Structure-of-arrays shadow of the product catalog. Each row mirrors one
+// live product so search predicates can be evaluated a column at a time.
+typedef struct ColumnStore {
+    double* price;
+    int* stock;
+    int* supplierId;
+    int* categoryId;
+    Product** product;  // Row -> owning product
+    int count;
+    int capacity;
+} ColumnStore;
+
+// Predicates for columns_filter; unset fields match every row
+typedef struct ColumnFilter {
+    bool hasPriceMin;
+    double priceMin;
+    bool hasPriceMax;
+    double priceMax;
+    bool onlyInStock;
+    bool hasCategory;
+    int categoryId;
+    bool hasSupplier;
+    int supplierId;
+} ColumnFilter;
+
+void columns_init(ColumnStore* cs);
+void columns_free(ColumnStore* cs);
+
+// Room for count rows; false if out of memory
+bool columns_reserve(ColumnStore* cs, int count);
+// Append a row mirroring the product; returns the row, or -1 on failure
+int columns_append(ColumnStore* cs, Product* p, int categoryId);
+// Re-read a row's values from its product
+void columns_update(ColumnStore* cs, int row, int categoryId);
+// Swap-remove a row; returns the product moved into it, or NULL
+Product* columns_remove(ColumnStore* cs, int row);
+
+// Number of 64-bit words in a selection bitmap covering every row
+int columns_bitmap_words(const ColumnStore* cs);
+// Evaluate the filter into a selection bitmap (bit i = row i) using
+// AVX2/SSE2 kernels where available; returns the number of matches
+int columns_filter(const ColumnStore* cs, const ColumnFilter* f, uint64_t* bitmap);
+
+#endif // COLUMNS_H
@@ -0,0 +1,855 @@
+#include "commands.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define COMMAND_INITIAL_TOKENS 16
+// Orders per orders_process_batch call (and per undo step) in PROCESS
+#define COMMAND_PROCESS_BATCH 256
+#define COMMAND_LOWSTOCK_DEFAULT 10
+
+// Block reader; lines are handed out in place, NUL-terminated
+typedef struct CommandReader {
+    int fd;
+    char* buffer;
+    size_t start;   // First unconsumed byte
+    size_t end;     // End of buffered data
+    bool eof;
+    bool failed;    // Read error
+    bool skipping;  // Discarding the rest of an over-long line
+} CommandReader;
+
+typedef struct CommandSession {
+    Inventory* inv;
+    SuppliersDB* sdb;
+    OrdersQueue* oq;
+    FulfillmentPool* pool;
+    OrderScheduler* sched;
+    RatingIndex* ratings;  // Rebuilt when the suppliers change
+    FILE* out;
+    const char* reason;  // Set by a handler that fails
+    bool quit;
+    // Scratch reused across lines
+    char** tokens;
+    int tokenCapacity;
+    OrderItem* items;
+    int itemCapacity;
+    // Last SEARCH, continued by MORE
+    bool searching;
+    SearchCriteria search;
+    SearchCursor searchCursor;
+    int searchLimit;
+} CommandSession;
+
+typedef bool (*CommandHandler)(CommandSession* s, char** args, int argc);
+
+typedef struct CommandSpec {
+    const char* verb;
+    CommandHandler run;
+    int minArgs;
+    int maxArgs;
+    const char* usage;
+} CommandSpec;
+
+// Next line, or NULL at end of input. An over-long line comes back as an
+// empty string with *tooLong set.
+static char* reader_next_line(CommandReader* r, bool* tooLong) {
+    *tooLong = false;
+    for (;;) {
+        char* data = r->buffer + r->start;
+        char* nl = (char*)memchr(data, '\n', r->end - r->start);
+        if (r->skipping) {
+            if (nl || r->eof) {
+                r->start = nl ? (size_t)(nl + 1 - r->buffer) : r->end;
+                r->skipping = false;
+                *tooLong = true;
+                return (char*)"";
+            }
+            r->start = r->end = 0;
+        } else if (nl) {
+            *nl = '\0';
+            r->start = (size_t)(nl + 1 - r->buffer);
+            return data;
+        } else if (r->eof) {
+            if (r->start == r->end) return NULL;
+            r->buffer[r->end] = '\0';
+            r->start = r->end;
+            return data;
+        }
+
+        // Keep the partial line and refill behind it
+        if (r->start > 0) {
+            memmove(r->buffer, r->buffer + r->start, r->end - r->start);
+            r->end -= r->start;
+            r->start = 0;
+        }
+        if (r->end == COMMAND_BUFFER_BYTES) {
+            r->skipping = true;
+            r->end = 0;
+        }
+        ssize_t n = read(r->fd, r->buffer + r->end, COMMAND_BUFFER_BYTES - r->end);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) r->failed = true;
+        if (n <= 0) r->eof = true;
+        else r->end += (size_t)n;
+        // Keep the data NUL-terminated for the unterminated last line
+        r->buffer[r->end] = '\0';
+    }
+}
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Split a line into tokens in place, growing the token array as needed;
+// returns the count, -1 on an unterminated quote or -2 if out of memory
+static int tokenize(char* line, char*** tokens, int* capacity) {
+    int count = 0;
+    char* p = line;
+    for (;;) {
+        while (is_blank(*p)) p++;
+        if (!*p) return count;
+        if (count == *capacity) {
+            int grown = *capacity ? *capacity * 2 : COMMAND_INITIAL_TOKENS;
+            char** t = (char**)realloc(*tokens, (size_t)grown * sizeof(char*));
+            if (!t) return -2;
+            *tokens = t;
+            *capacity = grown;
+        }
+
+        if (*p != '"') {
+            (*tokens)[count++] = p;
+            while (*p && !is_blank(*p)) p++;
+            if (*p) *p++ = '\0';
+            continue;
+        }
+
+        char* out = ++p;
+        (*tokens)[count++] = out;
+        while (*p != '"') {
+            if (!*p) return -1;
+            if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) p++;
+            *out++ = *p++;
+        }
+        p++;
+        if (*p && !is_blank(*p)) return -1;
+        *out = '\0';
+    }
+}
+
+// Argument parsers; the whole token must be consumed
+static bool arg_llong(const char* s, long long* out) {
+    char* end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (end == s || *end || errno) return false;
+    *out = v;
+    return true;
+}
+
+static bool arg_int(const char* s, int* out) {
+    long long v;
+    if (!arg_llong(s, &v) || v < INT_MIN || v > INT_MAX) return false;
+    *out = (int)v;
+    return true;
+}
+
+static bool arg_double(const char* s, double* out) {
+    char* end;
+    double v = strtod(s, &end);
+    if (end == s || *end) return false;
+    *out = v;
+    return true;
+}
+
+static void copy_arg(char* dst, size_t size, const char* src) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+// Quote a value so responses tokenize with the same rules as commands
+static void put_quoted(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static bool cmd_add(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    Product p;
+    memset(&p, 0, sizeof(p));
+    if (!arg_llong(args[0], &p.id) || !arg_int(args[3], &p.supplierId) ||
+        !arg_double(args[4], &p.price) || !arg_int(args[5], &p.stock)) {
+        s->reason = "bad number";
+        return false;
+    }
+    copy_arg(p.name, sizeof(p.name), args[1]);
+    copy_arg(p.category, sizeof(p.category), args[2]);
+    if (!inventory_add_product(s->inv, p)) {
+        s->reason = "add failed";
+        return false;
+    }
+    fprintf(s->out, "OK ADD id=%lld\n", p.id);
+    return true;
+}
+
+static bool cmd_stock(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    ProductId id;
+    int stock;
+    if (!arg_llong(args[0], &id) || !arg_int(args[1], &stock)) {
+        s->reason = "bad number";
+        return false;
+    }
+    if (!inventory_update_stock(s->inv, id, stock)) {
+        s->reason = "unknown product";
+        return false;
+    }
+    fprintf(s->out, "OK STOCK id=%lld stock=%d\n", id, stock);
+    return true;
+}
+
+static bool cmd_remove(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    ProductId id;
+    if (!arg_llong(args[0], &id)) {
+        s->reason = "bad number";
+        return false;
+    }
+    if (!inventory_remove_product(s->inv, id)) {
+        s->reason = "unknown product";
+        return false;
+    }
+    fprintf(s->out, "OK REMOVE id=%lld\n", id);
+    return true;
+}
+
+static bool cmd_get(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    ProductId id;
+    if (!arg_llong(args[0], &id)) {
+        s->reason = "bad number";
+        return false;
+    }
+    Product* p = inventory_get_product(s->inv, id);
+    if (!p) {
+        s->reason = "unknown product";
+        return false;
+    }
+    fprintf(s->out, "OK GET id=%lld name=", p->id);
+    put_quoted(s->out, p->name);
+    fputs(" category=", s->out);
+    put_quoted(s->out, p->category);
+    fprintf(s->out, " supplier=%d price=%.2f stock=%d\n", p->supplierId, p->price, p->stock);
+    return true;
+}
+
+static bool cmd_undo(CommandSession* s, char** args, int argc) {
+    (void)args;
+    (void)argc;
+    if (!inventory_undo_last(s->inv)) {
+        s->reason = "nothing to undo";
+        return false;
+    }
+    fputs("OK UNDO\n", s->out);
+    return true;
+}
+
+static bool cmd_supplier(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    Supplier sup;
+    memset(&sup, 0, sizeof(sup));
+    SupplierRatings* r = &sup.ratings;
+    if (!arg_int(args[0], &sup.id) || !arg_double(args[2], &r->quality) ||
+        !arg_double(args[3], &r->deliveryTime) || !arg_double(args[4], &r->price) ||
+        !arg_double(args[5], &r->reliability) || !arg_double(args[6], &r->customerService)) {
+        s->reason = "bad number";
+        return false;
+    }
+    copy_arg(sup.name, sizeof(sup.name), args[1]);
+    if (!suppliers_insert(s->sdb, sup)) {
+        s->reason = "insert failed";
+        return false;
+    }
+    fprintf(s->out, "OK SUPPLIER id=%d score=%.2f\n", sup.id, supplier_overall_score(r));
+    return true;
+}
+
+static bool cmd_weights(CommandSession* s, char** args, int argc) {
+    ScoreWeights w;
+    if (argc == 1) {
+        if (!score_weights_profile(args[0], &w)) {
+            s->reason = "unknown profile";
+            return false;
+        }
+    } else if (argc != 5 || !arg_double(args[0], &w.quality) || !arg_double(args[1], &w.deliveryTime) ||
+               !arg_double(args[2], &w.price) || !arg_double(args[3], &w.reliability) ||
+               !arg_double(args[4], &w.customerService)) {
+        s->reason = "WEIGHTS profile | WEIGHTS quality deliveryTime price reliability customerService";
+        return false;
+    }
+    if (!suppliers_set_weights(s->sdb, &w)) {
+        s->reason = "bad weights";
+        return false;
+    }
+    const ScoreWeights* a = score_weights();
+    fprintf(s->out, "OK WEIGHTS quality=%.3f deliveryTime=%.3f price=%.3f reliability=%.3f customerService=%.3f\n",
+            a->quality, a->deliveryTime, a->price, a->reliability, a->customerService);
+    return true;
+}
+
+// Build an order from "orderId customer productId quantity ..." with the
+// item pairs starting at args[first]; items use the session scratch
+static bool parse_order(CommandSession* s, char** args, int argc, int first, Order* o) {
+    if ((argc - first) % 2 != 0) {
+        s->reason = "items need a product id and a quantity";
+        return false;
+    }
+    int numItems = (argc - first) / 2;
+    if (numItems > s->itemCapacity) {
+        OrderItem* items = (OrderItem*)realloc(s->items, (size_t)numItems * sizeof(OrderItem));
+        if (!items) {
+            s->reason = "out of memory";
+            return false;
+        }
+        s->items = items;
+        s->itemCapacity = numItems;
+    }
+    memset(o, 0, sizeof(*o));
+    o->items = s->items;
+    if (!arg_int(args[0], &o->id)) {
+        s->reason = "bad number";
+        return false;
+    }
+    copy_arg(o->customer, sizeof(o->customer), args[1]);
+    for (int i = first; i < argc; i += 2) {
+        OrderItem* item = &o->items[o->numItems++];
+        if (!arg_llong(args[i], &item->productId) || !arg_int(args[i + 1], &item->quantity) ||
+            item->quantity <= 0) {
+            s->reason = "bad item";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool cmd_enqueue(CommandSession* s, char** args, int argc) {
+    Order o;
+    if (!parse_order(s, args, argc, 2, &o)) return false;
+    if (!orders_enqueue(s->oq, o)) {
+        s->reason = "enqueue failed";
+        return false;
+    }
+    fprintf(s->out, "OK ENQUEUE id=%d items=%d queued=%d\n", o.id, o.numItems, orders_count(s->oq));
+    return true;
+}
+
+static bool cmd_process(CommandSession* s, char** args, int argc) {
+    long long limit = 1;
+    if (argc == 1) {
+        if (strcmp(args[0], "*") == 0) limit = LLONG_MAX;
+        else if (!arg_llong(args[0], &limit) || limit < 0) {
+            s->reason = "bad count";
+            return false;
+        }
+    }
+    long long fulfilled = 0, failed = 0;
+    while (limit > 0) {
+        OrderBatchStats batch;
+        int want = limit < COMMAND_PROCESS_BATCH ? (int)limit : COMMAND_PROCESS_BATCH;
+        int taken = orders_process_batch(s->oq, s->inv, want, &batch);
+        if (taken == 0) break;
+        fulfilled += batch.fulfilled;
+        failed += batch.failed;
+        limit -= taken;
+    }
+    fprintf(s->out, "OK PROCESS fulfilled=%lld failed=%lld remaining=%d\n",
+            fulfilled, failed, orders_count(s->oq));
+    return true;
+}
+
+static bool cmd_fulfill(CommandSession* s, char** args, int argc) {
+    int limit = 0;
+    if (argc == 1 && strcmp(args[0], "*") != 0 && (!arg_int(args[0], &limit) || limit <= 0)) {
+        s->reason = "bad count";
+        return false;
+    }
+    if (!s->pool) {
+        s->reason = "no worker pool";
+        return false;
+    }
+    FulfillmentStats stats;
+    fulfillment_drain(s->pool, s->oq, limit, &stats);
+    fprintf(s->out, "OK FULFILL fulfilled=%lld failed=%lld remaining=%d workers=%d\n",
+            stats.fulfilled, stats.failed, orders_count(s->oq), fulfillment_workers(s->pool));
+    return true;
+}
+
+static bool cmd_schedule(CommandSession* s, char** args, int argc) {
+    int priority;
+    long long deadlineMs;
+    if (!arg_int(args[2], &priority) || !arg_llong(args[3], &deadlineMs) ||
+        priority < 0 || priority >= SCHED_CLASSES || deadlineMs < 0) {
+        s->reason = "bad priority or deadline";
+        return false;
+    }
+    Order o;
+    if (!parse_order(s, args, argc, 4, &o)) return false;
+    if (scheduler_contains(s->sched, o.id)) {
+        s->reason = "order already scheduled";
+        return false;
+    }
+    if (!scheduler_submit(s->sched, o, priority, deadlineMs)) {
+        s->reason = "schedule failed";
+        return false;
+    }
+    fprintf(s->out, "OK SCHEDULE id=%d priority=%d items=%d pending=%d\n",
+            o.id, priority, o.numItems, scheduler_count(s->sched));
+    return true;
+}
+
+static bool cmd_reprioritize(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    int id, priority;
+    long long deadlineMs;
+    if (!arg_int(args[0], &id) || !arg_int(args[1], &priority) || !arg_llong(args[2], &deadlineMs) ||
+        priority < 0 || priority >= SCHED_CLASSES || deadlineMs < 0) {
+        s->reason = "bad number";
+        return false;
+    }
+    if (!scheduler_reprioritize(s->sched, id, priority, deadlineMs)) {
+        s->reason = "order not scheduled";
+        return false;
+    }
+    fprintf(s->out, "OK REPRIORITIZE id=%d priority=%d\n", id, priority);
+    return true;
+}
+
+static bool cmd_cancel(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    int id;
+    if (!arg_int(args[0], &id)) {
+        s->reason = "bad number";
+        return false;
+    }
+    if (!scheduler_cancel(s->sched, id)) {
+        s->reason = "order not scheduled";
+        return false;
+    }
+    fprintf(s->out, "OK CANCEL id=%d pending=%d\n", id, scheduler_count(s->sched));
+    return true;
+}
+
+static bool cmd_dispatch(CommandSession* s, char** args, int argc) {
+    long long limit = 1;
+    if (argc == 1) {
+        if (strcmp(args[0], "*") == 0) limit = LLONG_MAX;
+        else if (!arg_llong(args[0], &limit) || limit < 0) {
+            s->reason = "bad count";
+            return false;
+        }
+    }
+    long long fulfilled = 0, failed = 0;
+    for (; limit > 0; limit--) {
+        OrderOutcome outcome = scheduler_fulfill_next(s->sched, s->inv, NULL, NULL);
+        if (outcome == ORDER_QUEUE_EMPTY) break;
+        if (outcome == ORDER_FULFILLED) fulfilled++;
+        else failed++;
+    }
+    fprintf(s->out, "OK DISPATCH fulfilled=%lld failed=%lld pending=%d\n",
+            fulfilled, failed, scheduler_count(s->sched));
+    return true;
+}
+
+static bool cmd_latency(CommandSession* s, char** args, int argc) {
+    (void)argc;
+    int priority;
+    if (!arg_int(args[0], &priority) || priority < 0 || priority >= SCHED_CLASSES) {
+        s->reason = "bad class";
+        return false;
+    }
+    SchedulerClassStats st;
+    scheduler_class_stats(s->sched, priority, &st);
+    fprintf(s->out, "OK LATENCY class=%d dispatched=%lld cancelled=%lld missed=%lld "
+            "mean_ms=%.3f p50_ms=%.3f p90_ms=%.3f p99_ms=%.3f p999_ms=%.3f max_ms=%.3f\n",
+            priority, st.dispatched, st.cancelled, st.missed, st.mean * 1e3, st.p50 * 1e3,
+            st.p90 * 1e3, st.p99 * 1e3, st.p999 * 1e3, st.max * 1e3);
+    return true;
+}
+
+static bool cmd_lowstock(CommandSession* s, char** args, int argc) {
+    int threshold;
+    int max = COMMAND_LOWSTOCK_DEFAULT;
+    if (!arg_int(args[0], &threshold) || (argc == 2 && (!arg_int(args[1], &max) || max < 0))) {
+        s->reason = "bad number";
+        return false;
+    }
+    Product** found = (Product**)malloc(sizeof(Product*) * (size_t)(max > 0 ? max : 1));
+    if (!found) {
+        s->reason = "out of memory";
+        return false;
+    }
+    int n = inventory_peek_low_stock(s->inv, threshold, found, max);
+    fprintf(s->out, "OK LOWSTOCK count=%d ids=", n);
+    for (int i = 0; i < n; i++) {
+        fprintf(s->out, i ? ",%lld" : "%lld", found[i]->id);
+    }
+    fputc('\n', s->out);
+    free(found);
+    return true;
+}
+
+// SUGGEST and CONTAINS: name index lookups that stop after max matches
+static bool name_lookup(CommandSession* s, char** args, int argc, const char* verb,
+                        int (*lookup)(Inventory*, const char*, Product**, int)) {
+    int max = COMMAND_LOWSTOCK_DEFAULT;
+    if (argc == 2 && (!arg_int(args[1], &max) || max < 0)) {
+        s->reason = "bad number";
+        return false;
+    }
+    Product** found = (Product**)malloc(sizeof(Product*) * (size_t)(max > 0 ? max : 1));
+    if (!found) {
+        s->reason = "out of memory";
+        return false;
+    }
+    int n = lookup(s->inv, args[0], found, max);
+    fprintf(s->out, "OK %s count=%d ids=", verb, n);
+    for (int i = 0; i < n; i++) {
+        fprintf(s->out, i ? ",%lld" : "%lld", found[i]->id);
+    }
+    fputc('\n', s->out);
+    free(found);
+    return true;
+}
+
+static bool cmd_suggest(CommandSession* s, char** args, int argc) {
+    return name_lookup(s, args, argc, "SUGGEST", inventory_suggest_names);
+}
+
+static bool cmd_contains(CommandSession* s, char** args, int argc) {
+    return name_lookup(s, args, argc, "CONTAINS", inventory_find_names);
+}
+
+// SEARCH filters: min=, max=, category=, prefix=, contains=, score=, instock
+static bool parse_search_filter(SearchCriteria* c, const char* arg) {
+    if (strcasecmp(arg, "instock") == 0) {
+        c->onlyInStock = true;
+        return true;
+    }
+    const char* value = strchr(arg, '=');
+    if (!value) return false;
+    size_t keyLen = (size_t)(value - arg);
+    value++;
+    if (keyLen == 3 && strncasecmp(arg, "min", 3) == 0) {
+        return c->hasPriceMin = arg_double(value, &c->priceMin);
+    } else if (keyLen == 3 && strncasecmp(arg, "max", 3) == 0) {
+        return c->hasPriceMax = arg_double(value, &c->priceMax);
+    } else if (keyLen == 5 && strncasecmp(arg, "score", 5) == 0) {
+        return c->hasSupplierScoreMin = arg_double(value, &c->supplierScoreMin);
+    } else if (keyLen == 8 && strncasecmp(arg, "category", 8) == 0) {
+        copy_arg(c->category, sizeof(c->category), value);
+        return c->hasCategory = true;
+    } else if (keyLen == 6 && strncasecmp(arg, "prefix", 6) == 0) {
+        copy_arg(c->namePrefix, sizeof(c->namePrefix), value);
+        return c->hasNamePrefix = true;
+    } else if (keyLen == 8 && strncasecmp(arg, "contains", 8) == 0) {
+        copy_arg(c->nameContains, sizeof(c->nameContains), value);
+        return c->hasNameContains = true;
+    }
+    return false;
+}
+
+// Fetch the next page of the session's search and reply with its ids
+static bool search_reply(CommandSession* s, const char* verb, int limit) {
+    SearchHit* hits = (SearchHit*)malloc(sizeof(SearchHit) * (size_t)(limit > 0 ? limit : 1));
+    int n = hits ? search_page(s->inv, s->sdb, &s->search, &s->searchCursor, hits, limit) : -1;
+    if (n < 0) {
+        free(hits);
+        s->reason = "out of memory";
+        return false;
+    }
+    fprintf(s->out, "OK %s count=%d more=%d ids=", verb, n, s->searchCursor.done ? 0 : 1);
+    for (int i = 0; i < n; i++) {
+        fprintf(s->out, i ? ",%lld" : "%lld", hits[i].product->id);
+    }
+    fputc('\n', s->out);
+    free(hits);
+    return true;
+}
+
+static bool cmd_search(CommandSession* s, char** args, int argc) {
+    SearchCriteria c;
+    memset(&c, 0, sizeof(c));
+    if (strcasecmp(args[0], "price") == 0) c.sortBy = 'p';
+    else if (strcasecmp(args[0], "name") == 0) c.sortBy = 'n';
+    else if (strcasecmp(args[0], "supplier") == 0) c.sortBy = 's';
+    else if (strcasecmp(args[0], "id") != 0) {
+        s->reason = "bad sort";
+        return false;
+    }
+    int limit;
+    if (!arg_int(args[1], &limit) || limit < 0) {
+        s->reason = "bad number";
+        return false;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (!parse_search_filter(&c, args[i])) {
+            s->reason = "bad filter";
+            return false;
+        }
+    }
+    s->searching = true;
+    s->search = c;
+    memset(&s->searchCursor, 0, sizeof(s->searchCursor));
+    s->searchLimit = limit;
+    return search_reply(s, "SEARCH", limit);
+}
+
+static bool cmd_more(CommandSession* s, char** args, int argc) {
+    int limit = s->searchLimit;
+    if (argc == 1 && (!arg_int(args[0], &limit) || limit < 0)) {
+        s->reason = "bad number";
+        return false;
+    }
+    if (!s->searching) {
+        s->reason = "no search";
+        return false;
+    }
+    return search_reply(s, "MORE", limit);
+}
+
+static RatingIndex* session_ratings(CommandSession* s) {
+    if (s->ratings && ratings_version(s->ratings) == suppliers_version(s->sdb)) return s->ratings;
+    ratings_destroy(s->ratings);
+    s->ratings = ratings_build(s->sdb);
+    return s->ratings;
+}
+
+static void put_supplier_ids(FILE* out, const Supplier** found, int n) {
+    fputs(" ids=", out);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, i ? ",%d" : "%d", found[i]->id);
+    }
+    fputc('\n', out);
+}
+
+static bool cmd_ratings(CommandSession* s, char** args, int argc) {
+    RatingBox box;
+    int max = COMMAND_LOWSTOCK_DEFAULT;
+    ratings_box_all(&box);
+    for (int d = 0; d < RATING_DIMS; d++) {
+        if (!arg_double(args[d], &box.min[d])) {
+            s->reason = "bad number";
+            return false;
+        }
+    }
+    if (argc == RATING_DIMS + 1 && (!arg_int(args[RATING_DIMS], &max) || max < 0)) {
+        s->reason = "bad number";
+        return false;
+    }
+    RatingIndex* idx = session_ratings(s);
+    const Supplier** found = (const Supplier**)malloc(sizeof(Supplier*) * (size_t)(max > 0 ? max : 1));
+    if (!idx || !found) {
+        free(found);
+        s->reason = "out of memory";
+        return false;
+    }
+    int n = ratings_range(idx, &box, found, max);
+    fprintf(s->out, "OK RATINGS count=%d", n);
+    put_supplier_ids(s->out, found, n < max ? n : max);
+    free(found);
+    return true;
+}
+
+static bool cmd_skyline(CommandSession* s, char** args, int argc) {
+    int max = COMMAND_LOWSTOCK_DEFAULT;
+    if (argc == 1 && (!arg_int(args[0], &max) || max < 0)) {
+        s->reason = "bad number";
+        return false;
+    }
+    RatingIndex* idx = session_ratings(s);
+    const Supplier** found = (const Supplier**)malloc(sizeof(Supplier*) * (size_t)(max > 0 ? max : 1));
+    int n = idx && found ? ratings_skyline(idx, found, max) : -1;
+    if (n < 0) {
+        free(found);
+        s->reason = "out of memory";
+        return false;
+    }
+    fprintf(s->out, "OK SKYLINE count=%d", n);
+    put_supplier_ids(s->out, found, n < max ? n : max);
+    free(found);
+    return true;
+}
+
+static bool cmd_count(CommandSession* s, char** args, int argc) {
+    (void)args;
+    (void)argc;
+    fprintf(s->out, "OK COUNT products=%d suppliers=%d orders=%d\n",
+            inventory_count(s->inv), suppliers_count(s->sdb), orders_count(s->oq));
+    return true;
+}
+
+// Totals so far as one JSON object, optionally zeroed afterwards
+static bool cmd_stats(CommandSession* s, char** args, int argc) {
+    bool reset = argc == 1 && strcasecmp(args[0], "reset") == 0;
+    if (argc == 1 && !reset) {
+        s->reason = "expected reset";
+        return false;
+    }
+    fputs("OK STATS metrics=", s->out);
+    metrics_write(s->out, METRICS_JSON);
+    if (reset) metrics_reset();
+    return true;
+}
+
+static bool cmd_quit(CommandSession* s, char** args, int argc) {
+    (void)args;
+    (void)argc;
+    s->quit = true;
+    fputs("OK QUIT\n", s->out);
+    return true;
+}
+
+static const CommandSpec COMMANDS[] = {
+    { "ADD", cmd_add, 6, 6, "ADD id name category supplierId price stock" },
+    { "STOCK", cmd_stock, 2, 2, "STOCK id newStock" },
+    { "REMOVE", cmd_remove, 1, 1, "REMOVE id" },
+    { "GET", cmd_get, 1, 1, "GET id" },
+    { "UNDO", cmd_undo, 0, 0, "UNDO" },
+    { "SUPPLIER", cmd_supplier, 7, 7,
+      "SUPPLIER id name quality deliveryTime price reliability customerService" },
+    { "WEIGHTS", cmd_weights, 1, 5,
+      "WEIGHTS profile | WEIGHTS quality deliveryTime price reliability customerService" },
+    { "ENQUEUE", cmd_enqueue, 4, INT_MAX,
+      "ENQUEUE orderId customer productId quantity [productId quantity ...]" },
+    { "PROCESS", cmd_process, 0, 1, "PROCESS [count|*]" },
+    { "FULFILL", cmd_fulfill, 0, 1, "FULFILL [count|*]" },
+    { "SCHEDULE", cmd_schedule, 6, INT_MAX,
+      "SCHEDULE orderId customer priority deadlineMs productId quantity [productId quantity ...]" },
+    { "REPRIORITIZE", cmd_reprioritize, 3, 3, "REPRIORITIZE orderId priority deadlineMs" },
+    { "CANCEL", cmd_cancel, 1, 1, "CANCEL orderId" },
+    { "DISPATCH", cmd_dispatch, 0, 1, "DISPATCH [count|*]" },
+    { "LATENCY", cmd_latency, 1, 1, "LATENCY class" },
+    { "LOWSTOCK", cmd_lowstock, 1, 2, "LOWSTOCK threshold [max]" },
+    { "SEARCH", cmd_search, 2, INT_MAX,
+      "SEARCH price|name|supplier|id limit [min= max= category= prefix= contains= score= instock]" },
+    { "MORE", cmd_more, 0, 1, "MORE [limit]" },
+    { "SUGGEST", cmd_suggest, 1, 2, "SUGGEST prefix [max]" },
+    { "CONTAINS", cmd_contains, 1, 2, "CONTAINS text [max]" },
+    { "RATINGS", cmd_ratings, RATING_DIMS, RATING_DIMS + 1,
+      "RATINGS minQuality minDelivery minPrice minReliability minService [max]" },
+    { "SKYLINE", cmd_skyline, 0, 1, "SKYLINE [max]" },
+    { "COUNT", cmd_count, 0, 0, "COUNT" },
+    { "STATS", cmd_stats, 0, 1, "STATS [reset]" },
+    { "QUIT", cmd_quit, 0, 0, "QUIT" },
+};
+
+static const CommandSpec* find_command(const char* verb) {
+    for (size_t i = 0; i < sizeof(COMMANDS) / sizeof(COMMANDS[0]); i++) {
+        if (strcasecmp(verb, COMMANDS[i].verb) == 0) return &COMMANDS[i];
+    }
+    return NULL;
+}
+
+static void reply_error(FILE* out, const char* verb, long long lineNo, const char* reason) {
+    fputs("ERR ", out);
+    fputs(verb, out);
+    fprintf(out, " line=%lld reason=", lineNo);
+    put_quoted(out, reason);
+    fputc('\n', out);
+}
+
+// Run one line; returns false if it was a failed command
+static bool run_line(CommandSession* s, char* line, long long lineNo, bool* isCommand) {
+    *isCommand = false;
+    while (is_blank(*line)) line++;
+    if (!*line || *line == '#') return true;
+    *isCommand = true;
+
+    int count = tokenize(line, &s->tokens, &s->tokenCapacity);
+    if (count < 0) {
+        reply_error(s->out, "?", lineNo, count == -1 ? "unterminated quote" : "out of memory");
+        return false;
+    }
+    char** tokens = s->tokens;
+
+    const CommandSpec* spec = find_command(tokens[0]);
+    if (!spec) {
+        // Echo the verb unless quoting let it hold something that would
+        // break the response line
+        bool plain = tokens[0][0] && !strpbrk(tokens[0], " \t\r\"");
+        reply_error(s->out, plain ? tokens[0] : "?", lineNo, "unknown command");
+        return false;
+    }
+    int argc = count - 1;
+    if (argc < spec->minArgs || argc > spec->maxArgs) {
+        reply_error(s->out, spec->verb, lineNo, spec->usage);
+        return false;
+    }
+    s->reason = "failed";
+    if (!spec->run(s, tokens + 1, argc)) {
+        reply_error(s->out, spec->verb, lineNo, s->reason);
+        return false;
+    }
+    return true;
+}
+
+bool commands_run(const char* path, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq,
+                  FulfillmentPool* pool, FILE* out, CommandStats* stats) {
+    CommandStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(CommandStats));
+    if (!path || !inv || !sdb || !oq || !out) return false;
+
+    CommandReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (reader.fd < 0) return false;
+    // One spare byte for the terminator of an unterminated last line
+    reader.buffer = (char*)malloc(COMMAND_BUFFER_BYTES + 1);
+    if (!reader.buffer) {
+        if (reader.fd != STDIN_FILENO) close(reader.fd);
+        return false;
+    }
+
+    CommandSession session = { inv, sdb, oq, pool, scheduler_create(), NULL, out, NULL, false, NULL, 0, NULL, 0 };
+    if (!session.sched) {
+        free(reader.buffer);
+        if (reader.fd != STDIN_FILENO) close(reader.fd);
+        return false;
+    }
+    long long lineNo = 0;
+    bool tooLong;
+    char* line;
+    while (!session.quit && (line = reader_next_line(&reader, &tooLong)) != NULL) {
+        lineNo++;
+        if (tooLong) {
+            stats->commands++;
+            stats->failed++;
+            reply_error(out, "?", lineNo, "line too long");
+            continue;
+        }
+        bool isCommand;
+        bool ok = run_line(&session, line, lineNo, &isCommand);
+        if (isCommand) stats->commands++;
+        if (!ok) stats->failed++;
+    }
+    fflush(out);
+
+    bool ok = !reader.failed;
+    free(session.tokens);
+    free(session.items);
+    scheduler_destroy(session.sched);
+    ratings_destroy(session.ratings);
+    free(reader.buffer);
+    if (reader.fd != STDIN_FILENO) close(reader.fd);
+    return ok;
+}
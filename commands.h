@@ -0,0 +1,66 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "fulfillment.h"
+#include "inventory.h"
+#include "orders.h"
+#include "ratings.h"
+#include "scheduler.h"
+#include "search.h"
+#include "suppliers.h"
+
+// Line-oriented command language (--script). One command per line; verbs
+// are case-insensitive, arguments are separated by blanks and may be
+// double-quoted (with \" and \\ escapes). Blank lines and '#' comments
+// are ignored.
+//   ADD id name category supplierId price stock
+//   STOCK id newStock
+//   REMOVE id
+//   GET id
+//   UNDO
+//   SUPPLIER id name quality deliveryTime price reliability customerService
+//   WEIGHTS profile | quality deliveryTime price reliability customerService
+//   ENQUEUE orderId customer productId quantity [productId quantity ...]
+//   PROCESS [count|*]            FIFO, in batches (one undo step each)
+//   FULFILL [count|*]            in parallel on the worker pool
+//   SCHEDULE orderId customer priority deadlineMs productId quantity [...]
+//   REPRIORITIZE orderId priority deadlineMs
+//   CANCEL orderId
+//   DISPATCH [count|*]           by (priority, deadline, arrival)
+//   LATENCY class                submit-to-dispatch percentiles
+//   LOWSTOCK threshold [max]
+//   SEARCH price|name|supplier|id limit [filter ...]
+//                                first page; filters are min=, max=,
+//                                category=, prefix=, contains=, score=
+//                                (supplier) and instock
+//   MORE [limit]                 next page of the last SEARCH
+//   SUGGEST prefix [max]         names starting with prefix, in name order
+//   CONTAINS text [max]          names containing text, in id order
+//   RATINGS minQuality minDelivery minPrice minReliability minService [max]
+//   SKYLINE [max]                Pareto-optimal suppliers over the ratings
+//   COUNT
+//   STATS [reset]                counters, gauges and latency percentiles
+//                                as one JSON object (see metrics.h)
+//   QUIT
+// SCHEDULE and friends drive a priority scheduler that lives for the run
+// of the script, separate from the FIFO queue; priority is 0 (most urgent)
+// to SCHED_CLASSES - 1 and deadlineMs 0 means none.
+// Every command gets exactly one response line:
+//   OK <VERB> [key=value ...]
+//   ERR <VERB> line=<n> reason="..."
+#define COMMAND_BUFFER_BYTES (1024 * 1024)
+
+typedef struct CommandStats {
+    long long commands;
+    long long failed;
+} CommandStats;
+
+// Run commands from path ("-" reads stdin) until end of input or QUIT,
+// writing responses to out. pool may be NULL (FULFILL then fails).
+// Returns false if the input cannot be read.
+bool commands_run(const char* path, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq,
+                  FulfillmentPool* pool, FILE* out, CommandStats* stats);
+
+#endif // COMMANDS_H
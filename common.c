@@ -2,16 +2,39 @@
 #include <stdio.h>
 #include <string.h>
 
-double supplier_overall_score(const SupplierRatings *r) {
-	// Weighted average (weights sum to 1)
+typedef struct WeightProfile {
+	const char* name;
+	ScoreWeights weights;
+} WeightProfile;
+
+// Quality, delivery, price, reliability, service
+static const WeightProfile PROFILES[] = {
 	// Emphasize quality and reliability
-	const double wQuality = 0.3;
-	const double wReliability = 0.25;
-	const double wDelivery = 0.2;
-	const double wPrice = 0.15;
-	const double wService = 0.1;
-	return r->quality * wQuality + r->reliability * wReliability +
-	       r->deliveryTime * wDelivery + r->price * wPrice + r->customerService * wService;
+	{ "balanced", { 0.3, 0.2, 0.15, 0.25, 0.1 } },
+	{ "quality", { 0.45, 0.1, 0.05, 0.3, 0.1 } },
+	{ "cost", { 0.15, 0.1, 0.5, 0.15, 0.1 } },
+	{ "speed", { 0.15, 0.45, 0.1, 0.2, 0.1 } },
+};
+
+static ScoreWeights activeWeights = { 0.3, 0.2, 0.15, 0.25, 0.1 };
+
+double supplier_overall_score(const SupplierRatings *r) {
+	// Same operation order as the bulk rescoring kernels in suppliers.c,
+	// so both produce identical keys
+	const ScoreWeights* w = &activeWeights;
+	return r->quality * w->quality + r->reliability * w->reliability +
+	       r->deliveryTime * w->deliveryTime + r->price * w->price + r->customerService * w->customerService;
+}
+
+const ScoreWeights* score_weights(void) { return &activeWeights; }
+
+void score_weights_set(const ScoreWeights *w) { activeWeights = *w; }
+
+bool score_weights_profile(const char *name, ScoreWeights *out) {
+	for (size_t i = 0; i < sizeof(PROFILES) / sizeof(PROFILES[0]); i++) {
+		if (strcmp(name, PROFILES[i].name) == 0) { *out = PROFILES[i].weights; return true; }
+	}
+	return false;
 }
 
 void trim_newline(char *s) {
@@ -37,6 +60,23 @@ int safe_read_int() {
 	return x;
 }
 
+long long safe_read_llong() {
+	long long x;
+	while (scanf("%lld", &x) != 1) {
+		int c;
+		while ((c = getchar()) != '\n' && c != EOF) {}
+		printf("Invalid input. Enter an integer: ");
+	}
+	// Clear remaining whitespace/newline after successful read
+	int c;
+	while ((c = getchar()) == ' ' || c == '\t') {}
+	if (c != '\n' && c != EOF) {
+		// Put back the character if it's not whitespace or newline
+		ungetc(c, stdin);
+	}
+	return x;
+}
+
 double safe_read_double() {
 	double x;
 	while (scanf("%lf", &x) != 1) {
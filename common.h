@@ -7,8 +7,6 @@
 #define MAX_NAME_LEN 64
 #define MAX_CATEGORY_LEN 32
 #define MAX_SUPPLIER_NAME 64
-#define MAX_ORDER_ITEMS 16
-#define MAX_PRODUCTS 1024
 #define MAX_SUPPLIERS 512
 
 // ANSI color codes for CLI styling
@@ -23,8 +21,11 @@
 #define COL_CYAN  "\x1b[36m"
 #define COL_WHITE "\x1b[37m"
 
+// Product ids are sparse 64-bit SKUs
+typedef long long ProductId;
+
 typedef struct Product {
-	int id;
+	ProductId id;
 	char name[MAX_NAME_LEN];
 	char category[MAX_CATEGORY_LEN];
 	int supplierId;
@@ -33,15 +34,17 @@ typedef struct Product {
 } Product;
 
 typedef struct OrderItem {
-	int productId;
+	ProductId productId;
 	int quantity;
 } OrderItem;
 
+// items is borrowed: the caller's array when enqueuing, the queue's own
+// storage (valid until the next dequeue) once dequeued
 typedef struct Order {
 	int id;
 	char customer[MAX_NAME_LEN];
 	int numItems;
-	OrderItem items[MAX_ORDER_ITEMS];
+	OrderItem* items;
 } Order;
 
 typedef struct SupplierRatings {
@@ -53,6 +56,15 @@ typedef struct SupplierRatings {
 	double customerService;
 } SupplierRatings;
 
+// Per-criterion weights of the overall score; they sum to 1
+typedef struct ScoreWeights {
+	double quality;
+	double deliveryTime;
+	double price;
+	double reliability;
+	double customerService;
+} ScoreWeights;
+
 typedef struct Supplier {
 	int id;
 	char name[MAX_SUPPLIER_NAME];
@@ -60,9 +72,17 @@ typedef struct Supplier {
 } Supplier;
 
 // Utility
+// Weighted score under the active weights (0..10 for ratings in range)
 double supplier_overall_score(const SupplierRatings *r);
+const ScoreWeights* score_weights(void);
+// Change the active weights; go through suppliers_set_weights instead so
+// the supplier tree is rescored
+void score_weights_set(const ScoreWeights *w);
+// Built-in profiles: balanced (the default), quality, cost, speed
+bool score_weights_profile(const char *name, ScoreWeights *out);
 void trim_newline(char *s);
 int safe_read_int();
+long long safe_read_llong();
 double safe_read_double();
 
 #endif // COMMON_H
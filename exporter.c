@@ -0,0 +1,397 @@
+#include "exporter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define EXPORT_MAGIC "SCMSEXP2"
+// Records are encoded straight into fixed segments; a full set of segments
+// goes out in one writev
+#define EXPORT_SEGMENT_BYTES (256 * 1024)
+#define EXPORT_SEGMENTS 16
+// Upper bound on one encoded record (JSON escapes a byte to at most 6)
+#define EXPORT_RECORD_MAX 4096
+// Order items encoded per reservation; each stays well under 64 bytes
+#define EXPORT_ITEMS_PER_RESERVE 32
+
+typedef struct ExportWriter {
+    int fd;
+    char* memory;
+    struct iovec iov[EXPORT_SEGMENTS];
+    int segment;  // Segment being filled
+    bool failed;
+    long long bytes;
+} ExportWriter;
+
+typedef struct ExportContext {
+    ExportWriter* writer;
+    ExportFormat format;
+    ExportStats* stats;
+} ExportContext;
+
+static bool writer_init(ExportWriter* w, int fd) {
+    memset(w, 0, sizeof(ExportWriter));
+    w->fd = fd;
+    w->memory = (char*)malloc((size_t)EXPORT_SEGMENTS * EXPORT_SEGMENT_BYTES);
+    if (!w->memory) return false;
+    for (int i = 0; i < EXPORT_SEGMENTS; i++) {
+        w->iov[i].iov_base = w->memory + (size_t)i * EXPORT_SEGMENT_BYTES;
+    }
+    return true;
+}
+
+static bool writer_flush(ExportWriter* w) {
+    struct iovec pending[EXPORT_SEGMENTS];
+    int count = 0;
+    for (int i = 0; i <= w->segment && i < EXPORT_SEGMENTS; i++) {
+        if (w->iov[i].iov_len > 0) pending[count++] = w->iov[i];
+        w->iov[i].iov_len = 0;
+    }
+    w->segment = 0;
+
+    // writev may stop short; resume from the first unwritten byte
+    struct iovec* next = pending;
+    while (count > 0 && !w->failed) {
+        ssize_t n = writev(w->fd, next, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            w->failed = true;
+            break;
+        }
+        w->bytes += n;
+        while (count > 0 && (size_t)n >= next->iov_len) {
+            n -= (ssize_t)next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (char*)next->iov_base + n;
+            next->iov_len -= (size_t)n;
+        }
+    }
+    return !w->failed;
+}
+
+// Room for one record at the end of the current segment
+static char* writer_reserve(ExportWriter* w) {
+    if (w->iov[w->segment].iov_len + EXPORT_RECORD_MAX > EXPORT_SEGMENT_BYTES) {
+        if (++w->segment == EXPORT_SEGMENTS) writer_flush(w);
+    }
+    return (char*)w->iov[w->segment].iov_base + w->iov[w->segment].iov_len;
+}
+
+static void writer_commit(ExportWriter* w, const char* end) {
+    w->iov[w->segment].iov_len = (size_t)(end - (char*)w->iov[w->segment].iov_base);
+}
+
+// Formatting helpers, each returning the new end of the output
+static char* put_raw(char* p, const void* src, size_t n) {
+    memcpy(p, src, n);
+    return p + n;
+}
+
+static char* put_text(char* p, const char* s) {
+    return put_raw(p, s, strlen(s));
+}
+
+static char* put_llong(char* p, long long v) {
+    char digits[24];
+    int n = 0;
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) *p++ = '-';
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+// Prices and ratings are almost always whole cents: those are formatted
+// with integer arithmetic and still parse back to the same double
+static char* put_double(char* p, double v) {
+    double cents = v * 100.0;
+    if (cents > -9e15 && cents < 9e15) {
+        long long c = (long long)(cents < 0 ? cents - 0.5 : cents + 0.5);
+        if ((double)c / 100.0 == v) {
+            unsigned long long u = c < 0 ? 0ULL - (unsigned long long)c : (unsigned long long)c;
+            if (c < 0) *p++ = '-';
+            p = put_llong(p, (long long)(u / 100));
+            *p++ = '.';
+            *p++ = (char)('0' + u / 10 % 10);
+            *p++ = (char)('0' + u % 10);
+            return p;
+        }
+    }
+    return p + snprintf(p, 32, "%.17g", v);
+}
+
+static char* put_csv_field(char* p, const char* s) {
+    if (!strpbrk(s, ",\"\r\n")) return put_text(p, s);
+    *p++ = '"';
+    for (; *s; s++) {
+        if (*s == '"') *p++ = '"';
+        *p++ = *s;
+    }
+    *p++ = '"';
+    return p;
+}
+
+static char* put_json_string(char* p, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    *p++ = '"';
+    for (const unsigned char* c = (const unsigned char*)s; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)*c;
+        } else if (*c < 0x20) {
+            p = put_text(p, "\\u00");
+            *p++ = hex[*c >> 4];
+            *p++ = hex[*c & 15];
+        } else {
+            *p++ = (char)*c;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+static char* put_bin_string(char* p, const char* s) {
+    uint16_t len = (uint16_t)strlen(s);
+    p = put_raw(p, &len, sizeof(len));
+    return put_raw(p, s, len);
+}
+
+static char* put_i32(char* p, int32_t v) { return put_raw(p, &v, sizeof(v)); }
+static char* put_i64(char* p, int64_t v) { return put_raw(p, &v, sizeof(v)); }
+static char* put_f64(char* p, double v) { return put_raw(p, &v, sizeof(v)); }
+
+static void export_product(Product* pr, void* arg) {
+    ExportContext* ctx = (ExportContext*)arg;
+    char* p = writer_reserve(ctx->writer);
+    switch (ctx->format) {
+        case EXPORT_CSV:
+            p = put_text(p, "P,");
+            p = put_llong(p, pr->id);
+            *p++ = ',';
+            p = put_csv_field(p, pr->name);
+            *p++ = ',';
+            p = put_csv_field(p, pr->category);
+            *p++ = ',';
+            p = put_llong(p, pr->supplierId);
+            *p++ = ',';
+            p = put_double(p, pr->price);
+            *p++ = ',';
+            p = put_llong(p, pr->stock);
+            *p++ = '\n';
+            break;
+        case EXPORT_JSONL:
+            p = put_text(p, "{\"type\":\"product\",\"id\":");
+            p = put_llong(p, pr->id);
+            p = put_text(p, ",\"name\":");
+            p = put_json_string(p, pr->name);
+            p = put_text(p, ",\"category\":");
+            p = put_json_string(p, pr->category);
+            p = put_text(p, ",\"supplierId\":");
+            p = put_llong(p, pr->supplierId);
+            p = put_text(p, ",\"price\":");
+            p = put_double(p, pr->price);
+            p = put_text(p, ",\"stock\":");
+            p = put_llong(p, pr->stock);
+            p = put_text(p, "}\n");
+            break;
+        case EXPORT_BINARY:
+            *p++ = 'P';
+            p = put_i64(p, pr->id);
+            p = put_bin_string(p, pr->name);
+            p = put_bin_string(p, pr->category);
+            p = put_i32(p, pr->supplierId);
+            p = put_f64(p, pr->price);
+            p = put_i32(p, pr->stock);
+            break;
+    }
+    writer_commit(ctx->writer, p);
+    ctx->stats->products++;
+}
+
+static void export_supplier(const Supplier* s, void* arg) {
+    ExportContext* ctx = (ExportContext*)arg;
+    const SupplierRatings* r = &s->ratings;
+    char* p = writer_reserve(ctx->writer);
+    switch (ctx->format) {
+        case EXPORT_CSV:
+            p = put_text(p, "S,");
+            p = put_llong(p, s->id);
+            *p++ = ',';
+            p = put_csv_field(p, s->name);
+            *p++ = ',';
+            p = put_double(p, r->quality);
+            *p++ = ',';
+            p = put_double(p, r->deliveryTime);
+            *p++ = ',';
+            p = put_double(p, r->price);
+            *p++ = ',';
+            p = put_double(p, r->reliability);
+            *p++ = ',';
+            p = put_double(p, r->customerService);
+            *p++ = '\n';
+            break;
+        case EXPORT_JSONL:
+            p = put_text(p, "{\"type\":\"supplier\",\"id\":");
+            p = put_llong(p, s->id);
+            p = put_text(p, ",\"name\":");
+            p = put_json_string(p, s->name);
+            p = put_text(p, ",\"quality\":");
+            p = put_double(p, r->quality);
+            p = put_text(p, ",\"deliveryTime\":");
+            p = put_double(p, r->deliveryTime);
+            p = put_text(p, ",\"price\":");
+            p = put_double(p, r->price);
+            p = put_text(p, ",\"reliability\":");
+            p = put_double(p, r->reliability);
+            p = put_text(p, ",\"customerService\":");
+            p = put_double(p, r->customerService);
+            p = put_text(p, "}\n");
+            break;
+        case EXPORT_BINARY:
+            *p++ = 'S';
+            p = put_i32(p, s->id);
+            p = put_bin_string(p, s->name);
+            p = put_f64(p, r->quality);
+            p = put_f64(p, r->deliveryTime);
+            p = put_f64(p, r->price);
+            p = put_f64(p, r->reliability);
+            p = put_f64(p, r->customerService);
+            break;
+    }
+    writer_commit(ctx->writer, p);
+    ctx->stats->suppliers++;
+}
+
+static void export_order(const Order* o, void* arg) {
+    ExportContext* ctx = (ExportContext*)arg;
+    ExportWriter* w = ctx->writer;
+    char* p = writer_reserve(w);
+    switch (ctx->format) {
+        case EXPORT_CSV:
+            p = put_text(p, "O,");
+            p = put_llong(p, o->id);
+            *p++ = ',';
+            p = put_csv_field(p, o->customer);
+            for (int i = 0; i < o->numItems; i++) {
+                if (i % EXPORT_ITEMS_PER_RESERVE == 0) {
+                    writer_commit(w, p);
+                    p = writer_reserve(w);
+                }
+                *p++ = ',';
+                p = put_llong(p, o->items[i].productId);
+                *p++ = ',';
+                p = put_llong(p, o->items[i].quantity);
+            }
+            *p++ = '\n';
+            break;
+        case EXPORT_JSONL:
+            p = put_text(p, "{\"type\":\"order\",\"id\":");
+            p = put_llong(p, o->id);
+            p = put_text(p, ",\"customer\":");
+            p = put_json_string(p, o->customer);
+            p = put_text(p, ",\"items\":[");
+            for (int i = 0; i < o->numItems; i++) {
+                if (i % EXPORT_ITEMS_PER_RESERVE == 0) {
+                    writer_commit(w, p);
+                    p = writer_reserve(w);
+                }
+                if (i > 0) *p++ = ',';
+                p = put_text(p, "{\"productId\":");
+                p = put_llong(p, o->items[i].productId);
+                p = put_text(p, ",\"quantity\":");
+                p = put_llong(p, o->items[i].quantity);
+                *p++ = '}';
+            }
+            p = put_text(p, "]}\n");
+            break;
+        case EXPORT_BINARY: {
+            uint32_t items = (uint32_t)o->numItems;
+            *p++ = 'O';
+            p = put_i32(p, o->id);
+            p = put_bin_string(p, o->customer);
+            p = put_raw(p, &items, sizeof(items));
+            for (int i = 0; i < o->numItems; i++) {
+                if (i % EXPORT_ITEMS_PER_RESERVE == 0) {
+                    writer_commit(w, p);
+                    p = writer_reserve(w);
+                }
+                p = put_i64(p, o->items[i].productId);
+                p = put_i32(p, o->items[i].quantity);
+            }
+            break;
+        }
+    }
+    writer_commit(w, p);
+    ctx->stats->orders++;
+}
+
+bool export_parse_format(const char* name, ExportFormat* out) {
+    if (strcmp(name, "csv") == 0) *out = EXPORT_CSV;
+    else if (strcmp(name, "jsonl") == 0 || strcmp(name, "json") == 0) *out = EXPORT_JSONL;
+    else if (strcmp(name, "bin") == 0 || strcmp(name, "binary") == 0) *out = EXPORT_BINARY;
+    else return false;
+    return true;
+}
+
+ExportFormat export_format_for_path(const char* path) {
+    const char* dot = strrchr(path, '.');
+    ExportFormat format = EXPORT_CSV;
+    if (dot && !strchr(dot, '/')) export_parse_format(dot + 1, &format);
+    return format;
+}
+
+bool export_data(const char* path, ExportFormat format, Inventory* inv, SuppliersDB* sdb,
+                 OrdersQueue* oq, ExportStats* stats) {
+    ExportStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(ExportStats));
+    if (!path || !inv || !sdb || !oq) return false;
+
+    bool toStdout = strcmp(path, "-") == 0;
+    int fd;
+    if (toStdout) {
+        // Anything already printed must come out ahead of the raw writes
+        fflush(stdout);
+        fd = STDOUT_FILENO;
+    } else {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+    }
+
+    ExportWriter writer;
+    if (!writer_init(&writer, fd)) {
+        if (!toStdout) close(fd);
+        return false;
+    }
+
+    ExportContext ctx = { &writer, format, stats };
+    char* p = writer_reserve(&writer);
+    if (format == EXPORT_BINARY) {
+        p = put_raw(p, EXPORT_MAGIC, strlen(EXPORT_MAGIC));
+    } else if (format == EXPORT_CSV) {
+        p = put_text(p, "# P,id,name,category,supplierId,price,stock\n"
+                        "# S,id,name,quality,deliveryTime,price,reliability,customerService\n"
+                        "# O,id,customer,productId,quantity[,productId,quantity...]\n");
+    }
+    writer_commit(&writer, p);
+
+    inventory_for_each(inv, export_product, &ctx);
+    suppliers_for_each(sdb, export_supplier, &ctx);
+    orders_for_each(oq, export_order, &ctx);
+
+    bool ok = writer_flush(&writer);
+    stats->bytes = writer.bytes;
+    free(writer.memory);
+    if (!toStdout && close(fd) != 0) ok = false;
+    return ok;
+}
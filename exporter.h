@@ -0,0 +1,39 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <stdbool.h>
+#include "inventory.h"
+#include "orders.h"
+#include "suppliers.h"
+
+// Data export (--export). Products are written in id order, suppliers in
+// ascending score order and orders in FIFO order.
+//   CSV    the tagged rows read by --import, so exports round-trip
+//   JSONL  one object per line with a "type" of product/supplier/order
+//   binary "SCMSEXP2", then per record a tag byte ('P', 'S', 'O') and
+//          fields in native byte order; strings are a u16 length plus bytes,
+//          an order's items a u32 count plus the items
+typedef enum {
+    EXPORT_CSV,
+    EXPORT_JSONL,
+    EXPORT_BINARY
+} ExportFormat;
+
+typedef struct ExportStats {
+    long long products;
+    long long suppliers;
+    long long orders;
+    long long bytes;
+} ExportStats;
+
+// Parse "csv", "jsonl" or "bin"
+bool export_parse_format(const char* name, ExportFormat* out);
+// Guess from the extension (.jsonl/.json, .bin); CSV otherwise
+ExportFormat export_format_for_path(const char* path);
+
+// Write everything to path ("-" streams to stdout) through a segmented
+// buffer flushed with writev. Returns false on any open or write error.
+bool export_data(const char* path, ExportFormat format, Inventory* inv, SuppliersDB* sdb,
+                 OrdersQueue* oq, ExportStats* stats);
+
+#endif // EXPORTER_H
@@ -0,0 +1,452 @@
+#include "fulfillment.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// Orders claimed per atomic fetch-add on the batch cursor
+#define FULFILL_CLAIM 32
+// Orders up to this many items are sorted by insertion, larger ones by qsort
+#define FULFILL_SMALL_ORDER 16
+
+// One mutex per cache line so neighbouring stripes do not false-share
+typedef struct StripeLock {
+    pthread_mutex_t mutex;
+} __attribute__((aligned(64))) StripeLock;
+
+// Stock taken from a product by one fulfilled order
+typedef struct Deduction {
+    ProductId productId;
+    int quantity;
+} Deduction;
+
+typedef struct WorkerState {
+    struct FulfillmentPool* pool;
+    Deduction* log;
+    size_t count;
+    size_t capacity;
+    // Per-order scratch, grown to the largest order seen
+    OrderItem* items;
+    Product** products;
+    int* stripes;
+    int scratchCapacity;
+    long long fulfilled;
+    long long failed;
+} WorkerState;
+
+struct FulfillmentPool {
+    Inventory* inv;
+    int workers;          // Including the thread that calls drain
+    pthread_t* threads;
+    int started;          // Helper threads actually running
+    WorkerState* state;   // [0] belongs to the calling thread
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // New batch or shutdown
+    pthread_cond_t idle;  // Last helper finished the batch
+    unsigned long generation;
+    int running;
+    bool shutdown;
+
+    // Current batch
+    Order* orders;
+    int orderCount;
+    int orderCapacity;
+    int next;             // Batch cursor, advanced atomically
+    StockChange* changes; // Net stock per product, applied at commit
+    int changeCount;
+    size_t changeCapacity;
+
+    StripeLock stripes[FULFILL_STRIPES];
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int stripe_of(ProductId id) {
+    // Fibonacci hashing so neighbouring ids land on distant stripes
+    return (int)(((uint64_t)id * 0x9E3779B97F4A7C15ULL) >> 54) & (FULFILL_STRIPES - 1);
+}
+
+static bool log_reserve(WorkerState* w, size_t extra) {
+    if (w->count + extra <= w->capacity) return true;
+    size_t capacity = w->capacity ? w->capacity * 2 : 256;
+    while (capacity < w->count + extra) capacity *= 2;
+    Deduction* log = (Deduction*)realloc(w->log, capacity * sizeof(Deduction));
+    if (!log) return false;
+    w->log = log;
+    w->capacity = capacity;
+    return true;
+}
+
+static bool scratch_reserve(WorkerState* w, int n) {
+    if (n <= w->scratchCapacity) return true;
+    OrderItem* items = (OrderItem*)realloc(w->items, (size_t)n * sizeof(OrderItem));
+    if (items) w->items = items;
+    Product** products = (Product**)realloc(w->products, (size_t)n * sizeof(Product*));
+    if (products) w->products = products;
+    int* stripes = (int*)realloc(w->stripes, (size_t)n * sizeof(int));
+    if (stripes) w->stripes = stripes;
+    if (!items || !products || !stripes) return false;
+    w->scratchCapacity = n;
+    return true;
+}
+
+static int item_cmp(const void* a, const void* b) {
+    ProductId x = ((const OrderItem*)a)->productId;
+    ProductId y = ((const OrderItem*)b)->productId;
+    return (x > y) - (x < y);
+}
+
+static int int_cmp(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Sort n items by product id, merging repeats into one requirement;
+// returns the merged count
+static int sort_items(OrderItem* items, int n) {
+    if (n > FULFILL_SMALL_ORDER) {
+        qsort(items, (size_t)n, sizeof(OrderItem), item_cmp);
+    } else {
+        for (int i = 1; i < n; i++) {
+            OrderItem it = items[i];
+            int j = i;
+            while (j > 0 && items[j - 1].productId > it.productId) {
+                items[j] = items[j - 1];
+                j--;
+            }
+            items[j] = it;
+        }
+    }
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (count > 0 && items[count - 1].productId == items[i].productId) {
+            items[count - 1].quantity += items[i].quantity;
+        } else {
+            items[count++] = items[i];
+        }
+    }
+    return count;
+}
+
+static int sort_stripes(int* stripes, int n) {
+    if (n > FULFILL_SMALL_ORDER) {
+        qsort(stripes, (size_t)n, sizeof(int), int_cmp);
+    } else {
+        for (int i = 1; i < n; i++) {
+            int s = stripes[i];
+            int j = i;
+            while (j > 0 && stripes[j - 1] > s) {
+                stripes[j] = stripes[j - 1];
+                j--;
+            }
+            stripes[j] = s;
+        }
+    }
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (count == 0 || stripes[count - 1] != stripes[i]) stripes[count++] = stripes[i];
+    }
+    return count;
+}
+
+// All-or-nothing reservation of one order's items
+static void fulfill_order(WorkerState* w, const Order* o) {
+    Inventory* inv = w->pool->inv;
+    if (!scratch_reserve(w, o->numItems)) {
+        w->failed++;
+        return;
+    }
+    OrderItem* items = w->items;
+    Product** products = w->products;
+    int* stripes = w->stripes;
+    if (o->numItems > 0) memcpy(items, o->items, (size_t)o->numItems * sizeof(OrderItem));
+    int count = sort_items(items, o->numItems);
+
+    // The index is not modified during a batch, so lookups need no lock
+    for (int i = 0; i < count; i++) {
+        products[i] = inventory_get_product(inv, items[i].productId);
+        if (!products[i]) {
+            w->failed++;
+            return;
+        }
+        stripes[i] = stripe_of(items[i].productId);
+    }
+    int stripeCount = sort_stripes(stripes, count);
+    if (!log_reserve(w, (size_t)count)) {
+        w->failed++;
+        return;
+    }
+
+    // Canonical (ascending) lock order rules out deadlock between workers
+    for (int i = 0; i < stripeCount; i++) {
+        pthread_mutex_lock(&w->pool->stripes[stripes[i]].mutex);
+    }
+    bool available = true;
+    for (int i = 0; i < count && available; i++) {
+        if (products[i]->stock < items[i].quantity) available = false;
+    }
+    if (available) {
+        for (int i = 0; i < count; i++) {
+            products[i]->stock -= items[i].quantity;
+            w->log[w->count].productId = items[i].productId;
+            w->log[w->count].quantity = items[i].quantity;
+            w->count++;
+        }
+    }
+    for (int i = stripeCount - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&w->pool->stripes[stripes[i]].mutex);
+    }
+
+    if (available) w->fulfilled++;
+    else w->failed++;
+}
+
+static void run_batch(WorkerState* w) {
+    FulfillmentPool* pool = w->pool;
+    for (;;) {
+        int first = __atomic_fetch_add(&pool->next, FULFILL_CLAIM, __ATOMIC_RELAXED);
+        if (first >= pool->orderCount) break;
+        int last = first + FULFILL_CLAIM;
+        if (last > pool->orderCount) last = pool->orderCount;
+        for (int i = first; i < last; i++) {
+            fulfill_order(w, &pool->orders[i]);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    WorkerState* w = (WorkerState*)arg;
+    FulfillmentPool* pool = w->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_batch(w);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+FulfillmentPool* fulfillment_create(Inventory* inv, int workers) {
+    if (!inv) return NULL;
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    if (workers > FULFILL_MAX_WORKERS) workers = FULFILL_MAX_WORKERS;
+
+    FulfillmentPool* pool = (FulfillmentPool*)aligned_alloc(64, sizeof(FulfillmentPool));
+    if (!pool) return NULL;
+    memset(pool, 0, sizeof(FulfillmentPool));
+    pool->inv = inv;
+    pool->state = (WorkerState*)calloc((size_t)workers, sizeof(WorkerState));
+    pool->threads = (pthread_t*)calloc((size_t)workers, sizeof(pthread_t));
+    if (!pool->state || !pool->threads) {
+        free(pool->state);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    for (int i = 0; i < FULFILL_STRIPES; i++) {
+        pthread_mutex_init(&pool->stripes[i].mutex, NULL);
+    }
+
+    // Helpers that fail to start just leave fewer workers
+    pool->workers = 1;
+    pool->state[0].pool = pool;
+    for (int i = 1; i < workers; i++) {
+        WorkerState* w = &pool->state[pool->workers];
+        w->pool = pool;
+        if (pthread_create(&pool->threads[pool->started], NULL, worker_main, w) != 0) break;
+        pool->started++;
+        pool->workers++;
+    }
+    return pool;
+}
+
+void fulfillment_destroy(FulfillmentPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < FULFILL_STRIPES; i++) {
+        pthread_mutex_destroy(&pool->stripes[i].mutex);
+    }
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    for (int i = 0; i < pool->workers; i++) {
+        free(pool->state[i].log);
+        free(pool->state[i].items);
+        free(pool->state[i].products);
+        free(pool->state[i].stripes);
+    }
+    free(pool->state);
+    free(pool->threads);
+    free(pool->orders);
+    free(pool->changes);
+    free(pool);
+}
+
+int fulfillment_workers(FulfillmentPool* pool) {
+    return pool ? pool->workers : 0;
+}
+
+static int deduction_cmp(const void* a, const void* b) {
+    ProductId x = ((const Deduction*)a)->productId;
+    ProductId y = ((const Deduction*)b)->productId;
+    return (x > y) - (x < y);
+}
+
+// Merge the workers' sorted logs and visit each product's total deduction
+static void for_each_deduction(FulfillmentPool* pool, void (*visit)(FulfillmentPool*, Product*, int)) {
+    size_t cursor[FULFILL_MAX_WORKERS] = {0};
+    for (;;) {
+        bool any = false;
+        ProductId id = 0;
+        for (int i = 0; i < pool->workers; i++) {
+            WorkerState* w = &pool->state[i];
+            if (cursor[i] < w->count && (!any || w->log[cursor[i]].productId < id)) {
+                id = w->log[cursor[i]].productId;
+                any = true;
+            }
+        }
+        if (!any) return;
+
+        int taken = 0;
+        for (int i = 0; i < pool->workers; i++) {
+            WorkerState* w = &pool->state[i];
+            while (cursor[i] < w->count && w->log[cursor[i]].productId == id) {
+                taken += w->log[cursor[i]++].quantity;
+            }
+        }
+        Product* p = inventory_get_product(pool->inv, id);
+        if (p) visit(pool, p, taken);
+    }
+}
+
+static void restore_stock(FulfillmentPool* pool, Product* p, int taken) {
+    (void)pool;
+    p->stock += taken;
+}
+
+static void plan_stock(FulfillmentPool* pool, Product* p, int taken) {
+    StockChange* change = &pool->changes[pool->changeCount++];
+    change->product = p;
+    change->newStock = p->stock - taken;
+}
+
+// Workers changed stock in place, behind the heap's back. Put every
+// touched product back to its pre-batch stock, which is what the heap
+// and column store still reflect, then apply the net changes as one
+// grouped inventory_update_stocks for the heap, undo and log bookkeeping.
+// False, with every product at its pre-batch stock, if out of memory.
+static bool commit_batch(FulfillmentPool* pool) {
+    size_t total = 0;
+    for (int i = 0; i < pool->workers; i++) {
+        WorkerState* w = &pool->state[i];
+        if (w->count > 1) qsort(w->log, w->count, sizeof(Deduction), deduction_cmp);
+        total += w->count;
+    }
+    for_each_deduction(pool, restore_stock);
+    if (total > INT_MAX) return false;
+    if (total > pool->changeCapacity) {
+        StockChange* changes = (StockChange*)realloc(pool->changes, total * sizeof(StockChange));
+        if (!changes) return false;
+        pool->changes = changes;
+        pool->changeCapacity = total;
+    }
+    pool->changeCount = 0;
+    for_each_deduction(pool, plan_stock);
+    return inventory_update_stocks(pool->inv, pool->changes, pool->changeCount);
+}
+
+int fulfillment_drain(FulfillmentPool* pool, OrdersQueue* q, int maxOrders, FulfillmentStats* stats) {
+    FulfillmentStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(FulfillmentStats));
+    if (!pool || !q) return 0;
+    double start = now_seconds();
+
+    // Take the batch off the queue in FIFO order; orders that arrive while
+    // it is being taken wait for the next drain
+    int want = orders_count(q);
+    if (maxOrders > 0 && maxOrders < want) want = maxOrders;
+    if (want > pool->orderCapacity) {
+        Order* orders = (Order*)realloc(pool->orders, (size_t)want * sizeof(Order));
+        if (!orders) return 0;
+        pool->orders = orders;
+        pool->orderCapacity = want;
+    }
+    // The batch's dequeues and stock changes go to the log as one record
+    orders_begin_process(q);
+    pool->orderCount = orders_dequeue_batch(q, pool->orders, want);
+    if (pool->orderCount == 0) {
+        orders_commit_process(q);
+        return 0;
+    }
+
+    for (int i = 0; i < pool->workers; i++) {
+        pool->state[i].count = 0;
+        pool->state[i].fulfilled = pool->state[i].failed = 0;
+    }
+    pool->next = 0;
+
+    // Wake the helpers, work alongside them, then wait for the stragglers
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pool->running = pool->started;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_batch(&pool->state[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    bool committed = commit_batch(pool);
+    orders_commit_process(q);
+
+    if (committed) {
+        for (int i = 0; i < pool->workers; i++) {
+            stats->fulfilled += pool->state[i].fulfilled;
+            stats->failed += pool->state[i].failed;
+        }
+    } else {
+        // Out of memory: no stock changed, so the whole batch failed
+        stats->failed = pool->orderCount;
+    }
+    METRIC_ADD(METRIC_ORDERS_FULFILLED, stats->fulfilled);
+    METRIC_ADD(METRIC_ORDERS_FAILED, stats->failed);
+    stats->seconds = now_seconds() - start;
+    return pool->orderCount;
+}
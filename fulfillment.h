@@ -0,0 +1,37 @@
+#ifndef FULFILLMENT_H
+#define FULFILLMENT_H
+
+#include <stdbool.h>
+#include "inventory.h"
+#include "orders.h"
+
+// Parallel order fulfillment. A pool of worker threads drains a batch of
+// queued orders; each order locks the stripes covering its products in
+// ascending stripe order (so workers cannot deadlock), checks every item
+// and deducts all of them or none. Orders in a batch may complete in any
+// order relative to each other. Heap, undo and log bookkeeping is applied
+// on the calling thread once the batch is done.
+#define FULFILL_STRIPES 1024
+#define FULFILL_MAX_WORKERS 64
+
+typedef struct FulfillmentPool FulfillmentPool;
+
+typedef struct FulfillmentStats {
+    long long fulfilled;
+    long long failed;
+    double seconds;
+} FulfillmentStats;
+
+// workers counts the calling thread; 0 picks one per online CPU
+FulfillmentPool* fulfillment_create(Inventory* inv, int workers);
+void fulfillment_destroy(FulfillmentPool* pool);
+int fulfillment_workers(FulfillmentPool* pool);
+
+// Dequeue up to maxOrders (all if <= 0) and fulfill them in parallel. The
+// batch's stock changes are one undo step; should they not fit in memory
+// every order in the batch is reported failed and no stock changes. The
+// inventory and queue must not be used by other threads meanwhile.
+// Returns the number of orders taken from the queue.
+int fulfillment_drain(FulfillmentPool* pool, OrdersQueue* q, int maxOrders, FulfillmentStats* stats);
+
+#endif // FULFILLMENT_H
@@ -0,0 +1,45 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// Log-linear histogram buckets shared by the scheduler's dispatch latency
+// and the metrics module: values below HIST_SUB get a bucket each, and
+// every power of two above that is split into HIST_SUB linear
+// sub-buckets, so a reported percentile is within 12.5% of the true value.
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+static inline int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// Largest value that falls in bucket b
+static inline uint64_t hist_upper(int b) {
+    if (b < HIST_SUB) return (uint64_t)b;
+    int e = b / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + b % HIST_SUB) << (e - HIST_SUB_BITS);
+    return low + (1ULL << (e - HIST_SUB_BITS)) - 1;
+}
+
+// Value at quantile q of the count samples in buckets, capped at the
+// largest sample seen; 0 when there are none
+static inline uint64_t hist_percentile(const uint64_t* buckets, uint64_t count, uint64_t max, double q) {
+    if (count == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)count + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            uint64_t v = hist_upper(b);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,399 @@
+#include "importer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define IMPORT_INITIAL_ROWS 1024
+
+// A parsed order; its items sit in the batch's item array, which may move
+// while the slice is parsed, so they are found by index
+typedef struct ImportOrder {
+    Order order;
+    int firstItem;
+} ImportOrder;
+
+// Rows parsed from one slice of a chunk. Batches are reused for every chunk,
+// so memory stays proportional to the chunk size, not the file size.
+typedef struct ImportBatch {
+    char* begin;
+    char* end;
+    Product* products;
+    int productCount;
+    int productCapacity;
+    Supplier* suppliers;
+    int supplierCount;
+    int supplierCapacity;
+    ImportOrder* orders;
+    int orderCount;
+    int orderCapacity;
+    OrderItem* items;
+    int itemCount;
+    int itemCapacity;
+    char** fields;
+    int fieldCapacity;
+    long long lines;
+    long long rejected;
+    bool failed;  // Out of memory
+} ImportBatch;
+
+static bool batch_grow(void** items, int* capacity, size_t itemSize) {
+    int grown = *capacity ? *capacity * 2 : IMPORT_INITIAL_ROWS;
+    void* p = realloc(*items, (size_t)grown * itemSize);
+    if (!p) return false;
+    *items = p;
+    *capacity = grown;
+    return true;
+}
+
+// Field parsers; the whole field must be consumed
+static bool parse_llong(const char* s, long long* out) {
+    if (!*s) return false;
+    char* end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (*end || errno) return false;
+    *out = v;
+    return true;
+}
+
+static bool parse_int(const char* s, int* out) {
+    long long v;
+    if (!parse_llong(s, &v) || v < INT_MIN || v > INT_MAX) return false;
+    *out = (int)v;
+    return true;
+}
+
+static bool parse_double(const char* s, double* out) {
+    if (!*s) return false;
+    char* end;
+    double v = strtod(s, &end);
+    if (*end || !isfinite(v)) return false;
+    *out = v;
+    return true;
+}
+
+static void copy_text(char* dst, size_t size, const char* src) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+// Split a NUL-terminated line into the batch's fields in place, unquoting
+// as it goes. Returns the field count, -1 on a broken quote or -2 if out
+// of memory.
+static int split_fields(ImportBatch* b, char* line) {
+    int count = 0;
+    char* p = line;
+    for (;;) {
+        if (count == b->fieldCapacity &&
+            !batch_grow((void**)&b->fields, &b->fieldCapacity, sizeof(char*))) return -2;
+        char** fields = b->fields;
+        if (*p != '"') {
+            fields[count++] = p;
+            char* comma = strchr(p, ',');
+            if (!comma) return count;
+            *comma = '\0';
+            p = comma + 1;
+            continue;
+        }
+
+        char* out = ++p;
+        fields[count++] = out;
+        for (;;) {
+            if (!*p) return -1;
+            if (*p == '"') {
+                if (p[1] != '"') break;
+                p++;
+            }
+            *out++ = *p++;
+        }
+        *out = '\0';
+        p++;
+        if (!*p) return count;
+        if (*p != ',') return -1;
+        p++;
+    }
+}
+
+static bool parse_product(char** f, int n, Product* p) {
+    if (n != 7) return false;
+    memset(p, 0, sizeof(Product));
+    if (!parse_llong(f[1], &p->id)) return false;
+    copy_text(p->name, sizeof(p->name), f[2]);
+    copy_text(p->category, sizeof(p->category), f[3]);
+    return parse_int(f[4], &p->supplierId) &&
+           parse_double(f[5], &p->price) &&
+           parse_int(f[6], &p->stock);
+}
+
+static bool parse_supplier(char** f, int n, Supplier* s) {
+    if (n != 8) return false;
+    memset(s, 0, sizeof(Supplier));
+    if (!parse_int(f[1], &s->id)) return false;
+    copy_text(s->name, sizeof(s->name), f[2]);
+    return parse_double(f[3], &s->ratings.quality) &&
+           parse_double(f[4], &s->ratings.deliveryTime) &&
+           parse_double(f[5], &s->ratings.price) &&
+           parse_double(f[6], &s->ratings.reliability) &&
+           parse_double(f[7], &s->ratings.customerService);
+}
+
+static bool parse_order(ImportBatch* b, char** f, int n, ImportOrder* io) {
+    if (n < 5 || (n - 3) % 2 != 0) return false;
+    Order* o = &io->order;
+    memset(o, 0, sizeof(Order));
+    if (!parse_int(f[1], &o->id)) return false;
+    copy_text(o->customer, sizeof(o->customer), f[2]);
+    int numItems = (n - 3) / 2;
+    while (b->itemCount + numItems > b->itemCapacity) {
+        if (!batch_grow((void**)&b->items, &b->itemCapacity, sizeof(OrderItem))) {
+            b->failed = true;
+            return false;
+        }
+    }
+    io->firstItem = b->itemCount;
+    for (int i = 3; i < n; i += 2) {
+        OrderItem* item = &b->items[io->firstItem + o->numItems++];
+        if (!parse_llong(f[i], &item->productId)) return false;
+        if (!parse_int(f[i + 1], &item->quantity) || item->quantity <= 0) return false;
+    }
+    b->itemCount += numItems;
+    return true;
+}
+
+static void parse_line(ImportBatch* b, char* line) {
+    if (!*line || *line == '#') return;
+
+    int n = split_fields(b, line);
+    if (n == -2) {
+        b->failed = true;
+        return;
+    }
+    char** fields = b->fields;
+    bool ok = false;
+    if (n > 0 && fields[0][0] && !fields[0][1]) {
+        switch (fields[0][0]) {
+            case 'P':
+            case 'p':
+                if (b->productCount == b->productCapacity &&
+                    !batch_grow((void**)&b->products, &b->productCapacity, sizeof(Product))) {
+                    b->failed = true;
+                    return;
+                }
+                ok = parse_product(fields, n, &b->products[b->productCount]);
+                if (ok) b->productCount++;
+                break;
+            case 'S':
+            case 's':
+                if (b->supplierCount == b->supplierCapacity &&
+                    !batch_grow((void**)&b->suppliers, &b->supplierCapacity, sizeof(Supplier))) {
+                    b->failed = true;
+                    return;
+                }
+                ok = parse_supplier(fields, n, &b->suppliers[b->supplierCount]);
+                if (ok) b->supplierCount++;
+                break;
+            case 'O':
+            case 'o':
+                if (b->orderCount == b->orderCapacity &&
+                    !batch_grow((void**)&b->orders, &b->orderCapacity, sizeof(ImportOrder))) {
+                    b->failed = true;
+                    return;
+                }
+                ok = parse_order(b, fields, n, &b->orders[b->orderCount]);
+                if (ok) b->orderCount++;
+                break;
+        }
+    }
+    if (!ok) b->rejected++;
+}
+
+// Thread body: parse every line of one slice. The byte at `end` is
+// writable, so the last line can be terminated in place.
+static void* parse_slice(void* arg) {
+    ImportBatch* b = (ImportBatch*)arg;
+    char* line = b->begin;
+    while (line < b->end && !b->failed) {
+        char* stop = (char*)memchr(line, '\n', (size_t)(b->end - line));
+        if (!stop) stop = b->end;
+        *stop = '\0';
+        if (stop > line && stop[-1] == '\r') stop[-1] = '\0';
+        b->lines++;
+        parse_line(b, line);
+        line = stop + 1;
+    }
+    return NULL;
+}
+
+// Cut [data, data + len) into `count` slices that end on line boundaries
+static void slice_chunk(char* data, size_t len, ImportBatch* batches, int count) {
+    char* end = data + len;
+    char* begin = data;
+    for (int t = 0; t < count; t++) {
+        char* stop = end;
+        if (t < count - 1) {
+            char* target = data + len / count * (t + 1);
+            if (target < begin) target = begin;
+            char* nl = (char*)memchr(target, '\n', (size_t)(end - target));
+            stop = nl ? nl + 1 : end;
+        }
+        batches[t].begin = begin;
+        batches[t].end = stop;
+        batches[t].productCount = batches[t].supplierCount = batches[t].orderCount = 0;
+        batches[t].itemCount = 0;
+        batches[t].lines = batches[t].rejected = 0;
+        begin = stop;
+    }
+}
+
+static void parse_chunk(char* data, size_t len, ImportBatch* batches, int threads) {
+    pthread_t ids[IMPORT_MAX_THREADS];
+    bool started[IMPORT_MAX_THREADS] = {false};
+
+    slice_chunk(data, len, batches, threads);
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&ids[t], NULL, parse_slice, &batches[t]) == 0;
+    }
+    parse_slice(&batches[0]);
+    for (int t = 1; t < threads; t++) {
+        // Fall back to parsing inline if a thread could not be started
+        if (started[t]) pthread_join(ids[t], NULL);
+        else parse_slice(&batches[t]);
+    }
+}
+
+// Apply parsed rows in file order
+static bool apply_batches(ImportBatch* batches, int threads, InventoryLoader* loader,
+                          SuppliersDB* sdb, OrdersQueue* oq, ImportStats* stats) {
+    for (int t = 0; t < threads; t++) {
+        ImportBatch* b = &batches[t];
+        if (b->failed) return false;
+        if (!inventory_loader_add(loader, b->products, b->productCount)) return false;
+        for (int i = 0; i < b->supplierCount; i++) {
+            if (!suppliers_insert(sdb, b->suppliers[i])) return false;
+        }
+        for (int i = 0; i < b->orderCount; i++) {
+            Order o = b->orders[i].order;
+            o.items = b->items + b->orders[i].firstItem;
+            if (!orders_enqueue(oq, o)) return false;
+        }
+        stats->products += b->productCount;
+        stats->suppliers += b->supplierCount;
+        stats->orders += b->orderCount;
+    }
+    return true;
+}
+
+static char* last_newline(char* data, size_t len) {
+    while (len > 0) {
+        if (data[--len] == '\n') return data + len;
+    }
+    return NULL;
+}
+
+// Fill the buffer from fd; returns bytes read or -1 on error
+static ssize_t read_full(int fd, char* buffer, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, buffer + got, size - got);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        got += (size_t)n;
+    }
+    return (ssize_t)got;
+}
+
+bool import_csv(const char* path, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq,
+                int threads, ImportStats* stats) {
+    ImportStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(ImportStats));
+    if (!path || !inv || !sdb || !oq) return false;
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > IMPORT_MAX_THREADS) threads = IMPORT_MAX_THREADS;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    // One spare byte so the final unterminated line can be cut in place
+    char* buffer = (char*)malloc(IMPORT_CHUNK_BYTES + 1);
+    ImportBatch* batches = (ImportBatch*)calloc((size_t)threads, sizeof(ImportBatch));
+    InventoryLoader* loader = buffer && batches ? inventory_loader_begin(inv) : NULL;
+    bool ok = loader != NULL;
+
+    size_t carry = 0;
+    bool skipping = false;  // Discarding the rest of an over-long line
+    bool eof = false;
+    while (ok && !eof) {
+        ssize_t got = read_full(fd, buffer + carry, IMPORT_CHUNK_BYTES - carry);
+        if (got < 0) {
+            ok = false;
+            break;
+        }
+        size_t len = carry + (size_t)got;
+        eof = carry + (size_t)got < IMPORT_CHUNK_BYTES;
+
+        // Only whole lines are parsed; the partial tail moves to the front
+        size_t usable = len;
+        if (!eof) {
+            char* nl = last_newline(buffer, len);
+            if (!nl) {
+                // A single line longer than the chunk: reject it
+                if (!skipping) {
+                    stats->lines++;
+                    stats->rejected++;
+                }
+                skipping = true;
+                carry = 0;
+                continue;
+            }
+            usable = (size_t)(nl + 1 - buffer);
+        }
+
+        size_t start = 0;
+        if (skipping) {
+            char* nl = (char*)memchr(buffer, '\n', usable);
+            start = nl ? (size_t)(nl + 1 - buffer) : usable;
+            skipping = false;
+        }
+
+        if (usable > start) {
+            parse_chunk(buffer + start, usable - start, batches, threads);
+            for (int t = 0; t < threads; t++) {
+                stats->lines += batches[t].lines;
+                stats->rejected += batches[t].rejected;
+            }
+            ok = apply_batches(batches, threads, loader, sdb, oq, stats);
+        }
+
+        carry = len - usable;
+        memmove(buffer, buffer + usable, carry);
+    }
+
+    if (loader && !inventory_loader_finish(loader)) ok = false;
+    if (batches) {
+        for (int t = 0; t < threads; t++) {
+            free(batches[t].products);
+            free(batches[t].suppliers);
+            free(batches[t].orders);
+            free(batches[t].items);
+            free(batches[t].fields);
+        }
+    }
+    free(batches);
+    free(buffer);
+    close(fd);
+    return ok;
+}
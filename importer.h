@@ -0,0 +1,34 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <stdbool.h>
+#include "inventory.h"
+#include "orders.h"
+#include "suppliers.h"
+
+// CSV import (--import). One record per line, tagged by its first field:
+//   P,id,name,category,supplierId,price,stock
+//   S,id,name,quality,deliveryTime,price,reliability,customerService
+//   O,id,customer,productId,quantity[,productId,quantity...]
+// Fields may be double-quoted ("" escapes a quote). Blank lines and lines
+// starting with '#' are skipped; malformed rows are counted and skipped.
+#define IMPORT_CHUNK_BYTES (8 * 1024 * 1024)
+#define IMPORT_MAX_THREADS 16
+
+typedef struct ImportStats {
+    long long lines;
+    long long products;
+    long long suppliers;
+    long long orders;
+    long long rejected;
+} ImportStats;
+
+// Stream a file through a fixed-size chunk buffer, parsing each chunk on
+// up to `threads` threads (0 picks one per online CPU). Products go through
+// the bulk loader and bypass undo and the write-ahead log, so callers
+// should checkpoint afterwards. Returns false if the file cannot be read
+// or memory runs out; rows applied before the failure are kept.
+bool import_csv(const char* path, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq,
+                int threads, ImportStats* stats);
+
+#endif // IMPORTER_H
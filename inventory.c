@@ -1,36 +1,98 @@
 #include "inventory.h"
+#include "columns.h"
+#include "metrics.h"
+#include "rhindex.h"
+#include "textindex.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 
 #define MAX_SKIP_LEVEL 16
+// inventory_lookup_sorted walks the list when at least one in this many
+// products is requested
+#define LOOKUP_WALK_DENSITY 4
+#define INDEX_INITIAL_CAPACITY 64
+
+#define CATEGORY_INITIAL_CAPACITY 16
+
+#define SLAB_NODES_PER_CHUNK 512
+#define SLAB_MIN_NODES 4
 
 // Skip List Node for inventory
 typedef struct SkipNode {
     Product product;
-    struct SkipNode** forward;  // Array of forward pointers
+    int heapPos;  // Index in the low-stock heap, -1 when absent
+    int row;      // Row in the columnar shadow store, -1 when absent
+    // Price index links (AVL keyed by price, then id)
+    struct SkipNode* priceLeft;
+    struct SkipNode* priceRight;
+    int priceHeight;
+    // Category index chain
+    struct SkipNode* categoryPrev;
+    struct SkipNode* categoryNext;
     int level;
+    struct SkipNode* forward[];  // Inline forward pointers (level + 1 entries)
 } SkipNode;
 
+// Slab chunk header; node storage follows it
+typedef struct SlabChunk {
+    struct SlabChunk* next;
+} SlabChunk;
+
+// Node arena with one size class per skip level. Each class bump-allocates
+// out of its current chunk and recycles deleted nodes through a free list
+// threaded via forward[0].
+typedef struct NodeArena {
+    SkipNode* freeList[MAX_SKIP_LEVEL + 1];
+    char* cursor[MAX_SKIP_LEVEL + 1];
+    char* limit[MAX_SKIP_LEVEL + 1];
+    SlabChunk* chunks;
+} NodeArena;
+
+// Category hash bucket; heads a chain of the category's products
+typedef struct CategoryBucket {
+    char name[MAX_CATEGORY_LEN];
+    uint64_t hash;
+    SkipNode* head;
+    int count;
+    int id;  // Stable small id used by the category column
+    bool used;
+} CategoryBucket;
+
+// Open-addressing hash from category name to its product chain
+typedef struct CategoryIndex {
+    CategoryBucket* buckets;
+    size_t capacity;  // Always a power of two
+    size_t used;
+    int nextId;
+} CategoryIndex;
+
 // Skip List structure
 typedef struct SkipList {
     SkipNode* header;
     int currentLevel;
     int size;
+    NodeArena arena;
+    RhIndex index;       // O(1) point lookups; the list keeps id order
 } SkipList;
 
-typedef struct HeapEntry {
-    int stock;
-    int productId;
-    unsigned long version;
-} HeapEntry;
+typedef enum { ACT_ADD, ACT_REMOVE, ACT_UPDATE_STOCK, ACT_UPDATE_STOCKS } ActionType;
 
-typedef enum { ACT_ADD, ACT_REMOVE, ACT_UPDATE_STOCK } ActionType;
+// Stock level before a grouped update
+typedef struct StockUndo {
+    ProductId id;
+    int stock;
+} StockUndo;
 
 typedef struct UndoAction {
     ActionType type;
     Product before;
     Product after;
+    // ACT_UPDATE_STOCKS only
+    StockUndo* stocks;
+    int stockCount;
 } UndoAction;
 
 typedef struct UndoNode {
@@ -40,14 +102,22 @@ typedef struct UndoNode {
 
 struct Inventory {
     SkipList* products;
-    // Min-heap by stock
-    HeapEntry* heap;
+    // Indexed min-heap by stock; each node records its own position
+    SkipNode** heap;
     int heapSize;
     int heapCapacity;
-    // Versioning for products
-    unsigned long productVersion[MAX_PRODUCTS];
+    // Secondary search indexes, maintained on every mutation
+    SkipNode* priceRoot;
+    CategoryIndex categories;
+    TextIndex names;
+    bool namesDeferred;  // names is empty until the next name query builds it
+    // Columnar copy of the scan-heavy fields
+    ColumnStore columns;
     // Undo stack
     UndoNode* undoTop;
+    int undoDepth;
+    // Redo log for durability (optional)
+    Wal* wal;
 };
 
 // Skip List utility functions
@@ -59,11 +129,69 @@ static int random_level() {
     return level;
 }
 
-static SkipNode* create_skip_node(int level, Product product) {
-    SkipNode* node = (SkipNode*)malloc(sizeof(SkipNode));
+// Product id -> skip node, counting probes for the metrics
+static SkipNode* index_find(const RhIndex* index, ProductId key) {
+    int probes;
+    SkipNode* node = (SkipNode*)rh_index_probe(index, key, &probes);
+    METRIC_INC(METRIC_INDEX_LOOKUPS);
+    METRIC_ADD(METRIC_INDEX_PROBES, probes);
+    return node;
+}
+
+// Slab allocator
+static size_t skip_node_size(int level) {
+    return sizeof(SkipNode) + sizeof(SkipNode*) * (level + 1);
+}
+
+static SkipNode* arena_alloc(NodeArena* arena, int level) {
+    SkipNode* node = arena->freeList[level];
+    if (node) {
+        arena->freeList[level] = node->forward[0];
+        return node;
+    }
+    
+    size_t size = skip_node_size(level);
+    if ((size_t)(arena->limit[level] - arena->cursor[level]) < size) {
+        // Taller nodes are geometrically rarer, so their chunks are smaller
+        int count = SLAB_NODES_PER_CHUNK >> (level - 1);
+        if (count < SLAB_MIN_NODES) count = SLAB_MIN_NODES;
+        SlabChunk* chunk = (SlabChunk*)malloc(sizeof(SlabChunk) + size * count);
+        if (!chunk) return NULL;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->cursor[level] = (char*)(chunk + 1);
+        arena->limit[level] = arena->cursor[level] + size * count;
+    }
+    
+    node = (SkipNode*)arena->cursor[level];
+    arena->cursor[level] += size;
+    return node;
+}
+
+static void arena_free(NodeArena* arena, SkipNode* node) {
+    node->forward[0] = arena->freeList[node->level];
+    arena->freeList[node->level] = node;
+}
+
+static void arena_release(NodeArena* arena) {
+    SlabChunk* chunk = arena->chunks;
+    while (chunk) {
+        SlabChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    memset(arena, 0, sizeof(NodeArena));
+}
+
+static SkipNode* create_skip_node(NodeArena* arena, int level, Product product) {
+    SkipNode* node = arena_alloc(arena, level);
+    if (!node) return NULL;
     node->product = product;
+    node->heapPos = -1;
+    node->row = -1;
+    node->priceLeft = node->priceRight = NULL;
+    node->priceHeight = 0;
     node->level = level;
-    node->forward = (SkipNode**)malloc(sizeof(SkipNode*) * (level + 1));
     for (int i = 0; i <= level; i++) {
         node->forward[i] = NULL;
     }
@@ -71,56 +199,42 @@ static SkipNode* create_skip_node(int level, Product product) {
 }
 
 static SkipList* create_skip_list() {
-    SkipList* list = (SkipList*)malloc(sizeof(SkipList));
+    SkipList* list = (SkipList*)calloc(1, sizeof(SkipList));
     list->currentLevel = 0;
     list->size = 0;
     
     // Create header node with empty product
     Product emptyProduct = {0};
-    list->header = create_skip_node(MAX_SKIP_LEVEL, emptyProduct);
+    list->header = create_skip_node(&list->arena, MAX_SKIP_LEVEL, emptyProduct);
+    rh_index_init(&list->index, INDEX_INITIAL_CAPACITY);
     
     return list;
 }
 
-// Skip list search
-static SkipNode* skip_list_search(SkipList* list, int productId) {
-    SkipNode* current = list->header;
-    
-    // Start from highest level
-    for (int i = list->currentLevel; i >= 0; i--) {
-        while (current->forward[i] && current->forward[i]->product.id < productId) {
-            current = current->forward[i];
-        }
-    }
-    
-    current = current->forward[0];
-    
-    if (current && current->product.id == productId) {
-        return current;
-    }
-    
-    return NULL;
-}
-
-// Skip list insert
-static bool skip_list_insert(SkipList* list, Product product) {
+// Skip list insert; returns the new or updated node
+static SkipNode* skip_list_insert(SkipList* list, Product product) {
     SkipNode* update[MAX_SKIP_LEVEL + 1];
     SkipNode* current = list->header;
     
     // Find position to insert
+    int steps = 0;
     for (int i = list->currentLevel; i >= 0; i--) {
         while (current->forward[i] && current->forward[i]->product.id < product.id) {
             current = current->forward[i];
+            steps++;
         }
         update[i] = current;
     }
+    METRIC_INC(METRIC_SKIP_SEARCHES);
+    METRIC_ADD(METRIC_SKIP_LEVELS, list->currentLevel + 1);
+    METRIC_ADD(METRIC_SKIP_STEPS, steps);
     
     current = current->forward[0];
     
     // If product already exists, update it
     if (current && current->product.id == product.id) {
         current->product = product;
-        return true;
+        return current;
     }
     
     // Generate random level for new node
@@ -134,7 +248,12 @@ static bool skip_list_insert(SkipList* list, Product product) {
     }
     
     // Create new node
-    SkipNode* newNode = create_skip_node(newLevel, product);
+    SkipNode* newNode = create_skip_node(&list->arena, newLevel, product);
+    if (!newNode) return NULL;
+    if (!rh_index_insert(&list->index, product.id, newNode)) {
+        arena_free(&list->arena, newNode);
+        return NULL;
+    }
     
     // Update forward pointers
     for (int i = 0; i <= newLevel; i++) {
@@ -143,21 +262,26 @@ static bool skip_list_insert(SkipList* list, Product product) {
     }
     
     list->size++;
-    return true;
+    return newNode;
 }
 
 // Skip list delete
-static bool skip_list_delete(SkipList* list, int productId) {
+static bool skip_list_delete(SkipList* list, ProductId productId) {
     SkipNode* update[MAX_SKIP_LEVEL + 1];
     SkipNode* current = list->header;
     
     // Find node to delete
+    int steps = 0;
     for (int i = list->currentLevel; i >= 0; i--) {
         while (current->forward[i] && current->forward[i]->product.id < productId) {
             current = current->forward[i];
+            steps++;
         }
         update[i] = current;
     }
+    METRIC_INC(METRIC_SKIP_SEARCHES);
+    METRIC_ADD(METRIC_SKIP_LEVELS, list->currentLevel + 1);
+    METRIC_ADD(METRIC_SKIP_STEPS, steps);
     
     current = current->forward[0];
     
@@ -171,9 +295,9 @@ static bool skip_list_delete(SkipList* list, int productId) {
         update[i]->forward[i] = current->forward[i];
     }
     
-    // Free the node
-    free(current->forward);
-    free(current);
+    // Return the node to its size class
+    rh_index_erase(&list->index, productId);
+    arena_free(&list->arena, current);
     
     // Update current level
     while (list->currentLevel > 0 && list->header->forward[list->currentLevel] == NULL) {
@@ -185,89 +309,500 @@ static bool skip_list_delete(SkipList* list, int productId) {
 }
 
 // Heap utility functions
-static void heap_swap(HeapEntry* a, HeapEntry* b) { 
-    HeapEntry t = *a; *a = *b; *b = t; 
+static bool heap_less(const SkipNode* a, const SkipNode* b) {
+    if (a->product.stock != b->product.stock) return a->product.stock < b->product.stock;
+    return a->product.id < b->product.id;
+}
+
+static void heap_place(Inventory* inv, int idx, SkipNode* node) {
+    inv->heap[idx] = node;
+    node->heapPos = idx;
 }
 
-static void heap_sift_up(HeapEntry* heap, int idx) {
+static void heap_sift_up(Inventory* inv, int idx) {
+    SkipNode* node = inv->heap[idx];
+    int moves = 0;
     while (idx > 0) {
         int parent = (idx - 1) / 2;
-        if (heap[parent].stock <= heap[idx].stock) break;
-        heap_swap(&heap[parent], &heap[idx]);
+        if (!heap_less(node, inv->heap[parent])) break;
+        heap_place(inv, idx, inv->heap[parent]);
         idx = parent;
+        moves++;
     }
+    heap_place(inv, idx, node);
+    METRIC_ADD(METRIC_HEAP_SIFTS, moves);
 }
 
-static void heap_sift_down(HeapEntry* heap, int size, int idx) {
+static void heap_sift_down(Inventory* inv, int idx) {
+    SkipNode* node = inv->heap[idx];
+    int moves = 0;
     while (1) {
-        int l = idx * 2 + 1, r = l + 1, smallest = idx;
-        if (l < size && heap[l].stock < heap[smallest].stock) smallest = l;
-        if (r < size && heap[r].stock < heap[smallest].stock) smallest = r;
-        if (smallest == idx) break;
-        heap_swap(&heap[idx], &heap[smallest]);
+        int l = idx * 2 + 1, r = l + 1, smallest = l;
+        if (l >= inv->heapSize) break;
+        if (r < inv->heapSize && heap_less(inv->heap[r], inv->heap[l])) smallest = r;
+        if (!heap_less(inv->heap[smallest], node)) break;
+        heap_place(inv, idx, inv->heap[smallest]);
         idx = smallest;
+        moves++;
     }
+    heap_place(inv, idx, node);
+    METRIC_ADD(METRIC_HEAP_SIFTS, moves);
 }
 
-static void heap_push(struct Inventory* inv, HeapEntry e) {
+// Restore heap order after the node's stock changed (decrease or increase key)
+static void heap_update(Inventory* inv, SkipNode* node) {
+    int idx = node->heapPos;
+    if (idx < 0) return;
+    if (idx > 0 && heap_less(node, inv->heap[(idx - 1) / 2])) {
+        heap_sift_up(inv, idx);
+    } else {
+        heap_sift_down(inv, idx);
+    }
+}
+
+static bool heap_insert(Inventory* inv, SkipNode* node) {
     if (inv->heapSize == inv->heapCapacity) {
-        inv->heapCapacity = inv->heapCapacity ? inv->heapCapacity * 2 : 64;
-        inv->heap = (HeapEntry*)realloc(inv->heap, inv->heapCapacity * sizeof(HeapEntry));
+        int capacity = inv->heapCapacity ? inv->heapCapacity * 2 : 64;
+        SkipNode** heap = (SkipNode**)realloc(inv->heap, capacity * sizeof(SkipNode*));
+        if (!heap) return false;
+        inv->heap = heap;
+        inv->heapCapacity = capacity;
+    }
+    heap_place(inv, inv->heapSize, node);
+    heap_sift_up(inv, inv->heapSize++);
+    return true;
+}
+
+static void heap_remove(Inventory* inv, SkipNode* node) {
+    int idx = node->heapPos;
+    if (idx < 0) return;
+    node->heapPos = -1;
+    SkipNode* last = inv->heap[--inv->heapSize];
+    if (last != node) {
+        heap_place(inv, idx, last);
+        heap_update(inv, last);
+    }
+}
+
+// Price index (intrusive AVL tree)
+static int price_height(SkipNode* n) { return n ? n->priceHeight : 0; }
+
+static int price_cmp(const SkipNode* a, const SkipNode* b) {
+    if (a->product.price < b->product.price) return -1;
+    if (a->product.price > b->product.price) return 1;
+    if (a->product.id < b->product.id) return -1;
+    if (a->product.id > b->product.id) return 1;
+    return 0;
+}
+
+static void price_fix_height(SkipNode* n) {
+    int l = price_height(n->priceLeft), r = price_height(n->priceRight);
+    n->priceHeight = (l > r ? l : r) + 1;
+}
+
+static SkipNode* price_rotate_right(SkipNode* y) {
+    SkipNode* x = y->priceLeft;
+    y->priceLeft = x->priceRight;
+    x->priceRight = y;
+    price_fix_height(y);
+    price_fix_height(x);
+    return x;
+}
+
+static SkipNode* price_rotate_left(SkipNode* x) {
+    SkipNode* y = x->priceRight;
+    x->priceRight = y->priceLeft;
+    y->priceLeft = x;
+    price_fix_height(x);
+    price_fix_height(y);
+    return y;
+}
+
+static SkipNode* price_rebalance(SkipNode* n) {
+    price_fix_height(n);
+    int balance = price_height(n->priceLeft) - price_height(n->priceRight);
+    if (balance > 1) {
+        if (price_height(n->priceLeft->priceLeft) < price_height(n->priceLeft->priceRight)) {
+            n->priceLeft = price_rotate_left(n->priceLeft);
+        }
+        return price_rotate_right(n);
+    }
+    if (balance < -1) {
+        if (price_height(n->priceRight->priceRight) < price_height(n->priceRight->priceLeft)) {
+            n->priceRight = price_rotate_right(n->priceRight);
+        }
+        return price_rotate_left(n);
+    }
+    return n;
+}
+
+static SkipNode* price_insert(SkipNode* root, SkipNode* node) {
+    if (!root) {
+        node->priceLeft = node->priceRight = NULL;
+        node->priceHeight = 1;
+        return node;
+    }
+    if (price_cmp(node, root) < 0) root->priceLeft = price_insert(root->priceLeft, node);
+    else root->priceRight = price_insert(root->priceRight, node);
+    return price_rebalance(root);
+}
+
+// Detach the minimum of a subtree; *min receives it
+static SkipNode* price_remove_min(SkipNode* root, SkipNode** min) {
+    if (!root->priceLeft) {
+        *min = root;
+        return root->priceRight;
+    }
+    root->priceLeft = price_remove_min(root->priceLeft, min);
+    return price_rebalance(root);
+}
+
+// Nodes are linked in place, so the successor is relinked rather than copied
+static SkipNode* price_remove(SkipNode* root, SkipNode* node) {
+    if (!root) return NULL;
+    int c = price_cmp(node, root);
+    if (c < 0) {
+        root->priceLeft = price_remove(root->priceLeft, node);
+    } else if (c > 0) {
+        root->priceRight = price_remove(root->priceRight, node);
+    } else {
+        if (!root->priceLeft) return root->priceRight;
+        if (!root->priceRight) return root->priceLeft;
+        SkipNode* successor;
+        SkipNode* right = price_remove_min(root->priceRight, &successor);
+        successor->priceLeft = root->priceLeft;
+        successor->priceRight = right;
+        root = successor;
     }
-    inv->heap[inv->heapSize] = e;
-    heap_sift_up(inv->heap, inv->heapSize);
-    inv->heapSize++;
+    return price_rebalance(root);
+}
+
+// Sort key carried inline so bulk sorting does not chase node pointers
+typedef struct PriceKey {
+    double price;
+    ProductId id;
+    SkipNode* node;
+} PriceKey;
+
+static int price_key_cmp(const void* a, const void* b) {
+    const PriceKey* x = (const PriceKey*)a;
+    const PriceKey* y = (const PriceKey*)b;
+    if (x->price < y->price) return -1;
+    if (x->price > y->price) return 1;
+    if (x->id < y->id) return -1;
+    if (x->id > y->id) return 1;
+    return 0;
 }
 
-static void undo_push(Inventory* inv, UndoAction action) {
-    UndoNode* node = (UndoNode*)malloc(sizeof(UndoNode));
+// Build a perfectly balanced tree from nodes sorted by (price, id)
+static SkipNode* price_build(PriceKey* nodes, int count) {
+    if (count <= 0) return NULL;
+    int mid = count / 2;
+    SkipNode* root = nodes[mid].node;
+    root->priceLeft = price_build(nodes, mid);
+    root->priceRight = price_build(nodes + mid + 1, count - mid - 1);
+    price_fix_height(root);
+    return root;
+}
+
+static void price_range(SkipNode* root, double minPrice, double maxPrice,
+                        ProductVisitor visit, void* ctx) {
+    while (root) {
+        // Skip subtrees entirely outside the range
+        if (root->product.price < minPrice) {
+            root = root->priceRight;
+        } else if (root->product.price > maxPrice) {
+            root = root->priceLeft;
+        } else {
+            price_range(root->priceLeft, minPrice, maxPrice, visit, ctx);
+            visit(&root->product, ctx);
+            root = root->priceRight;
+        }
+    }
+}
+
+// price_range for walkers that may stop early
+static bool price_walk(SkipNode* root, double minPrice, double maxPrice,
+                       ProductWalker visit, void* ctx) {
+    while (root) {
+        if (root->product.price < minPrice) {
+            root = root->priceRight;
+        } else if (root->product.price > maxPrice) {
+            root = root->priceLeft;
+        } else {
+            if (!price_walk(root->priceLeft, minPrice, maxPrice, visit, ctx)) return false;
+            if (!visit(&root->product, ctx)) return false;
+            root = root->priceRight;
+        }
+    }
+    return true;
+}
+
+// Category index (open addressing on the category name)
+static uint64_t category_hash(const char* name) {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        h ^= *c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static CategoryBucket* category_find(const CategoryIndex* index, const char* name, uint64_t hash) {
+    if (!index->buckets) return NULL;
+    size_t mask = index->capacity - 1;
+    for (size_t i = hash & mask; index->buckets[i].used; i = (i + 1) & mask) {
+        CategoryBucket* b = &index->buckets[i];
+        if (b->hash == hash && strcmp(b->name, name) == 0) return b;
+    }
+    return NULL;
+}
+
+static CategoryBucket* category_slot(CategoryBucket* buckets, size_t capacity, uint64_t hash) {
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (buckets[i].used) i = (i + 1) & mask;
+    return &buckets[i];
+}
+
+static CategoryBucket* category_get_or_add(CategoryIndex* index, const char* name) {
+    uint64_t hash = category_hash(name);
+    CategoryBucket* b = category_find(index, name, hash);
+    if (b) return b;
+    
+    // Keep load factor under 3/4; chains hang off node pointers so
+    // moving buckets on growth is safe
+    if ((index->used + 1) * 4 > index->capacity * 3) {
+        size_t capacity = index->capacity ? index->capacity * 2 : CATEGORY_INITIAL_CAPACITY;
+        CategoryBucket* buckets = (CategoryBucket*)calloc(capacity, sizeof(CategoryBucket));
+        if (!buckets) return NULL;
+        for (size_t i = 0; i < index->capacity; i++) {
+            if (index->buckets[i].used) {
+                *category_slot(buckets, capacity, index->buckets[i].hash) = index->buckets[i];
+            }
+        }
+        free(index->buckets);
+        index->buckets = buckets;
+        index->capacity = capacity;
+    }
+    
+    b = category_slot(index->buckets, index->capacity, hash);
+    strncpy(b->name, name, MAX_CATEGORY_LEN - 1);
+    b->name[MAX_CATEGORY_LEN - 1] = '\0';
+    b->hash = hash;
+    b->head = NULL;
+    b->count = 0;
+    b->id = index->nextId++;
+    b->used = true;
+    index->used++;
+    return b;
+}
+
+static void category_link(CategoryIndex* index, SkipNode* node) {
+    CategoryBucket* b = category_get_or_add(index, node->product.category);
+    node->categoryPrev = NULL;
+    node->categoryNext = b ? b->head : NULL;
+    if (!b) return;
+    if (b->head) b->head->categoryPrev = node;
+    b->head = node;
+    b->count++;
+}
+
+static int category_id_of(const CategoryIndex* index, const char* name) {
+    CategoryBucket* b = category_find(index, name, category_hash(name));
+    return b ? b->id : -1;
+}
+
+static void category_unlink(CategoryIndex* index, SkipNode* node) {
+    CategoryBucket* b = category_find(index, node->product.category,
+                                      category_hash(node->product.category));
+    if (!b) return;
+    if (node->categoryPrev) node->categoryPrev->categoryNext = node->categoryNext;
+    else b->head = node->categoryNext;
+    if (node->categoryNext) node->categoryNext->categoryPrev = node->categoryPrev;
+    node->categoryPrev = node->categoryNext = NULL;
+    b->count--;
+}
+
+// Columnar store rows point back at the product embedded in its node
+static SkipNode* node_of(Product* p) {
+    return (SkipNode*)((char*)p - offsetof(SkipNode, product));
+}
+
+// A node without a row would be invisible to scans, so failure is reported
+static bool columns_link(Inventory* inv, SkipNode* node) {
+    int categoryId = category_id_of(&inv->categories, node->product.category);
+    node->row = columns_append(&inv->columns, &node->product, categoryId);
+    return node->row >= 0;
+}
+
+static void columns_unlink(Inventory* inv, SkipNode* node) {
+    if (node->row < 0) return;
+    Product* moved = columns_remove(&inv->columns, node->row);
+    if (moved) node_of(moved)->row = node->row;
+    node->row = -1;
+}
+
+// Drop the name index; the next name query rebuilds it from the list
+static void names_defer(Inventory* inv) {
+    text_index_free(&inv->names);
+    inv->namesDeferred = true;
+}
+
+// Build a deferred name index in one batch; false if out of memory
+static bool names_ready(Inventory* inv) {
+    if (!inv->namesDeferred) return true;
+    SkipList* list = inv->products;
+    TextEntry* entries = (TextEntry*)malloc(sizeof(TextEntry) * (size_t)(list->size ? list->size : 1));
+    if (!entries) return false;
+    int count = 0;
+    for (SkipNode* node = list->header->forward[0]; node; node = node->forward[0]) {
+        entries[count].id = node->product.id;
+        entries[count].text = node->product.name;
+        count++;
+    }
+    bool ok = text_index_add_all(&inv->names, entries, count);
+    free(entries);
+    if (!ok) {
+        text_index_free(&inv->names);
+        return false;
+    }
+    inv->namesDeferred = false;
+    return true;
+}
+
+// Attach/detach a node to every secondary index. Linking fails, leaving
+// the node unlinked, only if the name index runs out of memory.
+static bool search_index_link(Inventory* inv, SkipNode* node) {
+    if (!inv->namesDeferred && !text_index_add(&inv->names, node->product.id, node->product.name)) {
+        return false;
+    }
+    inv->priceRoot = price_insert(inv->priceRoot, node);
+    category_link(&inv->categories, node);
+    return true;
+}
+
+static void search_index_unlink(Inventory* inv, SkipNode* node) {
+    inv->priceRoot = price_remove(inv->priceRoot, node);
+    category_unlink(&inv->categories, node);
+    if (!inv->namesDeferred) text_index_remove(&inv->names, node->product.id, node->product.name);
+}
+
+// Insert or overwrite a product, keeping the heap in sync; node is the
+// product's current node from the caller's lookup, NULL if it is new.
+// NULL, with the inventory unchanged, if out of memory.
+static SkipNode* inventory_store(Inventory* inv, SkipNode* node, Product p) {
+    if (node) {
+        // Re-key the secondary indexes only when their keys change
+        bool rekey = node->product.price != p.price ||
+                     strcmp(node->product.category, p.category) != 0 ||
+                     strcmp(node->product.name, p.name) != 0;
+        Product before = node->product;
+        if (rekey) search_index_unlink(inv, node);
+        node->product = p;
+        if (rekey && !search_index_link(inv, node)) {
+            // Relink the old product; should its name not fit back in
+            // either, the name index is rebuilt on its next use
+            node->product = before;
+            if (!search_index_link(inv, node)) {
+                names_defer(inv);
+                search_index_link(inv, node);
+            }
+            return NULL;
+        }
+        if (node->row >= 0) {
+            columns_update(&inv->columns, node->row,
+                           category_id_of(&inv->categories, p.category));
+        }
+        heap_update(inv, node);
+        return node;
+    }
+    
+    node = skip_list_insert(inv->products, p);
+    if (!node) return NULL;
+    if (!search_index_link(inv, node)) {
+        skip_list_delete(inv->products, p.id);
+        return NULL;
+    }
+    if (!columns_link(inv, node) || !heap_insert(inv, node)) {
+        columns_unlink(inv, node);
+        search_index_unlink(inv, node);
+        skip_list_delete(inv->products, p.id);
+        return NULL;
+    }
+    return node;
+}
+
+// Remove a product from the heap and the skip list
+static bool inventory_erase(Inventory* inv, ProductId productId) {
+    SkipNode* node = index_find(&inv->products->index, productId);
+    if (!node) return false;
+    heap_remove(inv, node);
+    search_index_unlink(inv, node);
+    columns_unlink(inv, node);
+    return skip_list_delete(inv->products, productId);
+}
+
+// Undo steps are allocated before the change they record, so running out
+// of memory fails the change rather than leaving it without an undo
+static UndoNode* undo_alloc(void) {
+    return (UndoNode*)malloc(sizeof(UndoNode));
+}
+
+static void undo_push(Inventory* inv, UndoNode* node, UndoAction action) {
     node->action = action;
     node->next = inv->undoTop;
     inv->undoTop = node;
+    inv->undoDepth++;
+    METRIC_INC(METRIC_UNDO_PUSHES);
 }
 
+#ifndef SCMS_NO_METRICS
+// Gauge probes
+static long long probe_products(void* ctx) { return ((Inventory*)ctx)->products->size; }
+static long long probe_heap_size(void* ctx) { return ((Inventory*)ctx)->heapSize; }
+static long long probe_skip_level(void* ctx) { return ((Inventory*)ctx)->products->currentLevel; }
+static long long probe_undo_depth(void* ctx) { return ((Inventory*)ctx)->undoDepth; }
+#endif
+
 Inventory* inventory_create(void) {
     Inventory* inv = (Inventory*)calloc(1, sizeof(Inventory));
     inv->products = create_skip_list();
+    METRIC_WATCH(METRIC_GAUGE_PRODUCTS, probe_products, inv);
+    METRIC_WATCH(METRIC_GAUGE_HEAP_SIZE, probe_heap_size, inv);
+    METRIC_WATCH(METRIC_GAUGE_SKIP_LEVEL, probe_skip_level, inv);
+    METRIC_WATCH(METRIC_GAUGE_UNDO_DEPTH, probe_undo_depth, inv);
     return inv;
 }
 
 void inventory_destroy(Inventory* inv) {
     if (!inv) return;
+    METRIC_UNWATCH(inv);
     
-    // Clean up skip list
-    SkipNode* current = inv->products->header->forward[0];
-    while (current) {
-        SkipNode* next = current->forward[0];
-        free(current->forward);
-        free(current);
-        current = next;
-    }
-    free(inv->products->header->forward);
-    free(inv->products->header);
+    // Clean up skip list: nodes live in slab chunks, released wholesale
+    arena_release(&inv->products->arena);
+    rh_index_free(&inv->products->index);
     free(inv->products);
     
-    // Clean up heap
+    // Clean up heap and search indexes (index links live in the nodes)
     free(inv->heap);
+    free(inv->categories.buckets);
+    text_index_free(&inv->names);
+    columns_free(&inv->columns);
     
-    // Clean up undo stack
-    UndoNode* undoCurrent = inv->undoTop;
-    while (undoCurrent) {
-        UndoNode* next = undoCurrent->next;
-        free(undoCurrent);
-        undoCurrent = next;
-    }
-    
+    inventory_clear_undo(inv);
     free(inv);
 }
 
 bool inventory_add_product(Inventory* inv, Product p) {
     if (!inv) return false;
+    METRIC_START(start);
     
     // Check if product already exists
-    SkipNode* existing = skip_list_search(inv->products, p.id);
+    SkipNode* existing = index_find(&inv->products->index, p.id);
     
-    UndoAction action;
+    UndoAction action = {0};
     action.type = ACT_ADD;
     action.after = p;
     if (existing) {
@@ -276,78 +811,361 @@ bool inventory_add_product(Inventory* inv, Product p) {
         memset(&action.before, 0, sizeof(Product));
     }
     
-    // Insert/update product
-    bool result = skip_list_insert(inv->products, p);
+    UndoNode* undo = undo_alloc();
+    // Insert/update product and its heap position
+    bool result = undo && inventory_store(inv, existing, p) != NULL;
     
     if (result) {
-        // Update version and heap
-        if (p.id < MAX_PRODUCTS) {
-            inv->productVersion[p.id]++;
-            HeapEntry he = { p.stock, p.id, inv->productVersion[p.id] };
-            heap_push(inv, he);
-        }
-        
         // Push to undo stack
-        undo_push(inv, action);
+        undo_push(inv, undo, action);
+        wal_log_put_product(inv->wal, &p);
+    } else {
+        free(undo);
     }
     
+    METRIC_STOP(METRIC_OP_ADD_PRODUCT, start);
     return result;
 }
 
-Product* inventory_get_product(Inventory* inv, int productId) {
+// Streaming bulk loader. Ids above the current maximum are linked at the
+// tail of every level they span; anything else takes the normal insert path.
+// New nodes stay out of the price tree and the heap until finish. The name
+// index is not built at all: finish defers it to the first name query.
+struct InventoryLoader {
+    Inventory* inv;
+    SkipNode* tail[MAX_SKIP_LEVEL + 1];
+    unsigned long long appended;
+    PriceKey* pending;
+    size_t pendingCount;
+    size_t pendingCapacity;
+    bool ok;
+};
+
+// Level from the append position: the number of trailing zero bits gives
+// the same 1/2 geometric distribution as random_level, but evenly spaced
+static int loader_level(unsigned long long position) {
+    int level = 1;
+    while (!(position & 1) && level < MAX_SKIP_LEVEL) {
+        position >>= 1;
+        level++;
+    }
+    return level;
+}
+
+static bool loader_track(InventoryLoader* loader, SkipNode* node) {
+    if (loader->pendingCount == loader->pendingCapacity) {
+        size_t capacity = loader->pendingCapacity ? loader->pendingCapacity * 2 : 1024;
+        PriceKey* pending = (PriceKey*)realloc(loader->pending, capacity * sizeof(PriceKey));
+        if (!pending) return false;
+        loader->pending = pending;
+        loader->pendingCapacity = capacity;
+    }
+    loader->pending[loader->pendingCount++].node = node;
+    category_link(&loader->inv->categories, node);
+    return columns_link(loader->inv, node);
+}
+
+static bool loader_put(InventoryLoader* loader, const Product* p) {
+    Inventory* inv = loader->inv;
+    SkipList* list = inv->products;
+    SkipNode* last = loader->tail[0];
+    
+    if (last == list->header || p->id > last->product.id) {
+        int level = loader_level(++loader->appended);
+        SkipNode* node = create_skip_node(&list->arena, level, *p);
+        if (!node) return false;
+        if (!rh_index_insert(&list->index, p->id, node)) {
+            arena_free(&list->arena, node);
+            return false;
+        }
+        for (int i = 0; i <= level; i++) {
+            loader->tail[i]->forward[i] = node;
+            loader->tail[i] = node;
+        }
+        if (level > list->currentLevel) list->currentLevel = level;
+        list->size++;
+        return loader_track(loader, node);
+    }
+    
+    SkipNode* node = index_find(&list->index, p->id);
+    if (node && node->priceHeight > 0) {
+        // Already indexed before this load: full overwrite path
+        return inventory_store(inv, node, *p) != NULL;
+    }
+    if (node) {
+        // Created by this load; price and heap are built from it at finish
+        bool recategorize = strcmp(node->product.category, p->category) != 0;
+        if (recategorize) category_unlink(&inv->categories, node);
+        node->product = *p;
+        if (recategorize) category_link(&inv->categories, node);
+        columns_update(&inv->columns, node->row,
+                       category_id_of(&inv->categories, p->category));
+        return true;
+    }
+    
+    node = skip_list_insert(list, *p);
+    if (!node) return false;
+    // A tall node can become the last one on its upper levels
+    for (int i = 0; i <= node->level; i++) {
+        if (!node->forward[i]) loader->tail[i] = node;
+    }
+    return loader_track(loader, node);
+}
+
+InventoryLoader* inventory_loader_begin(Inventory* inv) {
+    if (!inv) return NULL;
+    InventoryLoader* loader = (InventoryLoader*)calloc(1, sizeof(InventoryLoader));
+    if (!loader) return NULL;
+    loader->inv = inv;
+    loader->ok = true;
+    
+    SkipNode* current = inv->products->header;
+    for (int i = MAX_SKIP_LEVEL; i >= 0; i--) {
+        while (current->forward[i]) current = current->forward[i];
+        loader->tail[i] = current;
+    }
+    return loader;
+}
+
+bool inventory_loader_add(InventoryLoader* loader, const Product* products, int count) {
+    if (!loader || count < 0) return false;
+    if (!loader->ok) return false;
+    Inventory* inv = loader->inv;
+    if (!rh_index_reserve(&inv->products->index, (size_t)inv->products->size + (size_t)count) ||
+        !columns_reserve(&inv->columns, inv->columns.count + count)) {
+        loader->ok = false;
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!loader_put(loader, &products[i])) {
+            loader->ok = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool inventory_loader_finish(InventoryLoader* loader) {
+    if (!loader) return false;
+    Inventory* inv = loader->inv;
+    
+    // Keys are read only now, after every overwrite has landed
+    for (size_t i = 0; i < loader->pendingCount; i++) {
+        PriceKey* key = &loader->pending[i];
+        key->price = key->node->product.price;
+        key->id = key->node->product.id;
+    }
+    // Loads are often never followed by a name query, so the trie and
+    // trigram postings wait until one asks
+    if (loader->pendingCount) names_defer(inv);
+    
+    if (!inv->priceRoot) {
+        // Sort once and build the price tree balanced, instead of n
+        // rebalancing inserts
+        qsort(loader->pending, loader->pendingCount, sizeof(PriceKey), price_key_cmp);
+        inv->priceRoot = price_build(loader->pending, (int)loader->pendingCount);
+    } else {
+        for (size_t i = 0; i < loader->pendingCount; i++) {
+            inv->priceRoot = price_insert(inv->priceRoot, loader->pending[i].node);
+        }
+    }
+    
+    // One O(n) heapify instead of n sift-ups
+    inventory_heap_refresh_all(inv);
+    
+    bool ok = loader->ok;
+    free(loader->pending);
+    free(loader);
+    return ok;
+}
+
+bool inventory_bulk_load(Inventory* inv, const Product* products, int count) {
+    InventoryLoader* loader = inventory_loader_begin(inv);
+    if (!loader) return false;
+    inventory_loader_add(loader, products, count);
+    return inventory_loader_finish(loader);
+}
+
+Product* inventory_get_product(Inventory* inv, ProductId productId) {
     if (!inv) return NULL;
+    METRIC_START(start);
     
-    SkipNode* node = skip_list_search(inv->products, productId);
+    SkipNode* node = index_find(&inv->products->index, productId);
+    METRIC_STOP(METRIC_OP_GET_PRODUCT, start);
     return node ? &node->product : NULL;
 }
 
-bool inventory_remove_product(Inventory* inv, int productId) {
+bool inventory_remove_product(Inventory* inv, ProductId productId) {
     if (!inv) return false;
+    METRIC_START(start);
     
-    SkipNode* existing = skip_list_search(inv->products, productId);
-    if (!existing) return false;
+    SkipNode* existing = index_find(&inv->products->index, productId);
+    if (!existing) {
+        METRIC_STOP(METRIC_OP_REMOVE_PRODUCT, start);
+        return false;
+    }
     
-    UndoAction action;
+    UndoAction action = {0};
     action.type = ACT_REMOVE;
     action.before = existing->product;
     memset(&action.after, 0, sizeof(Product));
     
-    bool result = skip_list_delete(inv->products, productId);
+    UndoNode* undo = undo_alloc();
+    bool result = undo && inventory_erase(inv, productId);
     
     if (result) {
-        undo_push(inv, action);
+        undo_push(inv, undo, action);
+        wal_log_remove_product(inv->wal, productId);
+    } else {
+        free(undo);
     }
     
+    METRIC_STOP(METRIC_OP_REMOVE_PRODUCT, start);
     return result;
 }
 
-bool inventory_update_stock(Inventory* inv, int productId, int newStock) {
+bool inventory_update_stock(Inventory* inv, ProductId productId, int newStock) {
     if (!inv) return false;
+    METRIC_START(start);
     
-    SkipNode* node = skip_list_search(inv->products, productId);
-    if (!node) return false;
+    SkipNode* node = index_find(&inv->products->index, productId);
+    UndoNode* undo = node ? undo_alloc() : NULL;
+    if (!undo) {
+        METRIC_STOP(METRIC_OP_UPDATE_STOCK, start);
+        return false;
+    }
     
-    UndoAction action;
+    UndoAction action = {0};
     action.type = ACT_UPDATE_STOCK;
     action.before = node->product;
     action.after = node->product;
     action.after.stock = newStock;
     
-    int oldStock = node->product.stock;
     node->product.stock = newStock;
+    if (node->row >= 0) inv->columns.stock[node->row] = newStock;
+    heap_update(inv, node);
+    
+    undo_push(inv, undo, action);
+    wal_log_update_stock(inv->wal, productId, newStock);
+    
+    METRIC_STOP(METRIC_OP_UPDATE_STOCK, start);
+    return true;
+}
+
+// Set several stocks, restoring heap order once for the whole group:
+// sift each node in turn while few change, otherwise heapify afterwards.
+// The group is one log record, so recovery applies all of it or none.
+static void set_stocks(Inventory* inv, SkipNode** nodes, const int* stocks, int count) {
+    wal_begin_process(inv->wal);
+    int depth = 1;
+    while ((1 << depth) < inv->heapSize) depth++;
+    bool rebuild = (long long)count * depth > inv->heapSize;
+    
+    for (int i = 0; i < count; i++) {
+        SkipNode* node = nodes[i];
+        node->product.stock = stocks[i];
+        if (node->row >= 0) inv->columns.stock[node->row] = stocks[i];
+        if (!rebuild) heap_update(inv, node);
+        wal_log_update_stock(inv->wal, node->product.id, stocks[i]);
+    }
+    if (rebuild) inventory_heap_refresh_all(inv);
+    wal_commit_process(inv->wal);
+}
+
+static int lookup_sorted(Inventory* inv, const ProductId* ids, int count, Product** out) {
     
-    // Update version and heap
-    if (productId < MAX_PRODUCTS) {
-        inv->productVersion[productId]++;
-        HeapEntry he = { newStock, productId, inv->productVersion[productId] };
-        heap_push(inv, he);
+    SkipList* list = inv->products;
+    int found = 0;
+    // A sparse batch would pay a climb and descent of cache misses per id;
+    // the hash index resolves each with one probe instead
+    if ((long long)count * LOOKUP_WALK_DENSITY < list->size) {
+        for (int i = 0; i < count; i++) {
+            SkipNode* node = index_find(&list->index, ids[i]);
+            out[i] = node ? &node->product : NULL;
+            if (out[i]) found++;
+        }
+        return found;
     }
     
-    undo_push(inv, action);
+    SkipNode* finger[MAX_SKIP_LEVEL + 1];
+    for (int i = 0; i <= MAX_SKIP_LEVEL; i++) finger[i] = list->header;
     
+    // finger[l] is the last node before the previous id on level l, so
+    // each search climbs only as high as the gap to the next id needs
+    for (int i = 0; i < count; i++) {
+        ProductId id = ids[i];
+        int level = 0;
+        while (level < list->currentLevel) {
+            SkipNode* next = finger[level + 1]->forward[level + 1];
+            if (!next || next->product.id >= id) break;
+            level++;
+        }
+        
+        SkipNode* x = finger[level];
+        for (int l = level; l >= 0; l--) {
+            if (finger[l] != list->header && (x == list->header || finger[l]->product.id > x->product.id)) {
+                x = finger[l];
+            }
+            while (x->forward[l] && x->forward[l]->product.id < id) x = x->forward[l];
+            finger[l] = x;
+        }
+        
+        SkipNode* hit = x->forward[0];
+        out[i] = hit && hit->product.id == id ? &hit->product : NULL;
+        if (out[i]) found++;
+    }
+    return found;
+}
+
+int inventory_lookup_sorted(Inventory* inv, const ProductId* ids, int count, Product** out) {
+    if (!inv || count <= 0) return 0;
+    METRIC_START(start);
+    int found = lookup_sorted(inv, ids, count, out);
+    METRIC_STOP(METRIC_OP_LOOKUP_SORTED, start);
+    return found;
+}
+
+static bool update_stocks(Inventory* inv, const StockChange* changes, int count) {
+    SkipNode** nodes = (SkipNode**)malloc(sizeof(SkipNode*) * count);
+    int* stocks = (int*)malloc(sizeof(int) * count);
+    StockUndo* before = (StockUndo*)malloc(sizeof(StockUndo) * count);
+    UndoNode* undo = undo_alloc();
+    if (!nodes || !stocks || !before || !undo) {
+        free(nodes);
+        free(stocks);
+        free(before);
+        free(undo);
+        return false;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        nodes[i] = node_of(changes[i].product);
+        stocks[i] = changes[i].newStock;
+        before[i].id = changes[i].product->id;
+        before[i].stock = changes[i].product->stock;
+    }
+    set_stocks(inv, nodes, stocks, count);
+    
+    UndoAction action = {0};
+    action.type = ACT_UPDATE_STOCKS;
+    action.stocks = before;
+    action.stockCount = count;
+    undo_push(inv, undo, action);
+    
+    free(nodes);
+    free(stocks);
     return true;
 }
 
+bool inventory_update_stocks(Inventory* inv, const StockChange* changes, int count) {
+    if (!inv || count < 0) return false;
+    if (count == 0) return true;
+    METRIC_START(start);
+    bool ok = update_stocks(inv, changes, count);
+    METRIC_STOP(METRIC_OP_UPDATE_STOCKS, start);
+    return ok;
+}
+
 void inventory_print_all(Inventory* inv) {
     if (!inv) return;
     
@@ -356,94 +1174,360 @@ void inventory_print_all(Inventory* inv) {
     SkipNode* current = inv->products->header->forward[0];
     while (current) {
         Product* p = &current->product;
-        printf("ID:%d Name:%s Cat:%s Supplier:%d Price:%.2f Stock:%d\n",
+        printf("ID:%lld Name:%s Cat:%s Supplier:%d Price:%.2f Stock:%d\n",
                p->id, p->name, p->category, p->supplierId, p->price, p->stock);
         current = current->forward[0];
     }
 }
 
+void inventory_attach_wal(Inventory* inv, Wal* wal) {
+    if (inv) inv->wal = wal;
+}
+
+int inventory_count(Inventory* inv) {
+    return inv ? inv->products->size : 0;
+}
+
+void inventory_for_each(Inventory* inv, ProductVisitor visit, void* ctx) {
+    if (!inv || !visit) return;
+    
+    SkipNode* current = inv->products->header->forward[0];
+    while (current) {
+        // Read the successor first so the visitor may remove this product
+        SkipNode* next = current->forward[0];
+        visit(&current->product, ctx);
+        current = next;
+    }
+}
+
+void inventory_for_each_in_price_range(Inventory* inv, double minPrice, double maxPrice,
+                                       ProductVisitor visit, void* ctx) {
+    if (!inv || !visit) return;
+    price_range(inv->priceRoot, minPrice, maxPrice, visit, ctx);
+}
+
+void inventory_walk_price_range(Inventory* inv, double minPrice, double maxPrice,
+                                ProductWalker visit, void* ctx) {
+    if (!inv || !visit) return;
+    price_walk(inv->priceRoot, minPrice, maxPrice, visit, ctx);
+}
+
+void inventory_for_each_in_category(Inventory* inv, const char* category,
+                                    ProductVisitor visit, void* ctx) {
+    if (!inv || !category || !visit) return;
+    
+    CategoryBucket* b = category_find(&inv->categories, category, category_hash(category));
+    for (SkipNode* node = b ? b->head : NULL; node; node = node->categoryNext) {
+        visit(&node->product, ctx);
+    }
+}
+
+int inventory_category_count(Inventory* inv, const char* category) {
+    if (!inv || !category) return 0;
+    CategoryBucket* b = category_find(&inv->categories, category, category_hash(category));
+    return b ? b->count : 0;
+}
+
+// Resolves name index ids to products for the name walks below
+typedef struct NameWalk {
+    Inventory* inv;
+    const char* text;  // Substring to verify candidates against, or NULL
+    ProductVisitor visit;
+    void* ctx;
+    Product** out;
+    int max;
+    int found;
+} NameWalk;
+
+static bool name_walk_step(ProductId id, void* ctx) {
+    NameWalk* walk = (NameWalk*)ctx;
+    SkipNode* node = index_find(&walk->inv->products->index, id);
+    if (!node) return true;
+    if (walk->text && !text_contains(node->product.name, walk->text)) return true;
+    if (walk->visit) {
+        walk->visit(&node->product, walk->ctx);
+        return true;
+    }
+    walk->out[walk->found++] = &node->product;
+    return walk->found < walk->max;
+}
+
+// Substring walk: trigram candidates when the text has a trigram, else a
+// scan in id order
+static void name_walk_containing(NameWalk* walk) {
+    if (names_ready(walk->inv) &&
+        text_index_candidates(&walk->inv->names, walk->text, name_walk_step, walk)) {
+        return;
+    }
+    for (SkipNode* node = walk->inv->products->header->forward[0]; node; node = node->forward[0]) {
+        if (!name_walk_step(node->product.id, walk)) return;
+    }
+}
+
+// Prefix walk in name order, or in id order should the name index not
+// fit in memory
+static void name_walk_prefix(NameWalk* walk, const char* prefix) {
+    if (names_ready(walk->inv)) {
+        text_index_prefix(&walk->inv->names, prefix, name_walk_step, walk);
+        return;
+    }
+    for (SkipNode* node = walk->inv->products->header->forward[0]; node; node = node->forward[0]) {
+        if (!text_starts_with(node->product.name, prefix)) continue;
+        if (!name_walk_step(node->product.id, walk)) return;
+    }
+}
+
+void inventory_for_each_name_prefix(Inventory* inv, const char* prefix,
+                                    ProductVisitor visit, void* ctx) {
+    if (!inv || !prefix || !visit) return;
+    NameWalk walk = { inv, NULL, visit, ctx, NULL, 0, 0 };
+    name_walk_prefix(&walk, prefix);
+}
+
+void inventory_for_each_name_containing(Inventory* inv, const char* text,
+                                        ProductVisitor visit, void* ctx) {
+    if (!inv || !text || !visit) return;
+    NameWalk walk = { inv, text, visit, ctx, NULL, 0, 0 };
+    name_walk_containing(&walk);
+}
+
+int inventory_suggest_names(Inventory* inv, const char* prefix, Product** out, int max) {
+    if (!inv || !prefix || !out || max <= 0) return 0;
+    NameWalk walk = { inv, NULL, NULL, NULL, out, max, 0 };
+    name_walk_prefix(&walk, prefix);
+    return walk.found;
+}
+
+int inventory_find_names(Inventory* inv, const char* text, Product** out, int max) {
+    if (!inv || !text || !out || max <= 0) return 0;
+    NameWalk walk = { inv, text, NULL, NULL, out, max, 0 };
+    name_walk_containing(&walk);
+    return walk.found;
+}
+
+int inventory_scan(Inventory* inv, const ProductFilter* filter, ProductVisitor visit, void* ctx) {
+    if (!inv || !filter || !visit) return 0;
+    
+    ColumnFilter cf = {0};
+    cf.hasPriceMin = filter->hasPriceMin;
+    cf.priceMin = filter->priceMin;
+    cf.hasPriceMax = filter->hasPriceMax;
+    cf.priceMax = filter->priceMax;
+    cf.onlyInStock = filter->onlyInStock;
+    cf.hasSupplier = filter->hasSupplier;
+    cf.supplierId = filter->supplierId;
+    if (filter->category) {
+        cf.hasCategory = true;
+        cf.categoryId = category_id_of(&inv->categories, filter->category);
+        if (cf.categoryId < 0) return 0;
+    }
+    
+    int words = columns_bitmap_words(&inv->columns);
+    if (words == 0) return 0;
+    uint64_t* bitmap = (uint64_t*)malloc(sizeof(uint64_t) * words);
+    if (!bitmap) return 0;
+    
+    int matches = columns_filter(&inv->columns, &cf, bitmap);
+    for (int w = 0; w < words; w++) {
+        for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+            visit(inv->columns.product[w * 64 + __builtin_ctzll(bits)], ctx);
+        }
+    }
+    
+    free(bitmap);
+    return matches;
+}
+
 void inventory_heap_refresh_all(Inventory* inv) {
     if (!inv) return;
     
-    // Clear existing heap
-    inv->heapSize = 0;
+    int size = inv->products->size;
+    if (size > inv->heapCapacity) {
+        SkipNode** heap = (SkipNode**)realloc(inv->heap, size * sizeof(SkipNode*));
+        if (!heap) return;
+        inv->heap = heap;
+        inv->heapCapacity = size;
+    }
     
-    // Rebuild heap from current inventory
+    // Gather every live product, then heapify bottom-up in O(n)
+    inv->heapSize = 0;
     SkipNode* current = inv->products->header->forward[0];
     while (current) {
-        Product* p = &current->product;
-        if (p->id < MAX_PRODUCTS) {
-            inv->productVersion[p->id]++;
-            HeapEntry he = { p->stock, p->id, inv->productVersion[p->id] };
-            heap_push(inv, he);
-        }
+        heap_place(inv, inv->heapSize++, current);
         current = current->forward[0];
     }
+    for (int i = inv->heapSize / 2 - 1; i >= 0; i--) {
+        heap_sift_down(inv, i);
+    }
+    METRIC_INC(METRIC_HEAP_REBUILDS);
 }
 
-int inventory_pop_low_stock_alerts(Inventory* inv, int threshold, int maxCount) {
-    if (!inv) return 0;
+// Min-heap of heap indices used as the best-first frontier by the peek query
+static void frontier_push(Inventory* inv, int* frontier, int* size, int heapIdx) {
+    int idx = (*size)++;
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+        if (!heap_less(inv->heap[heapIdx], inv->heap[frontier[parent]])) break;
+        frontier[idx] = frontier[parent];
+        idx = parent;
+    }
+    frontier[idx] = heapIdx;
+}
+
+static int frontier_pop(Inventory* inv, int* frontier, int* size) {
+    int top = frontier[0];
+    int last = frontier[--(*size)];
+    int idx = 0;
+    while (1) {
+        int l = idx * 2 + 1, r = l + 1, smallest = l;
+        if (l >= *size) break;
+        if (r < *size && heap_less(inv->heap[frontier[r]], inv->heap[frontier[l]])) smallest = r;
+        if (!heap_less(inv->heap[frontier[smallest]], inv->heap[last])) break;
+        frontier[idx] = frontier[smallest];
+        idx = smallest;
+    }
+    if (*size > 0) frontier[idx] = last;
+    return top;
+}
+
+int inventory_peek_low_stock(Inventory* inv, int threshold, Product** out, int maxCount) {
+    if (!inv || !out || maxCount <= 0 || inv->heapSize == 0) return 0;
+    
+    // Each pop adds at most two children, so the frontier stays under k + 2
+    int limit = maxCount < inv->heapSize ? maxCount : inv->heapSize;
+    int* frontier = (int*)malloc(sizeof(int) * (limit + 2));
+    if (!frontier) return 0;
     
+    int frontierSize = 0;
     int count = 0;
-    printf("\n-- Low Stock Alerts (threshold <= %d) --\n", threshold);
+    if (inv->heap[0]->product.stock <= threshold) frontier_push(inv, frontier, &frontierSize, 0);
     
-    // Process heap entries
-    while (inv->heapSize > 0 && count < maxCount) {
-        HeapEntry top = inv->heap[0];
-        
-        // Remove from heap
-        inv->heap[0] = inv->heap[--inv->heapSize];
-        if (inv->heapSize > 0) {
-            heap_sift_down(inv->heap, inv->heapSize, 0);
-        }
-        
-        // Check if entry is still valid
-        if (top.productId < MAX_PRODUCTS && inv->productVersion[top.productId] == top.version) {
-            if (top.stock <= threshold) {
-                Product* p = inventory_get_product(inv, top.productId);
-                if (p && p->stock == top.stock) {
-                    printf("ALERT: ID:%d Name:%s Stock:%d\n", p->id, p->name, p->stock);
-                    count++;
-                }
+    // Best-first walk: the heap property lets us prune any subtree whose
+    // root is above the threshold, so this visits O(k) nodes
+    while (frontierSize > 0 && count < limit) {
+        int idx = frontier_pop(inv, frontier, &frontierSize);
+        out[count++] = &inv->heap[idx]->product;
+        for (int child = idx * 2 + 1; child <= idx * 2 + 2 && child < inv->heapSize; child++) {
+            if (inv->heap[child]->product.stock <= threshold) {
+                frontier_push(inv, frontier, &frontierSize, child);
             }
         }
-        
-        if (top.stock > threshold) break;
     }
     
+    free(frontier);
+    return count;
+}
+
+int inventory_pop_low_stock_alerts(Inventory* inv, int threshold, int maxCount) {
+    if (!inv || maxCount <= 0) return 0;
+    METRIC_START(start);
+    
+    printf("\n-- Low Stock Alerts (threshold <= %d) --\n", threshold);
+    
+    Product** alerts = (Product**)malloc(sizeof(Product*) * maxCount);
+    if (!alerts) {
+        METRIC_STOP(METRIC_OP_LOW_STOCK_ALERTS, start);
+        return 0;
+    }
+    
+    int count = inventory_peek_low_stock(inv, threshold, alerts, maxCount);
+    for (int i = 0; i < count; i++) {
+        Product* p = alerts[i];
+        printf("ALERT: ID:%lld Name:%s Stock:%d\n", p->id, p->name, p->stock);
+    }
+    
+    free(alerts);
+    METRIC_ADD(METRIC_ALERTS_REPORTED, count);
+    METRIC_STOP(METRIC_OP_LOW_STOCK_ALERTS, start);
     return count;
 }
 
 bool inventory_undo_last(Inventory* inv) {
     if (!inv || !inv->undoTop) return false;
+    METRIC_START(start);
     
     UndoNode* node = inv->undoTop;
     UndoAction action = node->action;
     inv->undoTop = node->next;
+    inv->undoDepth--;
+    METRIC_INC(METRIC_UNDO_POPS);
+    bool restored = true;
     
     switch (action.type) {
         case ACT_ADD:
             if (action.before.id != 0) {
                 // Restore previous version
-                skip_list_insert(inv->products, action.before);
+                restored = inventory_store(inv, index_find(&inv->products->index, action.before.id),
+                                           action.before) != NULL;
+                if (restored) wal_log_put_product(inv->wal, &action.before);
             } else {
                 // Remove the added product
-                skip_list_delete(inv->products, action.after.id);
+                inventory_erase(inv, action.after.id);
+                wal_log_remove_product(inv->wal, action.after.id);
             }
             break;
             
         case ACT_REMOVE:
             // Re-add the removed product
-            skip_list_insert(inv->products, action.before);
+            restored = inventory_store(inv, index_find(&inv->products->index, action.before.id),
+                                       action.before) != NULL;
+            if (restored) wal_log_put_product(inv->wal, &action.before);
             break;
             
         case ACT_UPDATE_STOCK:
             // Restore previous stock level
-            skip_list_insert(inv->products, action.before);
+            restored = inventory_store(inv, index_find(&inv->products->index, action.before.id),
+                                       action.before) != NULL;
+            if (restored) wal_log_put_product(inv->wal, &action.before);
             break;
+            
+        case ACT_UPDATE_STOCKS: {
+            // Restore every stock level of the group at once
+            SkipNode** nodes = (SkipNode**)malloc(sizeof(SkipNode*) * action.stockCount);
+            int* stocks = (int*)malloc(sizeof(int) * action.stockCount);
+            if (!nodes || !stocks) {
+                free(nodes);
+                free(stocks);
+                restored = false;
+                break;
+            }
+            int count = 0;
+            for (int i = 0; i < action.stockCount; i++) {
+                SkipNode* n = index_find(&inv->products->index, action.stocks[i].id);
+                if (!n) continue;
+                nodes[count] = n;
+                stocks[count++] = action.stocks[i].stock;
+            }
+            set_stocks(inv, nodes, stocks, count);
+            free(nodes);
+            free(stocks);
+            free(action.stocks);
+            break;
+        }
     }
     
+    if (!restored) {
+        // Out of memory: keep the step so it can be retried
+        node->next = inv->undoTop;
+        inv->undoTop = node;
+        inv->undoDepth++;
+        METRIC_STOP(METRIC_OP_UNDO, start);
+        return false;
+    }
     free(node);
-    printf("Undo completed.\n");
+    METRIC_STOP(METRIC_OP_UNDO, start);
     return true;
-}
\ No newline at end of file
+}
+
+void inventory_clear_undo(Inventory* inv) {
+    if (!inv) return;
+    UndoNode* node = inv->undoTop;
+    while (node) {
+        UndoNode* next = node->next;
+        free(node->action.stocks);
+        free(node);
+        node = next;
+    }
+    inv->undoTop = NULL;
+    inv->undoDepth = 0;
+}
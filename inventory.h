@@ -3,27 +3,113 @@
 
 #include <stdbool.h>
 #include "common.h"
+#include "wal.h"
 
-// Inventory hash table API (chaining)
+// Inventory API: skip list ordered by product id, with an open-addressing
+// hash index for O(1) point lookups
 typedef struct Inventory Inventory;
 
 Inventory* inventory_create(void);
 void inventory_destroy(Inventory* inv);
 
+// Mutations record an undo step and fail, changing nothing, if there is
+// no memory for it
 bool inventory_add_product(Inventory* inv, Product p);
-bool inventory_remove_product(Inventory* inv, int productId);
-Product* inventory_get_product(Inventory* inv, int productId);
-bool inventory_update_stock(Inventory* inv, int productId, int newStock);
+// Load many products without recording undo actions or logging; ids above
+// the current maximum are appended in one linear pass with deterministic
+// levels, the price tree is built from a single sort and the heap heapified.
+// The name index is built on the first name query after the load.
+bool inventory_bulk_load(Inventory* inv, const Product* products, int count);
+// Streaming form of inventory_bulk_load for inputs that arrive in batches.
+// The inventory must not be modified otherwise until finish, which rebuilds
+// the price tree and the heap, frees the loader and reports any failure.
+typedef struct InventoryLoader InventoryLoader;
+InventoryLoader* inventory_loader_begin(Inventory* inv);
+bool inventory_loader_add(InventoryLoader* loader, const Product* products, int count);
+bool inventory_loader_finish(InventoryLoader* loader);
+bool inventory_remove_product(Inventory* inv, ProductId productId);
+Product* inventory_get_product(Inventory* inv, ProductId productId);
+bool inventory_update_stock(Inventory* inv, ProductId productId, int newStock);
+// Resolve ascending product ids. Dense requests take one forward walk of
+// the skip list, resuming each search from the previous one's path; sparse
+// ones probe the hash index. out[i] is NULL for an unknown id. Returns the
+// number found.
+int inventory_lookup_sorted(Inventory* inv, const ProductId* ids, int count, Product** out);
+// Set several stock levels as one undo step, restoring heap order once for
+// the group. Products must come from this inventory and appear only once.
+typedef struct StockChange {
+    Product* product;
+    int newStock;
+} StockChange;
+bool inventory_update_stocks(Inventory* inv, const StockChange* changes, int count);
 void inventory_print_all(Inventory* inv);
 
-// Low-stock min-heap API
-// Push updated product into heap (called internally on stock changes)
+// Number of live products
+int inventory_count(Inventory* inv);
+// Visit every product in ascending id order
+typedef void (*ProductVisitor)(Product* p, void* ctx);
+void inventory_for_each(Inventory* inv, ProductVisitor visit, void* ctx);
+
+// Secondary indexes, maintained incrementally by add/update/remove/undo.
+// Visitors must not modify the inventory.
+// Visit products with minPrice <= price <= maxPrice in ascending price order
+void inventory_for_each_in_price_range(Inventory* inv, double minPrice, double maxPrice,
+                                       ProductVisitor visit, void* ctx);
+// The same walk for visitors that stop it by returning false
+typedef bool (*ProductWalker)(Product* p, void* ctx);
+void inventory_walk_price_range(Inventory* inv, double minPrice, double maxPrice,
+                                ProductWalker visit, void* ctx);
+// Visit products in a category (exact match, unordered)
+void inventory_for_each_in_category(Inventory* inv, const char* category,
+                                    ProductVisitor visit, void* ctx);
+int inventory_category_count(Inventory* inv, const char* category);
+// Visit products whose name starts with prefix, in name order, or contains
+// text, in id order; both ignore ASCII case
+void inventory_for_each_name_prefix(Inventory* inv, const char* prefix,
+                                    ProductVisitor visit, void* ctx);
+void inventory_for_each_name_containing(Inventory* inv, const char* text,
+                                        ProductVisitor visit, void* ctx);
+// Typeahead forms: stop after max matches and return how many were found
+int inventory_suggest_names(Inventory* inv, const char* prefix, Product** out, int max);
+int inventory_find_names(Inventory* inv, const char* text, Product** out, int max);
+
+// Predicates for a full-catalog columnar scan; unset fields match everything
+typedef struct ProductFilter {
+    bool hasPriceMin;
+    double priceMin;
+    bool hasPriceMax;
+    double priceMax;
+    bool onlyInStock;
+    const char* category;  // NULL matches any category
+    bool hasSupplier;
+    int supplierId;
+} ProductFilter;
+
+// Evaluate the filter over the columnar shadow store with SIMD kernels and
+// visit matches in storage order: insertion order, shuffled by removals,
+// not id order (search_page sorts what it keeps). Returns the number of
+// matches.
+int inventory_scan(Inventory* inv, const ProductFilter* filter, ProductVisitor visit, void* ctx);
+
+// Low-stock indexed min-heap API (kept in sync on every stock change)
+// Rebuild the heap from the skip list in O(n)
 void inventory_heap_refresh_all(Inventory* inv);
-// Pop products under threshold; returns number printed
+// Collect up to maxCount products with stock <= threshold, lowest first,
+// without modifying the heap; returns number collected
+int inventory_peek_low_stock(Inventory* inv, int threshold, Product** out, int maxCount);
+// Print products with stock <= threshold (non-destructive); returns number printed
 int inventory_pop_low_stock_alerts(Inventory* inv, int threshold, int maxCount);
 
-// Undo stack (simple)
+// Log every later mutation (including undo) to the write-ahead log;
+// pass NULL to detach. Bulk loads are never logged.
+void inventory_attach_wal(Inventory* inv, Wal* wal);
+
+// Undo stack (simple). False if there is nothing to undo, or if restoring
+// ran out of memory, in which case the step stays on the stack.
 bool inventory_undo_last(Inventory* inv);
+// Forget every undo step, e.g. once recovery has replayed changes that an
+// earlier session made
+void inventory_clear_undo(Inventory* inv);
 
 #endif // INVENTORY_H
 
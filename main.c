@@ -1,11 +1,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "commands.h"
 #include "common.h"
+#include "exporter.h"
+#include "fulfillment.h"
+#include "importer.h"
 #include "inventory.h"
+#include "metrics.h"
 #include "orders.h"
 #include "search.h"
+#include "snapshot.h"
 #include "suppliers.h"
+#include "wal.h"
 
 #define VERSION "1.0.0"
 
@@ -16,6 +23,13 @@ typedef struct Config {
     char data_dir[256];
     char import_file[256];
     char export_file[256];
+    char script_file[256];
+    bool has_export_format;
+    ExportFormat export_format;
+    WalDurability durability;
+    int workers;
+    bool has_stats;
+    MetricsFormat stats_format;
 } Config;
 
 static void print_help(const char* program_name) {
@@ -27,13 +41,26 @@ static void print_help(const char* program_name) {
     printf("  -d, --debug        Enable debug mode\n");
     printf("  -q, --quiet        Run in quiet mode\n");
     printf("  -b, --batch        Run in batch mode (non-interactive)\n");
-    printf("  --data-dir DIR     Specify data directory (default: current)\n");
-    printf("  -i, --import FILE  Import data from file\n");
-    printf("  -e, --export FILE  Export data to file\n");
+    printf("  --data-dir DIR     Snapshot directory, loaded at start and saved on exit\n");
+    printf("                     (default: current)\n");
+    printf("  --durability MODE  Write-ahead log fsync policy: none, group, sync\n");
+    printf("                     (default: group)\n");
+    printf("  --workers N        Fulfillment worker threads (default: one per CPU)\n");
+    printf("  -s, --script FILE  Run line commands from FILE (\"-\" reads stdin)\n");
+    printf("                     instead of the menus; one response line each\n");
+    printf("  -i, --import FILE  Import products (P), suppliers (S) and orders (O)\n");
+    printf("                     from a tagged CSV file\n");
+    printf("  -e, --export FILE  Export all data on exit (\"-\" writes to stdout)\n");
+    printf("  --export-format F  Export format: csv, jsonl, bin\n");
+    printf("                     (default: from the file extension, else csv)\n");
+    printf("  --stats FORMAT     Print counters and latency histograms to stderr\n");
+    printf("                     on exit: text, json\n");
     printf("\nExamples:\n");
     printf("  %s                    # Run interactive mode\n", program_name);
     printf("  %s --debug            # Run with debug output\n", program_name);
     printf("  %s --import data.csv  # Import from CSV file\n", program_name);
+    printf("  %s --script ops.txt   # Replay a command script\n", program_name);
+    printf("  %s -b -e - --export-format jsonl | gzip > dump.jsonl.gz\n", program_name);
 }
 
 static void print_version() {
@@ -45,6 +72,7 @@ static bool parse_arguments(int argc, char* argv[], Config* config) {
     // Initialize config with defaults
     memset(config, 0, sizeof(Config));
     strcpy(config->data_dir, ".");
+    config->durability = WAL_DURABILITY_GROUP;
     
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -66,6 +94,23 @@ static bool parse_arguments(int argc, char* argv[], Config* config) {
                 fprintf(stderr, "Error: --data-dir requires a directory path\n");
                 return false;
             }
+        } else if (strcmp(argv[i], "--durability") == 0) {
+            if (i + 1 >= argc || !wal_parse_durability(argv[++i], &config->durability)) {
+                fprintf(stderr, "Error: --durability requires one of: none, group, sync\n");
+                return false;
+            }
+        } else if (strcmp(argv[i], "--workers") == 0) {
+            if (i + 1 >= argc || (config->workers = atoi(argv[++i])) <= 0) {
+                fprintf(stderr, "Error: --workers requires a positive count\n");
+                return false;
+            }
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--script") == 0) {
+            if (i + 1 < argc) {
+                strncpy(config->script_file, argv[++i], sizeof(config->script_file) - 1);
+            } else {
+                fprintf(stderr, "Error: --script requires a file path\n");
+                return false;
+            }
         } else if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--import") == 0) {
             if (i + 1 < argc) {
                 strncpy(config->import_file, argv[++i], sizeof(config->import_file) - 1);
@@ -80,12 +125,35 @@ static bool parse_arguments(int argc, char* argv[], Config* config) {
                 fprintf(stderr, "Error: --export requires a file path\n");
                 return false;
             }
+        } else if (strcmp(argv[i], "--export-format") == 0) {
+            if (i + 1 >= argc || !export_parse_format(argv[++i], &config->export_format)) {
+                fprintf(stderr, "Error: --export-format requires one of: csv, jsonl, bin\n");
+                return false;
+            }
+            config->has_export_format = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            if (i + 1 >= argc || !metrics_parse_format(argv[++i], &config->stats_format)) {
+                fprintf(stderr, "Error: --stats requires one of: text, json\n");
+                return false;
+            }
+            config->has_stats = true;
         } else {
             fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
             fprintf(stderr, "Use -h or --help for usage information\n");
             return false;
         }
     }
+    
+    // Script responses own stdout
+    if (strlen(config->script_file) > 0) config->quiet_mode = true;
+    
+    if (strlen(config->export_file) > 0) {
+        if (!config->has_export_format) {
+            config->export_format = export_format_for_path(config->export_file);
+        }
+        // Keep stdout clean for the exported stream
+        if (strcmp(config->export_file, "-") == 0) config->quiet_mode = true;
+    }
     return true;
 }
 
@@ -104,8 +172,10 @@ static void seed_sample_data(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq)
     inventory_add_product(inv, p3);
     inventory_add_product(inv, p4);
 
-    Order o1 = { .id = 1, .customer = "Alice", .numItems = 2, .items = {{101, 2}, {102, 1}} };
-    Order o2 = { .id = 2, .customer = "Bob", .numItems = 1, .items = {{201, 1}} };
+    OrderItem items1[] = { {101, 2}, {102, 1} };
+    OrderItem items2[] = { {201, 1} };
+    Order o1 = { .id = 1, .customer = "Alice", .numItems = 2, .items = items1 };
+    Order o2 = { .id = 2, .customer = "Bob", .numItems = 1, .items = items2 };
     orders_enqueue(oq, o1); orders_enqueue(oq, o2);
 }
 
@@ -125,31 +195,31 @@ static void menu_inventory(Inventory* inv, const Config* config) {
         ch = safe_read_int();
         if (ch == 1) {
             Product p; memset(&p, 0, sizeof(p));
-            printf("ID: "); p.id = safe_read_int();
+            printf("ID: "); p.id = safe_read_llong();
             printf("Name: "); scanf(" %63[^\n]", p.name);
             printf("Category: "); scanf(" %31[^\n]", p.category);
             printf("Supplier ID: "); p.supplierId = safe_read_int();
             printf("Price: "); p.price = safe_read_double();
             printf("Stock: "); p.stock = safe_read_int();
             if (inventory_add_product(inv, p)) {
-                if (config->debug_mode) printf("[DEBUG] Product %d added successfully\n", p.id);
+                if (config->debug_mode) printf("[DEBUG] Product %lld added successfully\n", p.id);
                 if (!config->quiet_mode) printf("Added.\n");
             } else {
                 if (!config->quiet_mode) printf("Add failed (duplicate ID?).\n");
             }
         } else if (ch == 2) {
-            printf("Product ID: "); int id = safe_read_int();
+            printf("Product ID: "); ProductId id = safe_read_llong();
             printf("New stock: "); int ns = safe_read_int();
             if (inventory_update_stock(inv, id, ns)) {
-                if (config->debug_mode) printf("[DEBUG] Stock updated for product %d to %d\n", id, ns);
+                if (config->debug_mode) printf("[DEBUG] Stock updated for product %lld to %d\n", id, ns);
                 if (!config->quiet_mode) printf("Updated.\n");
             } else {
                 if (!config->quiet_mode) printf("Update failed.\n");
             }
         } else if (ch == 3) {
-            printf("Product ID: "); int id = safe_read_int();
+            printf("Product ID: "); ProductId id = safe_read_llong();
             if (inventory_remove_product(inv, id)) {
-                if (config->debug_mode) printf("[DEBUG] Product %d removed\n", id);
+                if (config->debug_mode) printf("[DEBUG] Product %lld removed\n", id);
                 if (!config->quiet_mode) printf("Removed.\n");
             } else {
                 if (!config->quiet_mode) printf("Remove failed.\n");
@@ -157,7 +227,9 @@ static void menu_inventory(Inventory* inv, const Config* config) {
         } else if (ch == 4) {
             inventory_print_all(inv);
         } else if (ch == 5) {
-            if (!inventory_undo_last(inv)) {
+            if (inventory_undo_last(inv)) {
+                if (!config->quiet_mode) printf("Undo completed.\n");
+            } else {
                 if (!config->quiet_mode) printf("Nothing to undo.\n");
             }
         } else if (ch == 6) {
@@ -168,7 +240,7 @@ static void menu_inventory(Inventory* inv, const Config* config) {
     }
 }
 
-static void menu_orders(OrdersQueue* oq, Inventory* inv, const Config* config) {
+static void menu_orders(OrdersQueue* oq, Inventory* inv, FulfillmentPool* pool, const Config* config) {
     int ch = -1;
     while (ch != 0) {
         if (!config->quiet_mode) {
@@ -176,6 +248,7 @@ static void menu_orders(OrdersQueue* oq, Inventory* inv, const Config* config) {
             printf(COL_YELLOW "1" COL_RESET ". Enqueue order    " COL_DIM "(add new customer order)" COL_RESET "\n");
             printf(COL_YELLOW "2" COL_RESET ". Process next     " COL_DIM "(fulfill oldest pending order)" COL_RESET "\n");
             printf(COL_YELLOW "3" COL_RESET ". Print queue      " COL_DIM "(show all pending orders)" COL_RESET "\n");
+            printf(COL_YELLOW "4" COL_RESET ". Fulfill all      " COL_DIM "(drain the queue on worker threads)" COL_RESET "\n");
             printf(COL_YELLOW "0" COL_RESET ". Back             " COL_DIM "(return to main menu)" COL_RESET "\n> ");
         }
         ch = safe_read_int();
@@ -183,15 +256,18 @@ static void menu_orders(OrdersQueue* oq, Inventory* inv, const Config* config) {
             Order o; memset(&o, 0, sizeof(o));
             printf("Order ID: "); o.id = safe_read_int();
             printf("Customer: "); scanf(" %63[^\n]", o.customer);
-            printf("Num items (<=%d): ", MAX_ORDER_ITEMS); o.numItems = safe_read_int(); 
-            if (o.numItems > MAX_ORDER_ITEMS) o.numItems = MAX_ORDER_ITEMS;
+            printf("Num items: "); o.numItems = safe_read_int(); 
+            if (o.numItems < 0) o.numItems = 0;
+            o.items = (OrderItem*)malloc((size_t)(o.numItems ? o.numItems : 1) * sizeof(OrderItem));
+            if (!o.items) { printf("Out of memory.\n"); continue; }
             for (int i = 0; i < o.numItems; ++i) { 
                 printf("Item %d - Product ID: ", i+1); 
-                o.items[i].productId = safe_read_int(); 
+                o.items[i].productId = safe_read_llong(); 
                 printf("Item %d - Quantity: ", i+1); 
                 o.items[i].quantity = safe_read_int(); 
             }
             orders_enqueue(oq, o); 
+            free(o.items);
             if (config->debug_mode) printf("[DEBUG] Order %d enqueued for %s\n", o.id, o.customer);
             if (!config->quiet_mode) printf("Enqueued.\n");
         } else if (ch == 2) {
@@ -199,6 +275,13 @@ static void menu_orders(OrdersQueue* oq, Inventory* inv, const Config* config) {
             orders_process_next(oq, inv);
         } else if (ch == 3) {
             orders_print(oq);
+        } else if (ch == 4) {
+            FulfillmentStats stats;
+            int taken = fulfillment_drain(pool, oq, 0, &stats);
+            if (!config->quiet_mode) {
+                printf("Processed %d orders on %d workers: %lld fulfilled, %lld failed (%.3f s)\n",
+                       taken, fulfillment_workers(pool), stats.fulfilled, stats.failed, stats.seconds);
+            }
         }
     }
 }
@@ -214,6 +297,9 @@ static void menu_search(Inventory* inv, SuppliersDB* sdb, const Config* config)
             printf(COL_YELLOW "3" COL_RESET ". Only in stock    " COL_DIM "(show available items only)" COL_RESET "\n");
             printf(COL_YELLOW "4" COL_RESET ". Sort by price    " COL_DIM "(order results by cost)" COL_RESET "\n");
             printf(COL_YELLOW "5" COL_RESET ". Run search       " COL_DIM "(execute search with filters)" COL_RESET "\n");
+            printf(COL_YELLOW "6" COL_RESET ". Supplier filter  " COL_DIM "(minimum supplier score and ratings)" COL_RESET "\n");
+            printf(COL_YELLOW "7" COL_RESET ". Sort by supplier " COL_DIM "(best supplier score first)" COL_RESET "\n");
+            printf(COL_YELLOW "8" COL_RESET ". Name filter      " COL_DIM "(name prefix and/or substring)" COL_RESET "\n");
             printf(COL_YELLOW "0" COL_RESET ". Back             " COL_DIM "(return to main menu)" COL_RESET "\n> ");
         }
         ch = safe_read_int();
@@ -238,6 +324,27 @@ static void menu_search(Inventory* inv, SuppliersDB* sdb, const Config* config)
         } else if (ch == 5) { 
             if (config->debug_mode) printf("[DEBUG] Executing search...\n");
             search_build_and_execute(inv, sdb, c); 
+        } else if (ch == 6) {
+            printf("Min supplier score (0 to skip): ");
+            double min = safe_read_double();
+            c.hasSupplierScoreMin = min > 0; c.supplierScoreMin = min;
+            SupplierRatings* r = &c.supplierRatingsMin;
+            printf("Min quality, delivery, price, reliability, service (0 to skip each): ");
+            r->quality = safe_read_double(); r->deliveryTime = safe_read_double(); r->price = safe_read_double();
+            r->reliability = safe_read_double(); r->customerService = safe_read_double();
+            c.hasSupplierRatingsMin = r->quality > 0 || r->deliveryTime > 0 || r->price > 0 ||
+                                      r->reliability > 0 || r->customerService > 0;
+            if (config->debug_mode) printf("[DEBUG] Supplier score >= %.2f\n", c.supplierScoreMin);
+        } else if (ch == 7) {
+            c.sortBy = 's';
+            if (!config->quiet_mode) printf("Sorting by supplier score enabled.\n");
+        } else if (ch == 8) {
+            printf("Name starts with (- to skip): "); scanf(" %63[^\n]", c.namePrefix);
+            c.hasNamePrefix = strcmp(c.namePrefix, "-") != 0;
+            printf("Name contains (- to skip): "); scanf(" %63[^\n]", c.nameContains);
+            c.hasNameContains = strcmp(c.nameContains, "-") != 0;
+            if (config->debug_mode) printf("[DEBUG] Name prefix: %s, contains: %s\n",
+                c.hasNamePrefix ? c.namePrefix : "-", c.hasNameContains ? c.nameContains : "-");
         }
     }
 }
@@ -279,13 +386,45 @@ static void menu_suppliers(SuppliersDB* sdb, const Config* config) {
     }
 }
 
+// Checkpoint: the log is only truncated once the snapshot is durable
+static bool checkpoint(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, Wal* wal, const Config* config) {
+    if (!snapshot_save(config->data_dir, inv, sdb, oq, wal_last_lsn(wal))) {
+        fprintf(stderr, "Warning: could not write snapshot to %s\n", config->data_dir);
+        return false;
+    }
+    if (wal) wal_checkpoint(wal);
+    if (config->debug_mode) printf("[DEBUG] Snapshot written to %s\n", config->data_dir);
+    return true;
+}
+
+// Load --import before either mode starts. Imported rows bypass the log;
+// a snapshot makes them durable instead.
+static void run_import(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, Wal* wal, const Config* config) {
+    if (!config->quiet_mode) printf("Importing data from: %s\n", config->import_file);
+    inventory_attach_wal(inv, NULL);
+    orders_attach_wal(oq, NULL);
+    ImportStats stats;
+    if (import_csv(config->import_file, inv, sdb, oq, 0, &stats)) {
+        if (!config->quiet_mode) {
+            printf("Imported %lld products, %lld suppliers, %lld orders from %lld lines",
+                   stats.products, stats.suppliers, stats.orders, stats.lines);
+            if (stats.rejected > 0) printf(" (%lld malformed rows skipped)", stats.rejected);
+            printf("\n");
+        }
+    } else {
+        fprintf(stderr, "Error: import from %s failed after %lld lines\n",
+                config->import_file, stats.lines);
+    }
+    checkpoint(inv, sdb, oq, wal, config);
+    inventory_attach_wal(inv, wal);
+    orders_attach_wal(oq, wal);
+}
+
 static void run_batch_mode(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, const Config* config) {
-    printf("Running in batch mode...\n");
+    // A stdout export owns stdout; skip the listings
+    if (strcmp(config->export_file, "-") == 0) return;
     
-    if (strlen(config->import_file) > 0) {
-        printf("Importing data from: %s\n", config->import_file);
-        // TODO: Implement import functionality
-    }
+    printf("Running in batch mode...\n");
     
     // Example batch operations
     printf("Displaying current inventory:\n");
@@ -296,10 +435,29 @@ static void run_batch_mode(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, co
     
     printf("\nDisplaying order queue:\n");
     orders_print(oq);
-    
-    if (strlen(config->export_file) > 0) {
-        printf("Exporting data to: %s\n", config->export_file);
-        // TODO: Implement export functionality
+}
+
+static void run_script(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, FulfillmentPool* pool, const Config* config) {
+    // Responses are block-buffered; commands_run flushes at the end
+    static char outBuffer[1 << 16];
+    setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+    CommandStats stats;
+    if (!commands_run(config->script_file, inv, sdb, oq, pool, stdout, &stats)) {
+        fprintf(stderr, "Error: cannot read script %s\n", config->script_file);
+    } else if (config->debug_mode) {
+        fprintf(stderr, "[DEBUG] %lld commands, %lld failed\n", stats.commands, stats.failed);
+    }
+}
+
+// Write --export once the session's changes are in
+static void run_export(Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, const Config* config) {
+    if (!config->quiet_mode) printf("Exporting data to: %s\n", config->export_file);
+    ExportStats stats;
+    if (!export_data(config->export_file, config->export_format, inv, sdb, oq, &stats)) {
+        fprintf(stderr, "Error: export to %s failed\n", config->export_file);
+    } else if (!config->quiet_mode) {
+        printf("Exported %lld products, %lld suppliers, %lld orders (%lld bytes)\n",
+               stats.products, stats.suppliers, stats.orders, stats.bytes);
     }
 }
 
@@ -318,9 +476,43 @@ int main(int argc, char* argv[]) {
     Inventory* inv = inventory_create();
     SuppliersDB* sdb = suppliers_create();
     OrdersQueue* oq = orders_create();
-    seed_sample_data(inv, sdb, oq);
+    uint64_t snapshotLsn = 0;
+    SnapshotStatus snapshot = snapshot_load(config.data_dir, inv, sdb, oq, &snapshotLsn);
+    if (snapshot == SNAPSHOT_INVALID) {
+        // Seeding or checkpointing now would overwrite the only copy of the data
+        fprintf(stderr, "Error: refusing to start; repair or move aside %s/%s to start over\n",
+                config.data_dir, SNAPSHOT_FILE);
+        orders_destroy(oq);
+        suppliers_destroy(sdb);
+        inventory_destroy(inv);
+        return 1;
+    }
+    if (snapshot == SNAPSHOT_LOADED) {
+        if (config.debug_mode) printf("[DEBUG] Loaded snapshot from %s\n", config.data_dir);
+    } else {
+        seed_sample_data(inv, sdb, oq);
+    }
     
-    if (config.batch_mode) {
+    // Recover mutations made since the snapshot, then log new ones
+    Wal* wal = wal_open(config.data_dir, config.durability, WAL_GROUP_RECORDS, WAL_GROUP_WINDOW_MS);
+    if (wal) {
+        int replayed = wal_replay(wal, inv, oq, snapshotLsn);
+        if (config.debug_mode) printf("[DEBUG] Replayed %d write-ahead log records\n", replayed);
+        inventory_attach_wal(inv, wal);
+        orders_attach_wal(oq, wal);
+    } else {
+        fprintf(stderr, "Warning: write-ahead log unavailable in %s; changes are not durable\n", config.data_dir);
+    }
+    
+    if (strlen(config.import_file) > 0) {
+        run_import(inv, sdb, oq, wal, &config);
+    }
+    
+    FulfillmentPool* pool = fulfillment_create(inv, config.workers);
+    
+    if (strlen(config.script_file) > 0) {
+        run_script(inv, sdb, oq, pool, &config);
+    } else if (config.batch_mode) {
         run_batch_mode(inv, sdb, oq, &config);
     } else {
         int choice = -1;
@@ -336,7 +528,7 @@ int main(int argc, char* argv[]) {
             choice = safe_read_int();
             switch (choice) {
                 case 1: menu_inventory(inv, &config); break;
-                case 2: menu_orders(oq, inv, &config); break;
+                case 2: menu_orders(oq, inv, pool, &config); break;
                 case 3: menu_search(inv, sdb, &config); break;
                 case 4: menu_suppliers(sdb, &config); break;
                 case 0: break;
@@ -345,6 +537,20 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (strlen(config.export_file) > 0) {
+        run_export(inv, sdb, oq, &config);
+    }
+    if (config.has_stats) {
+        // stderr, since stdout may carry script responses or an export
+        metrics_write(stderr, config.stats_format);
+    }
+    
+    fulfillment_destroy(pool);
+    checkpoint(inv, sdb, oq, wal, &config);
+    inventory_attach_wal(inv, NULL);
+    orders_attach_wal(oq, NULL);
+    wal_close(wal);
+
     orders_destroy(oq);
     suppliers_destroy(sdb);
     inventory_destroy(inv);
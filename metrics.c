@@ -0,0 +1,283 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+// Gauge probes and the shard list; neither is touched on the hot path
+static pthread_mutex_t registry = PTHREAD_MUTEX_INITIALIZER;
+static MetricProbe probes[METRIC_GAUGES];
+static void* probeCtx[METRIC_GAUGES];
+
+bool metrics_parse_format(const char* name, MetricsFormat* out) {
+    if (strcasecmp(name, "text") == 0) *out = METRICS_TEXT;
+    else if (strcasecmp(name, "json") == 0) *out = METRICS_JSON;
+    else return false;
+    return true;
+}
+
+void metrics_watch(MetricGauge g, MetricProbe probe, void* ctx) {
+    pthread_mutex_lock(&registry);
+    probes[g] = probe;
+    probeCtx[g] = ctx;
+    pthread_mutex_unlock(&registry);
+}
+
+void metrics_unwatch(void* ctx) {
+    pthread_mutex_lock(&registry);
+    for (int g = 0; g < METRIC_GAUGES; g++) {
+        if (probes[g] && probeCtx[g] == ctx) probes[g] = NULL;
+    }
+    pthread_mutex_unlock(&registry);
+}
+
+#ifndef SCMS_NO_METRICS
+
+static const char* COUNTER_NAMES[METRIC_COUNTERS] = {
+    "index_lookups", "index_probes", "skip_searches", "skip_levels", "skip_steps",
+    "heap_sifts", "heap_rebuilds", "alerts_reported", "undo_pushes", "undo_pops",
+    "orders_enqueued", "orders_dequeued", "orders_fulfilled", "orders_failed", "segment_waits",
+    "search_pages", "search_examined", "search_hits", "supplier_lookups", "supplier_misses",
+};
+
+static const char* GAUGE_NAMES[METRIC_GAUGES] = {
+    "products", "heap_size", "skip_level", "undo_depth", "queue_depth", "suppliers",
+};
+
+static const char* OP_NAMES[METRIC_OPS] = {
+    "inventory_add_product", "inventory_remove_product", "inventory_get_product",
+    "inventory_update_stock", "inventory_update_stocks", "inventory_lookup_sorted",
+    "inventory_pop_low_stock_alerts", "inventory_undo_last", "orders_enqueue",
+    "orders_fulfill", "orders_process_next", "orders_process_batch", "search_page",
+    "suppliers_insert", "suppliers_delete", "suppliers_find_by_id", "suppliers_top_k",
+    "suppliers_set_weights",
+};
+
+__thread MetricsShard* metrics_local;
+__thread int metrics_depth;
+// Shards of running threads, and the sum of those that have exited
+static MetricsShard* shards;
+static MetricsShard retired;
+// Frees a thread's shard when it exits
+static pthread_key_t shardKey;
+static pthread_once_t shardKeyOnce = PTHREAD_ONCE_INIT;
+// Ticks and wall time when the first shard was made, for the tick rate
+static bool started;
+static uint64_t epochTicks;
+static uint64_t epochNs;
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Thread exit: fold the shard into the retired total and free it. Only
+// the exiting thread writes its shard, so plain reads are enough here.
+static void retire_shard(void* value) {
+    MetricsShard* s = (MetricsShard*)value;
+    pthread_mutex_lock(&registry);
+    MetricsShard** link = &shards;
+    while (*link != s) link = &(*link)->next;
+    *link = s->next;
+    for (int c = 0; c < METRIC_COUNTERS; c++) retired.counters[c] += s->counters[c];
+    for (int op = 0; op < METRIC_OPS; op++) {
+        const MetricHistogram* h = &s->ops[op];
+        MetricHistogram* sum = &retired.ops[op];
+        sum->count += h->count;
+        sum->sum += h->sum;
+        if (h->max > sum->max) sum->max = h->max;
+        for (int b = 0; b < HIST_BUCKETS; b++) sum->buckets[b] += h->buckets[b];
+    }
+    pthread_mutex_unlock(&registry);
+    if (metrics_local == s) metrics_local = NULL;
+    free(s);
+}
+
+static void create_shard_key(void) {
+    pthread_key_create(&shardKey, retire_shard);
+}
+
+MetricsShard* metrics_attach(void) {
+    pthread_once(&shardKeyOnce, create_shard_key);
+    MetricsShard* s = (MetricsShard*)calloc(1, sizeof(MetricsShard));
+    if (!s) return NULL;
+    if (pthread_setspecific(shardKey, s) != 0) {
+        free(s);
+        return NULL;
+    }
+    pthread_mutex_lock(&registry);
+    if (!started) {
+        started = true;
+        epochNs = clock_ns();
+        epochTicks = metrics_now();
+    }
+    s->next = shards;
+    shards = s;
+    pthread_mutex_unlock(&registry);
+    metrics_local = s;
+    return s;
+}
+
+static void bump(uint64_t* field, uint64_t n) {
+    __atomic_store_n(field, __atomic_load_n(field, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+void metrics_record(MetricOp op, uint64_t ticks) {
+    MetricsShard* s = metrics_local ? metrics_local : metrics_attach();
+    if (!s) return;
+    MetricHistogram* h = &s->ops[op];
+    bump(&h->count, 1);
+    bump(&h->sum, ticks);
+    if (ticks > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) __atomic_store_n(&h->max, ticks, __ATOMIC_RELAXED);
+    bump(&h->buckets[hist_bucket(ticks)], 1);
+}
+
+// Sum of every shard, under the registry lock so none is added meanwhile
+typedef struct MetricsTotals {
+    uint64_t counters[METRIC_COUNTERS];
+    long long gauges[METRIC_GAUGES];
+    bool hasGauge[METRIC_GAUGES];
+    MetricHistogram ops[METRIC_OPS];
+    double nsPerTick;
+} MetricsTotals;
+
+// One operation's latency in nanoseconds
+typedef struct OpSummary {
+    unsigned long long count;
+    double mean;
+    unsigned long long p50;
+    unsigned long long p99;
+    unsigned long long p999;
+    unsigned long long max;
+} OpSummary;
+
+static void collect(MetricsTotals* t) {
+    memset(t, 0, sizeof(MetricsTotals));
+    pthread_mutex_lock(&registry);
+    // The retired total first, then every live shard
+    for (const MetricsShard* s = &retired; s; s = s == &retired ? shards : s->next) {
+        for (int c = 0; c < METRIC_COUNTERS; c++) {
+            t->counters[c] += __atomic_load_n(&s->counters[c], __ATOMIC_RELAXED);
+        }
+        for (int op = 0; op < METRIC_OPS; op++) {
+            const MetricHistogram* h = &s->ops[op];
+            MetricHistogram* sum = &t->ops[op];
+            if (!__atomic_load_n(&h->count, __ATOMIC_RELAXED)) continue;
+            uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+            if (max > sum->max) sum->max = max;
+            sum->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+            // Count from the buckets so percentiles stay consistent
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                uint64_t n = __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+                sum->buckets[b] += n;
+                sum->count += n;
+            }
+        }
+    }
+    for (int g = 0; g < METRIC_GAUGES; g++) {
+        if (!probes[g]) continue;
+        t->gauges[g] = probes[g](probeCtx[g]);
+        t->hasGauge[g] = true;
+    }
+#ifdef METRICS_TSC
+    uint64_t ticks = metrics_now() - epochTicks, ns = clock_ns() - epochNs;
+    t->nsPerTick = started && ticks > 0 ? (double)ns / (double)ticks : 1.0;
+#else
+    t->nsPerTick = 1.0;
+#endif
+    pthread_mutex_unlock(&registry);
+}
+
+static void summarize(const MetricHistogram* h, double nsPerTick, OpSummary* out) {
+    out->count = h->count;
+    out->mean = h->count ? (double)h->sum / (double)h->count * nsPerTick : 0;
+    out->p50 = (unsigned long long)((double)hist_percentile(h->buckets, h->count, h->max, 0.50) * nsPerTick + 0.5);
+    out->p99 = (unsigned long long)((double)hist_percentile(h->buckets, h->count, h->max, 0.99) * nsPerTick + 0.5);
+    out->p999 = (unsigned long long)((double)hist_percentile(h->buckets, h->count, h->max, 0.999) * nsPerTick + 0.5);
+    out->max = (unsigned long long)((double)h->max * nsPerTick + 0.5);
+}
+
+void metrics_write(FILE* out, MetricsFormat format) {
+    MetricsTotals* t = (MetricsTotals*)malloc(sizeof(MetricsTotals));
+    if (!t) {
+        fprintf(stderr, "Error: out of memory collecting metrics\n");
+        return;
+    }
+    collect(t);
+
+    if (format == METRICS_JSON) {
+        fputs("{\"counters\":{", out);
+        for (int c = 0; c < METRIC_COUNTERS; c++) {
+            fprintf(out, "%s\"%s\":%llu", c ? "," : "", COUNTER_NAMES[c], (unsigned long long)t->counters[c]);
+        }
+        fputs("},\"gauges\":{", out);
+        bool first = true;
+        for (int g = 0; g < METRIC_GAUGES; g++) {
+            if (!t->hasGauge[g]) continue;
+            fprintf(out, "%s\"%s\":%lld", first ? "" : ",", GAUGE_NAMES[g], t->gauges[g]);
+            first = false;
+        }
+        fputs("},\"latency_ns\":{", out);
+        first = true;
+        for (int op = 0; op < METRIC_OPS; op++) {
+            if (!t->ops[op].count) continue;
+            OpSummary o;
+            summarize(&t->ops[op], t->nsPerTick, &o);
+            fprintf(out, "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                    first ? "" : ",", OP_NAMES[op], o.count, o.mean, o.p50, o.p99, o.p999, o.max);
+            first = false;
+        }
+        fputs("}}\n", out);
+        free(t);
+        return;
+    }
+
+    fprintf(out, "\n-- Metrics --\n");
+    for (int c = 0; c < METRIC_COUNTERS; c++) {
+        fprintf(out, "%-20s %14llu\n", COUNTER_NAMES[c], (unsigned long long)t->counters[c]);
+    }
+    for (int g = 0; g < METRIC_GAUGES; g++) {
+        if (t->hasGauge[g]) fprintf(out, "%-20s %14lld\n", GAUGE_NAMES[g], t->gauges[g]);
+    }
+    fprintf(out, "\n%-31s %10s %10s %10s %10s %10s %10s\n",
+            "Operation (ns)", "Count", "Mean", "p50", "p99", "p99.9", "Max");
+    for (int op = 0; op < METRIC_OPS; op++) {
+        if (!t->ops[op].count) continue;
+        OpSummary o;
+        summarize(&t->ops[op], t->nsPerTick, &o);
+        fprintf(out, "%-31s %10llu %10.0f %10llu %10llu %10llu %10llu\n",
+                OP_NAMES[op], o.count, o.mean, o.p50, o.p99, o.p999, o.max);
+    }
+    free(t);
+}
+
+void metrics_reset(void) {
+    pthread_mutex_lock(&registry);
+    memset(&retired, 0, sizeof(retired));
+    // Live shards may be recording, so zero them field by field the way
+    // their owners write them
+    for (MetricsShard* s = shards; s; s = s->next) {
+        for (int c = 0; c < METRIC_COUNTERS; c++) __atomic_store_n(&s->counters[c], 0, __ATOMIC_RELAXED);
+        for (int op = 0; op < METRIC_OPS; op++) {
+            MetricHistogram* h = &s->ops[op];
+            __atomic_store_n(&h->count, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&h->sum, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+            for (int b = 0; b < HIST_BUCKETS; b++) __atomic_store_n(&h->buckets[b], 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&registry);
+}
+
+#else
+
+void metrics_write(FILE* out, MetricsFormat format) {
+    if (format == METRICS_JSON) fputs("{\"enabled\":false}\n", out);
+    else fputs("Metrics are disabled in this build (SCMS_NO_METRICS)\n", out);
+}
+
+void metrics_reset(void) {
+}
+
+#endif // SCMS_NO_METRICS
@@ -0,0 +1,169 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "histogram.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define METRICS_TSC 1
+#include <x86intrin.h>
+#endif
+
+// Hot-path instrumentation: event counters and per-operation latency
+// histograms. Each thread writes its own shard with plain relaxed stores,
+// so recording never contends; metrics_write sums the shards. Gauges are
+// sampled from registered probes only when written. On x86 latencies are
+// taken from the time-stamp counter, a fraction of the cost of
+// clock_gettime, and converted to nanoseconds at the tick rate observed
+// between the first recording and the write. Only the outermost timed
+// call on a thread is timed: orders_fulfill is recorded, the product
+// lookups and stock updates it makes are not (their counters still count).
+//
+// Building with -DSCMS_NO_METRICS turns every METRIC_* macro into nothing;
+// metrics_write then only reports that metrics are disabled.
+
+typedef enum MetricCounter {
+    METRIC_INDEX_LOOKUPS,       // Product hash index lookups
+    METRIC_INDEX_PROBES,        // Slots examined by them
+    METRIC_SKIP_SEARCHES,       // Skip list descents (insert/delete)
+    METRIC_SKIP_LEVELS,         // Levels traversed by them
+    METRIC_SKIP_STEPS,          // Forward pointers followed by them
+    METRIC_HEAP_SIFTS,          // Levels moved by low-stock heap sifts
+    METRIC_HEAP_REBUILDS,       // Whole-heap heapifies
+    METRIC_ALERTS_REPORTED,     // Low-stock alerts reported
+    METRIC_UNDO_PUSHES,
+    METRIC_UNDO_POPS,
+    METRIC_ORDERS_ENQUEUED,
+    METRIC_ORDERS_DEQUEUED,
+    METRIC_ORDERS_FULFILLED,
+    METRIC_ORDERS_FAILED,
+    METRIC_SEGMENT_WAITS,       // Enqueues that waited for a segment switch
+    METRIC_SEARCH_PAGES,
+    METRIC_SEARCH_EXAMINED,     // Products tested against the criteria
+    METRIC_SEARCH_HITS,         // Products that passed
+    METRIC_SUPPLIER_LOOKUPS,
+    METRIC_SUPPLIER_MISSES,
+    METRIC_COUNTERS
+} MetricCounter;
+
+typedef enum MetricGauge {
+    METRIC_GAUGE_PRODUCTS,      // Live products
+    METRIC_GAUGE_HEAP_SIZE,     // Low-stock heap entries
+    METRIC_GAUGE_SKIP_LEVEL,    // Current skip list height
+    METRIC_GAUGE_UNDO_DEPTH,
+    METRIC_GAUGE_QUEUE_DEPTH,   // Orders waiting in the FIFO queue
+    METRIC_GAUGE_SUPPLIERS,
+    METRIC_GAUGES
+} MetricGauge;
+
+typedef enum MetricOp {
+    METRIC_OP_ADD_PRODUCT,
+    METRIC_OP_REMOVE_PRODUCT,
+    METRIC_OP_GET_PRODUCT,
+    METRIC_OP_UPDATE_STOCK,
+    METRIC_OP_UPDATE_STOCKS,
+    METRIC_OP_LOOKUP_SORTED,
+    METRIC_OP_LOW_STOCK_ALERTS,
+    METRIC_OP_UNDO,
+    METRIC_OP_ENQUEUE,
+    METRIC_OP_FULFILL,
+    METRIC_OP_PROCESS_NEXT,
+    METRIC_OP_PROCESS_BATCH,
+    METRIC_OP_SEARCH_PAGE,
+    METRIC_OP_SUPPLIER_INSERT,
+    METRIC_OP_SUPPLIER_DELETE,
+    METRIC_OP_SUPPLIER_FIND,
+    METRIC_OP_SUPPLIER_TOP_K,
+    METRIC_OP_SET_WEIGHTS,
+    METRIC_OPS
+} MetricOp;
+
+typedef enum MetricsFormat {
+    METRICS_TEXT,   // Tables, one line per metric
+    METRICS_JSON    // One JSON object on a single line
+} MetricsFormat;
+
+// Current value of a gauge; ctx is what was passed to metrics_watch
+typedef long long (*MetricProbe)(void* ctx);
+
+bool metrics_parse_format(const char* name, MetricsFormat* out);
+// Sample gauge g through probe(ctx) from now on, replacing any earlier
+// probe for it. Owners unwatch ctx before it goes away.
+void metrics_watch(MetricGauge g, MetricProbe probe, void* ctx);
+void metrics_unwatch(void* ctx);
+// Totals over every thread so far. Counts recorded concurrently may be
+// missed by a write but are never torn.
+void metrics_write(FILE* out, MetricsFormat format);
+// Zero every counter and histogram. Safe while other threads record, but
+// a sample taken during the reset may survive it or be lost.
+void metrics_reset(void);
+
+#ifndef SCMS_NO_METRICS
+
+// Latency histogram in ticks (see histogram.h)
+typedef struct MetricHistogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+} MetricHistogram;
+
+// One thread's metrics; written only by its thread, read by anyone. When
+// the thread exits its counts are folded into a retired total and the
+// shard is freed, so memory stays bounded by the live threads.
+typedef struct MetricsShard {
+    uint64_t counters[METRIC_COUNTERS];
+    MetricHistogram ops[METRIC_OPS];
+    struct MetricsShard* next;
+} MetricsShard;
+
+extern __thread MetricsShard* metrics_local;
+extern __thread int metrics_depth;  // Timed calls in progress on this thread
+// The calling thread's shard, created on first use; NULL if out of memory
+MetricsShard* metrics_attach(void);
+void metrics_record(MetricOp op, uint64_t ticks);
+
+// Single writer, so a relaxed load and store suffice and compile to
+// plain moves; readers still never see a torn value
+static inline void metrics_add(MetricCounter c, uint64_t n) {
+    MetricsShard* s = metrics_local ? metrics_local : metrics_attach();
+    if (!s) return;
+    __atomic_store_n(&s->counters[c], __atomic_load_n(&s->counters[c], __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// Timestamp in ticks: TSC cycles, else nanoseconds
+static inline uint64_t metrics_now(void) {
+#ifdef METRICS_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#define METRIC_ADD(counter, n) metrics_add((counter), (uint64_t)(n))
+#define METRIC_INC(counter) metrics_add((counter), 1)
+// Declares the start time t of an operation timed by METRIC_STOP; every
+// METRIC_START must reach exactly one METRIC_STOP
+#define METRIC_START(t) uint64_t t = metrics_depth++ ? 0 : metrics_now()
+#define METRIC_STOP(op, t) \
+    do { if (--metrics_depth == 0) metrics_record((op), metrics_now() - (t)); } while (0)
+#define METRIC_WATCH(gauge, probe, ctx) metrics_watch((gauge), (probe), (ctx))
+#define METRIC_UNWATCH(ctx) metrics_unwatch(ctx)
+
+#else
+
+#define METRIC_ADD(counter, n) ((void)(n))
+#define METRIC_INC(counter) ((void)0)
+#define METRIC_START(t)
+#define METRIC_STOP(op, t) ((void)0)
+#define METRIC_WATCH(gauge, probe, ctx) ((void)0)
+#define METRIC_UNWATCH(ctx) ((void)0)
+
+#endif // SCMS_NO_METRICS
+
+#endif // METRICS_H
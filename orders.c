@@ -1,71 +1,543 @@
 #include "orders.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
 
-typedef struct OrderNode {
-	Order order;
-	struct OrderNode* next;
-} OrderNode;
+// Orders are stored as variable-length records in a ring of fixed-size
+// segments: a 16-byte header, the items, then the customer name. Producers
+// claim space with one atomic fetch-add on a tail word that packs the
+// segment index with the offset in it, so a claim can never land in a
+// segment that has already been recycled. The producer whose claim runs
+// off the end of a segment closes it and opens the next one; others wait
+// for that and retry. If no segment can be allocated the closer puts the
+// tail back where its claim began and fails its enqueue, and the waiters
+// retry against the old segment. The single consumer reads records in place and hands
+// out their items without copying; a segment is recycled once the consumer
+// has moved past it, at the start of the following dequeue call.
+#define ORDER_SEGMENT_BYTES (64 * 1024)
+#define ORDER_RING_SLOTS 65536
+#define ORDER_OFFSET_BITS 40
+#define ORDER_INDEX_MASK 0xFFFFFFu
+#define ORDER_OFFSET_MASK ((1ULL << ORDER_OFFSET_BITS) - 1)
+// Size word of a segment's last, unused slot
+#define ORDER_SEGMENT_END UINT32_MAX
+// Distinct products an order can fulfill without allocating
+#define ORDER_LOCAL_LINES 16
 
+typedef struct OrderRecord {
+	uint32_t size;         // Whole record; 0 until the producer publishes it
+	int32_t id;
+	uint32_t numItems;
+	uint32_t customerLen;
+} OrderRecord;
+
+typedef struct OrderSegment {
+	size_t capacity;
+	unsigned char data[] __attribute__((aligned(16)));
+} OrderSegment;
+
+// Producer and consumer fields live on separate cache lines
 struct OrdersQueue {
-	OrderNode* head;
-	OrderNode* tail;
-	int count;
+	uint64_t tail __attribute__((aligned(64)));  // Segment index << 40 | offset
+	long enqueued;
+	OrderSegment* spare;   // Zeroed segment recycled by the consumer
+	uint32_t readIndex __attribute__((aligned(64)));
+	size_t readOffset;
+	uint32_t releaseIndex; // Oldest segment not yet recycled
+	long dequeued;
+	Wal* wal;
+	pthread_mutex_t walLock;
+	OrderSegment** ring;
+	// Consumer scratch for orders_process_batch, grown to the largest batch
+	Order* batchOrders;
+	int batchOrderCapacity;
+	struct BatchLine* batchLines;
+	int* lineSlot;
+	ProductId* slotIds;
+	Product** slotProducts;
+	int* slotStock;
+	StockChange* changes;
+	int batchLineCapacity;
 };
 
+// One order line of a batch, tagged with its position for a stable sort
+typedef struct BatchLine {
+	ProductId productId;
+	int line;
+} BatchLine;
+
+typedef struct OrderCursor {
+	uint32_t index;
+	size_t offset;
+} OrderCursor;
+
+static size_t record_size(int numItems, size_t customerLen) {
+	size_t size = sizeof(OrderRecord) + (size_t)numItems * sizeof(OrderItem) + customerLen + 1;
+	return (size + 7) & ~(size_t)7;
+}
+
+static OrderSegment* segment_new(size_t capacity) {
+	OrderSegment* seg = (OrderSegment*)calloc(1, sizeof(OrderSegment) + capacity);
+	if (seg) seg->capacity = capacity;
+	return seg;
+}
+
+static OrderSegment** slot_of(OrdersQueue* q, uint32_t index) {
+	return &q->ring[index & (ORDER_RING_SLOTS - 1)];
+}
+
+#ifndef SCMS_NO_METRICS
+static long long probe_queue_depth(void* ctx) { return orders_count((OrdersQueue*)ctx); }
+#endif
+
 OrdersQueue* orders_create(void) {
-	return (OrdersQueue*)calloc(1, sizeof(OrdersQueue));
+	OrdersQueue* q = (OrdersQueue*)aligned_alloc(64, sizeof(OrdersQueue));
+	if (!q) return NULL;
+	memset(q, 0, sizeof(OrdersQueue));
+	q->ring = (OrderSegment**)calloc(ORDER_RING_SLOTS, sizeof(OrderSegment*));
+	if (q->ring) q->ring[0] = segment_new(ORDER_SEGMENT_BYTES);
+	if (!q->ring || !q->ring[0]) {
+		free(q->ring);
+		free(q);
+		return NULL;
+	}
+	pthread_mutex_init(&q->walLock, NULL);
+	METRIC_WATCH(METRIC_GAUGE_QUEUE_DEPTH, probe_queue_depth, q);
+	return q;
 }
 
 void orders_destroy(OrdersQueue* q) {
 	if (!q) return;
-	OrderNode* cur = q->head;
-	while (cur) { OrderNode* n = cur->next; free(cur); cur = n; }
+	METRIC_UNWATCH(q);
+	for (int i = 0; i < ORDER_RING_SLOTS; i++) free(q->ring[i]);
+	free(q->spare);
+	free(q->ring);
+	free(q->batchOrders); free(q->batchLines); free(q->lineSlot);
+	free(q->slotIds); free(q->slotProducts); free(q->slotStock); free(q->changes);
+	pthread_mutex_destroy(&q->walLock);
 	free(q);
 }
 
+// Fill in a claimed record; the consumer cannot see it until publish_record
+static void write_record(unsigned char* at, const Order* o, size_t customerLen) {
+	OrderRecord* rec = (OrderRecord*)at;
+	rec->id = o->id;
+	rec->numItems = (uint32_t)o->numItems;
+	rec->customerLen = (uint32_t)customerLen;
+	size_t itemBytes = (size_t)o->numItems * sizeof(OrderItem);
+	if (itemBytes) memcpy(at + sizeof(OrderRecord), o->items, itemBytes);
+	memcpy(at + sizeof(OrderRecord) + itemBytes, o->customer, customerLen);
+	at[sizeof(OrderRecord) + itemBytes + customerLen] = '\0';
+}
+
+static void publish_record(unsigned char* at, size_t size) {
+	__atomic_store_n(&((OrderRecord*)at)->size, (uint32_t)size, __ATOMIC_RELEASE);
+}
+
+// Close segment `index` at `offset` and open the next one holding this
+// producer's record; a record bigger than a segment gets one to itself.
+// Out of memory, the segment stays open: the tail goes back to `offset`,
+// which no other producer can have claimed, and NULL is returned.
+static unsigned char* open_segment(OrdersQueue* q, uint32_t index, size_t offset, const Order* o,
+                                   size_t customerLen, size_t size) {
+	OrderSegment* next = NULL;
+	if (size <= ORDER_SEGMENT_BYTES) next = __atomic_exchange_n(&q->spare, NULL, __ATOMIC_ACQ_REL);
+	if (!next) next = segment_new(size > ORDER_SEGMENT_BYTES ? size : ORDER_SEGMENT_BYTES);
+	if (!next) {
+		__atomic_store_n(&q->tail, ((uint64_t)index << ORDER_OFFSET_BITS) | offset, __ATOMIC_RELEASE);
+		return NULL;
+	}
+	write_record(next->data, o, customerLen);
+
+	OrderSegment* seg = __atomic_load_n(slot_of(q, index), __ATOMIC_ACQUIRE);
+	if (offset + sizeof(uint32_t) <= ORDER_SEGMENT_BYTES) {
+		__atomic_store_n((uint32_t*)(seg->data + offset), ORDER_SEGMENT_END, __ATOMIC_RELEASE);
+	}
+	// A full ring means the consumer is ORDER_RING_SLOTS segments behind
+	uint32_t nextIndex = (index + 1) & ORDER_INDEX_MASK;
+	while (__atomic_load_n(slot_of(q, nextIndex), __ATOMIC_ACQUIRE)) sched_yield();
+	__atomic_store_n(slot_of(q, nextIndex), next, __ATOMIC_RELEASE);
+	// An oversized segment takes nothing more
+	uint64_t used = size < ORDER_SEGMENT_BYTES ? size : ORDER_SEGMENT_BYTES;
+	__atomic_store_n(&q->tail, ((uint64_t)nextIndex << ORDER_OFFSET_BITS) | used, __ATOMIC_RELEASE);
+	return next->data;
+}
+
+// Claim space for o and write it there, unpublished; NULL if out of memory
+static unsigned char* claim_record(OrdersQueue* q, const Order* o, size_t* sizeOut) {
+	size_t customerLen = strnlen(o->customer, MAX_NAME_LEN - 1);
+	size_t size = record_size(o->numItems, customerLen);
+	*sizeOut = size;
+	for (;;) {
+		uint64_t tail = __atomic_fetch_add(&q->tail, size, __ATOMIC_ACQ_REL);
+		uint32_t index = (uint32_t)(tail >> ORDER_OFFSET_BITS);
+		size_t offset = (size_t)(tail & ORDER_OFFSET_MASK);
+		if (offset + size <= ORDER_SEGMENT_BYTES) {
+			OrderSegment* seg = __atomic_load_n(slot_of(q, index), __ATOMIC_ACQUIRE);
+			write_record(seg->data + offset, o, customerLen);
+			return seg->data + offset;
+		}
+		if (offset <= ORDER_SEGMENT_BYTES) return open_segment(q, index, offset, o, customerLen, size);
+		// Someone else is closing this segment; retry once it has moved on
+		// or, out of memory, put the tail back
+		METRIC_INC(METRIC_SEGMENT_WAITS);
+		for (;;) {
+			uint64_t now = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+			if ((uint32_t)(now >> ORDER_OFFSET_BITS) != index || (now & ORDER_OFFSET_MASK) <= ORDER_SEGMENT_BYTES) break;
+			sched_yield();
+		}
+	}
+}
+
 bool orders_enqueue(OrdersQueue* q, Order o) {
-	if (!q) return false;
-	OrderNode* n = (OrderNode*)malloc(sizeof(OrderNode));
-	n->order = o; n->next = NULL;
-	if (!q->tail) q->head = q->tail = n; else { q->tail->next = n; q->tail = n; }
-	q->count++;
+	if (!q || o.numItems < 0 || (o.numItems > 0 && !o.items)) return false;
+	if ((size_t)o.numItems > (UINT32_MAX - ORDER_SEGMENT_BYTES) / sizeof(OrderItem)) return false;
+	METRIC_START(start);
+	unsigned char* at;
+	size_t size;
+	if (!__atomic_load_n(&q->wal, __ATOMIC_ACQUIRE)) {
+		at = claim_record(q, &o, &size);
+		if (at) publish_record(at, size);
+	} else {
+		// Log once the space is claimed but before publishing, so a failed
+		// enqueue is never logged, the log's enqueue order is the queue
+		// order and no dequeue record can precede the enqueue it consumes
+		pthread_mutex_lock(&q->walLock);
+		at = claim_record(q, &o, &size);
+		if (at) {
+			if (q->wal) wal_log_enqueue(q->wal, &o);
+			publish_record(at, size);
+		}
+		pthread_mutex_unlock(&q->walLock);
+	}
+	bool ok = at != NULL;
+	if (ok) {
+		__atomic_fetch_add(&q->enqueued, 1, __ATOMIC_RELEASE);
+		METRIC_INC(METRIC_ORDERS_ENQUEUED);
+	}
+	METRIC_STOP(METRIC_OP_ENQUEUE, start);
+	return ok;
+}
+
+// Record at the cursor, or NULL when the queue holds nothing further.
+// Waits out producers that have claimed space but not yet published it.
+static OrderRecord* cursor_peek(OrdersQueue* q, OrderCursor* c) {
+	for (;;) {
+		OrderSegment* seg = __atomic_load_n(slot_of(q, c->index), __ATOMIC_ACQUIRE);
+		if (c->offset + sizeof(uint32_t) <= seg->capacity) {
+			OrderRecord* rec = (OrderRecord*)(seg->data + c->offset);
+			uint32_t size = __atomic_load_n(&rec->size, __ATOMIC_ACQUIRE);
+			if (size != 0 && size != ORDER_SEGMENT_END) return rec;
+			if (size == 0) {
+				uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+				if ((uint32_t)(tail >> ORDER_OFFSET_BITS) == c->index &&
+				    (tail & ORDER_OFFSET_MASK) <= c->offset) return NULL;
+				sched_yield();
+				continue;
+			}
+		}
+		// End of this segment; move on once the next one is published
+		uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+		if ((uint32_t)(tail >> ORDER_OFFSET_BITS) == c->index) {
+			if ((tail & ORDER_OFFSET_MASK) <= c->offset) return NULL;
+			sched_yield();
+			continue;
+		}
+		c->index = (c->index + 1) & ORDER_INDEX_MASK;
+		c->offset = 0;
+	}
+}
+
+static void record_view(const OrderRecord* rec, Order* out) {
+	const unsigned char* at = (const unsigned char*)rec;
+	out->id = rec->id;
+	out->numItems = (int)rec->numItems;
+	out->items = (OrderItem*)(at + sizeof(OrderRecord));
+	memcpy(out->customer, at + sizeof(OrderRecord) + rec->numItems * sizeof(OrderItem), rec->customerLen + 1);
+}
+
+// Recycle the segments the consumer finished before this call
+static void release_segments(OrdersQueue* q) {
+	while (q->releaseIndex != q->readIndex) {
+		OrderSegment** slot = slot_of(q, q->releaseIndex);
+		OrderSegment* seg = *slot;
+		if (seg->capacity == ORDER_SEGMENT_BYTES && !__atomic_load_n(&q->spare, __ATOMIC_ACQUIRE)) {
+			memset(seg->data, 0, seg->capacity);
+			__atomic_store_n(&q->spare, seg, __ATOMIC_RELEASE);
+		} else {
+			free(seg);
+		}
+		__atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+		q->releaseIndex = (q->releaseIndex + 1) & ORDER_INDEX_MASK;
+	}
+}
+
+static bool take_next(OrdersQueue* q, Order* out) {
+	OrderCursor c = { q->readIndex, q->readOffset };
+	OrderRecord* rec = cursor_peek(q, &c);
+	if (!rec) return false;
+	if (out) record_view(rec, out);
+	q->readIndex = c.index;
+	q->readOffset = c.offset + rec->size;
+	wal_log_dequeue(q->wal);
 	return true;
 }
 
 bool orders_dequeue(OrdersQueue* q, Order* out) {
-	if (!q || !q->head) return false;
-	OrderNode* n = q->head; q->head = n->next; if (!q->head) q->tail = NULL;
-	if (out) *out = n->order; free(n); q->count--; return true;
+	if (!q) return false;
+	release_segments(q);
+	if (!take_next(q, out)) return false;
+	__atomic_fetch_add(&q->dequeued, 1, __ATOMIC_RELAXED);
+	METRIC_INC(METRIC_ORDERS_DEQUEUED);
+	return true;
 }
 
-int orders_count(OrdersQueue* q) { return q ? q->count : 0; }
+int orders_dequeue_batch(OrdersQueue* q, Order* out, int max) {
+	if (!q) return 0;
+	release_segments(q);
+	int n = 0;
+	while (n < max && take_next(q, &out[n])) n++;
+	__atomic_fetch_add(&q->dequeued, n, __ATOMIC_RELAXED);
+	METRIC_ADD(METRIC_ORDERS_DEQUEUED, n);
+	return n;
+}
+
+int orders_count(OrdersQueue* q) {
+	if (!q) return 0;
+	long n = __atomic_load_n(&q->enqueued, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->dequeued, __ATOMIC_RELAXED);
+	return n > 0 ? (int)n : 0;
+}
+
+void orders_attach_wal(OrdersQueue* q, Wal* wal) {
+	if (!q) return;
+	// Wait for producers that are logging to the previous log
+	pthread_mutex_lock(&q->walLock);
+	__atomic_store_n(&q->wal, wal, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&q->walLock);
+}
+
+void orders_begin_process(OrdersQueue* q) {
+	if (q) wal_begin_process(__atomic_load_n(&q->wal, __ATOMIC_ACQUIRE));
+}
+
+void orders_commit_process(OrdersQueue* q) {
+	if (q) wal_commit_process(__atomic_load_n(&q->wal, __ATOMIC_ACQUIRE));
+}
+
+void orders_for_each(OrdersQueue* q, OrderVisitor visit, void* ctx) {
+	if (!q || !visit) return;
+	OrderCursor c = { q->readIndex, q->readOffset };
+	OrderRecord* rec;
+	while ((rec = cursor_peek(q, &c)) != NULL) {
+		Order o;
+		record_view(rec, &o);
+		visit(&o, ctx);
+		c.offset += rec->size;
+	}
+}
+
+static void print_order(const Order* o, void* ctx) {
+	(void)ctx;
+	printf("Order #%d for %s (items=%d)\n", o->id, o->customer, o->numItems);
+}
 
 void orders_print(OrdersQueue* q) {
 	printf("\n-- Orders Queue (count=%d) --\n", orders_count(q));
-	for (OrderNode* cur = q->head; cur; cur = cur->next) {
-		printf("Order #%d for %s (items=%d)\n", cur->order.id, cur->order.customer, cur->order.numItems);
-	}
+	orders_for_each(q, print_order, NULL);
 }
 
-bool orders_process_next(OrdersQueue* q, Inventory* inv) {
-	if (!q || !q->head) { printf("No orders to process.\n"); return false; }
-	Order o; orders_dequeue(q, &o);
+// Lines for the same product are summed before they are checked, as the
+// batch paths do, and the deductions go in as one grouped update
+static OrderOutcome fulfill(Inventory* inv, const Order* o, ProductId* failedProduct) {
+	StockChange local[ORDER_LOCAL_LINES];
+	StockChange* changes = o->numItems <= ORDER_LOCAL_LINES ? local :
+	                       (StockChange*)malloc(sizeof(StockChange) * (size_t)o->numItems);
+	if (!changes) return ORDER_OUT_OF_MEMORY;
+
 	// Validate inventory
-	for (int i = 0; i < o.numItems; ++i) {
-		OrderItem it = o.items[i];
-		Product* p = inventory_get_product(inv, it.productId);
-		if (!p) { printf("Order %d FAILED: product %d not found.\n", o.id, it.productId); return false; }
-		if (p->stock < it.quantity) { printf("Order %d FAILED: insufficient stock for product %d.\n", o.id, it.productId); return false; }
-	}
-	// Deduct stock
-	for (int i = 0; i < o.numItems; ++i) {
-		OrderItem it = o.items[i];
-		Product* p = inventory_get_product(inv, it.productId);
-		inventory_update_stock(inv, p->id, p->stock - it.quantity);
+	OrderOutcome outcome = ORDER_FULFILLED;
+	int count = 0;
+	for (int i = 0; i < o->numItems; ++i) {
+		OrderItem it = o->items[i];
+		int c = 0;
+		while (c < count && changes[c].product->id != it.productId) c++;
+		if (c == count) {
+			Product* p = inventory_get_product(inv, it.productId);
+			if (!p) outcome = ORDER_UNKNOWN_PRODUCT;
+			else {
+				changes[count].product = p;
+				changes[count++].newStock = p->stock;
+			}
+		}
+		if (outcome == ORDER_FULFILLED && changes[c].newStock < it.quantity) outcome = ORDER_INSUFFICIENT_STOCK;
+		if (outcome != ORDER_FULFILLED) {
+			if (failedProduct) *failedProduct = it.productId;
+			break;
+		}
+		changes[c].newStock -= it.quantity;
+	}
+	// Deduct stock, all of it or none
+	if (outcome == ORDER_FULFILLED && !inventory_update_stocks(inv, changes, count)) outcome = ORDER_OUT_OF_MEMORY;
+	if (changes != local) free(changes);
+	return outcome;
+}
+
+OrderOutcome orders_fulfill(Inventory* inv, const Order* o, ProductId* failedProduct) {
+	METRIC_START(start);
+	OrderOutcome outcome = fulfill(inv, o, failedProduct);
+	METRIC_INC(outcome == ORDER_FULFILLED ? METRIC_ORDERS_FULFILLED : METRIC_ORDERS_FAILED);
+	METRIC_STOP(METRIC_OP_FULFILL, start);
+	return outcome;
+}
+
+OrderOutcome orders_fulfill_next(OrdersQueue* q, Inventory* inv, Order* order, ProductId* failedProduct) {
+	Order o;
+	orders_begin_process(q);
+	if (!orders_dequeue(q, &o)) {
+		orders_commit_process(q);
+		return ORDER_QUEUE_EMPTY;
+	}
+	if (order) *order = o;
+	OrderOutcome outcome = orders_fulfill(inv, &o, failedProduct);
+	orders_commit_process(q);
+	return outcome;
+}
+
+static bool process_next(OrdersQueue* q, Inventory* inv) {
+	Order o; ProductId failed = 0;
+	switch (orders_fulfill_next(q, inv, &o, &failed)) {
+		case ORDER_QUEUE_EMPTY: printf("No orders to process.\n"); return false;
+		case ORDER_UNKNOWN_PRODUCT: printf("Order %d FAILED: product %lld not found.\n", o.id, failed); return false;
+		case ORDER_INSUFFICIENT_STOCK: printf("Order %d FAILED: insufficient stock for product %lld.\n", o.id, failed); return false;
+		case ORDER_OUT_OF_MEMORY: printf("Order %d FAILED: out of memory.\n", o.id); return false;
+		case ORDER_FULFILLED: break;
 	}
 	printf("Order %d processed successfully for %s.\n", o.id, o.customer);
 	return true;
 }
 
+bool orders_process_next(OrdersQueue* q, Inventory* inv) {
+	METRIC_START(start);
+	bool ok = process_next(q, inv);
+	METRIC_STOP(METRIC_OP_PROCESS_NEXT, start);
+	return ok;
+}
+
+
+
+static bool grow(void** p, size_t size) {
+	void* n = realloc(*p, size);
+	if (!n) return false;
+	*p = n;
+	return true;
+}
+
+static bool batch_reserve(OrdersQueue* q, int orders, int lines) {
+	if (orders > q->batchOrderCapacity) {
+		if (!grow((void**)&q->batchOrders, (size_t)orders * sizeof(Order))) return false;
+		q->batchOrderCapacity = orders;
+	}
+	if (lines > q->batchLineCapacity) {
+		size_t n = (size_t)lines;
+		if (!grow((void**)&q->batchLines, n * sizeof(BatchLine)) || !grow((void**)&q->lineSlot, n * sizeof(int)) ||
+		    !grow((void**)&q->slotIds, n * sizeof(ProductId)) || !grow((void**)&q->slotProducts, n * sizeof(Product*)) ||
+		    !grow((void**)&q->slotStock, n * sizeof(int)) || !grow((void**)&q->changes, n * sizeof(StockChange))) return false;
+		q->batchLineCapacity = lines;
+	}
+	return true;
+}
+
+static int line_cmp(const void* a, const void* b) {
+	const BatchLine* x = (const BatchLine*)a; const BatchLine* y = (const BatchLine*)b;
+	if (x->productId != y->productId) return x->productId < y->productId ? -1 : 1;
+	return (x->line > y->line) - (x->line < y->line);
+}
+
+// Batch fallback when the batch cannot be planned or applied as a whole
+static int fulfill_each(Inventory* inv, const Order* orders, int n, OrderBatchStats* stats) {
+	for (int i = 0; i < n; i++) {
+		if (orders_fulfill(inv, &orders[i], NULL) == ORDER_FULFILLED) stats->fulfilled++; else stats->failed++;
+	}
+	return n;
+}
 
+static int process_batch(OrdersQueue* q, Inventory* inv, int maxOrders, OrderBatchStats* stats) {
+
+	// Take the batch; the items stay in the queue's segments meanwhile
+	int want = orders_count(q);
+	if (want > maxOrders) want = maxOrders;
+	if (want == 0 || !batch_reserve(q, want, 0)) return 0;
+	int n = orders_dequeue_batch(q, q->batchOrders, want);
+	Order* orders = q->batchOrders;
+	long long total = 0;
+	for (int i = 0; i < n; i++) total += orders[i].numItems;
+	if (total > INT_MAX || !batch_reserve(q, n, (int)total)) return fulfill_each(inv, orders, n, stats);
+	int lines = (int)total;
+
+	// Sort every line by product id and resolve each distinct product once
+	for (int i = 0, line = 0; i < n; i++) {
+		for (int k = 0; k < orders[i].numItems; k++, line++) {
+			q->batchLines[line].productId = orders[i].items[k].productId;
+			q->batchLines[line].line = line;
+		}
+	}
+	qsort(q->batchLines, (size_t)lines, sizeof(BatchLine), line_cmp);
+	int slots = 0;
+	for (int i = 0; i < lines; i++) {
+		if (slots == 0 || q->slotIds[slots - 1] != q->batchLines[i].productId) q->slotIds[slots++] = q->batchLines[i].productId;
+		q->lineSlot[q->batchLines[i].line] = slots - 1;
+	}
+	inventory_lookup_sorted(inv, q->slotIds, slots, q->slotProducts);
+	for (int i = 0; i < slots; i++) q->slotStock[i] = q->slotProducts[i] ? q->slotProducts[i]->stock : 0;
+
+	// FIFO: each order is all-or-nothing against what earlier orders left
+	int fulfilled = 0, failed = 0;
+	for (int i = 0, line = 0; i < n; line += orders[i].numItems, i++) {
+		int k = 0;
+		for (; k < orders[i].numItems; k++) {
+			int slot = q->lineSlot[line + k];
+			int quantity = orders[i].items[k].quantity;
+			if (!q->slotProducts[slot] || q->slotStock[slot] < quantity) break;
+			q->slotStock[slot] -= quantity;
+		}
+		if (k == orders[i].numItems) { fulfilled++; continue; }
+		while (k-- > 0) q->slotStock[q->lineSlot[line + k]] += orders[i].items[k].quantity;
+		failed++;
+	}
+
+	// One grouped stock update for every product the batch changed
+	int changed = 0;
+	for (int i = 0; i < slots; i++) {
+		Product* p = q->slotProducts[i];
+		if (p && p->stock != q->slotStock[i]) {
+			q->changes[changed].product = p;
+			q->changes[changed++].newStock = q->slotStock[i];
+		}
+	}
+	// Nothing has been applied if it fails, so the orders can still go
+	// one at a time
+	if (!inventory_update_stocks(inv, q->changes, changed)) return fulfill_each(inv, orders, n, stats);
+	stats->fulfilled += fulfilled;
+	stats->failed += failed;
+	METRIC_ADD(METRIC_ORDERS_FULFILLED, fulfilled);
+	METRIC_ADD(METRIC_ORDERS_FAILED, failed);
+	return n;
+}
+
+int orders_process_batch(OrdersQueue* q, Inventory* inv, int maxOrders, OrderBatchStats* stats) {
+	OrderBatchStats local;
+	if (!stats) stats = &local;
+	stats->fulfilled = stats->failed = 0;
+	if (!q || !inv || maxOrders <= 0) return 0;
+	METRIC_START(start);
+	orders_begin_process(q);
+	int n = process_batch(q, inv, maxOrders, stats);
+	orders_commit_process(q);
+	METRIC_STOP(METRIC_OP_PROCESS_BATCH, start);
+	return n;
+}
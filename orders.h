@@ -4,20 +4,63 @@
 #include <stdbool.h>
 #include "common.h"
 #include "inventory.h"
+#include "wal.h"
 
+// FIFO order queue. Any number of threads may enqueue concurrently
+// (lock-free unless a write-ahead log is attached, in which case producers
+// serialize on the log); dequeue, iteration and processing belong to a
+// single consumer thread. Orders are stored compactly in recycled segments,
+// so enqueue and dequeue do not allocate per order and there is no limit
+// on the number of items.
 typedef struct OrdersQueue OrdersQueue;
 
 OrdersQueue* orders_create(void);
 void orders_destroy(OrdersQueue* q);
 
+// Copies o.items into the queue
 bool orders_enqueue(OrdersQueue* q, Order o);
+// out->items points into the queue and stays valid until the next dequeue
 bool orders_dequeue(OrdersQueue* q, Order* out);
+// Dequeue up to max orders into out, with the same lifetime for their
+// items; returns how many were taken
+int orders_dequeue_batch(OrdersQueue* q, Order* out, int max);
+// Approximate while producers are running, exact once they are quiet
 int orders_count(OrdersQueue* q);
+// Visit queued orders in FIFO order (consumer side)
+typedef void (*OrderVisitor)(const Order* o, void* ctx);
+void orders_for_each(OrdersQueue* q, OrderVisitor visit, void* ctx);
 void orders_print(OrdersQueue* q);
+// Log later enqueues and dequeues to the write-ahead log (NULL detaches)
+void orders_attach_wal(OrdersQueue* q, Wal* wal);
+// Log the dequeues and stock changes made between these calls as one
+// write-ahead log record (consumer side; see wal_begin_process). The
+// processing functions below do this themselves.
+void orders_begin_process(OrdersQueue* q);
+void orders_commit_process(OrdersQueue* q);
 
 // Process the next order in FIFO, validating against inventory and updating stock
 bool orders_process_next(OrdersQueue* q, Inventory* inv);
 
+typedef enum { ORDER_FULFILLED, ORDER_QUEUE_EMPTY, ORDER_UNKNOWN_PRODUCT, ORDER_INSUFFICIENT_STOCK, ORDER_OUT_OF_MEMORY } OrderOutcome;
+// Silent form of orders_process_next: *order receives the dequeued order and
+// *failedProduct the first item that could not be filled (either may be NULL)
+OrderOutcome orders_fulfill_next(OrdersQueue* q, Inventory* inv, Order* order, ProductId* failedProduct);
+// Validate and deduct an order that is not on the queue, all items or none.
+// Lines naming the same product are checked against its stock together;
+// the deductions are one undo step.
+OrderOutcome orders_fulfill(Inventory* inv, const Order* o, ProductId* failedProduct);
+
+typedef struct OrderBatchStats {
+	int fulfilled;
+	int failed;
+} OrderBatchStats;
+// Process up to maxOrders like repeated orders_fulfill_next: earlier orders
+// are served first and each is filled completely or not at all. The
+// batch's lines are sorted by product, every product is resolved once
+// and the stock changes go in as one grouped update (a single undo step).
+// Returns the number of orders taken from the queue.
+int orders_process_batch(OrdersQueue* q, Inventory* inv, int maxOrders, OrderBatchStats* stats);
+
 #endif // ORDERS_H
 
 
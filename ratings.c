@@ -0,0 +1,258 @@
+#include "ratings.h"
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+// Ranges this small are scanned instead of split further
+#define RATINGS_LEAF 16
+
+typedef struct RatingPoint {
+    double r[RATING_DIMS];
+    const Supplier* supplier;
+} RatingPoint;
+
+// Implicit k-d tree: the node over points[lo, hi) is the median at
+// lo + (hi - lo) / 2, split on dim[mid]. Points left of it are <= its
+// value on that dimension and points right of it are >=.
+struct RatingIndex {
+    RatingPoint* points;
+    unsigned char* dim;
+    int count;
+    int capacity;
+    unsigned long version;
+};
+
+typedef struct RangeQuery {
+    const RatingBox* box;
+    const Supplier** out;
+    int max;
+    int found;
+} RangeQuery;
+
+static void collect_point(const Supplier* s, void* ctx) {
+    RatingIndex* idx = (RatingIndex*)ctx;
+    if (idx->count == idx->capacity) return;
+    RatingPoint* p = &idx->points[idx->count++];
+    p->r[0] = s->ratings.quality;
+    p->r[1] = s->ratings.deliveryTime;
+    p->r[2] = s->ratings.price;
+    p->r[3] = s->ratings.reliability;
+    p->r[4] = s->ratings.customerService;
+    p->supplier = s;
+}
+
+// Dimension with the widest spread over points[lo, hi)
+static int widest_dim(const RatingPoint* points, int lo, int hi) {
+    double min[RATING_DIMS], max[RATING_DIMS];
+    for (int d = 0; d < RATING_DIMS; d++) {
+        min[d] = DBL_MAX;
+        max[d] = -DBL_MAX;
+    }
+    for (int i = lo; i < hi; i++) {
+        for (int d = 0; d < RATING_DIMS; d++) {
+            if (points[i].r[d] < min[d]) min[d] = points[i].r[d];
+            if (points[i].r[d] > max[d]) max[d] = points[i].r[d];
+        }
+    }
+    int best = 0;
+    for (int d = 1; d < RATING_DIMS; d++) {
+        if (max[d] - min[d] > max[best] - min[best]) best = d;
+    }
+    return best;
+}
+
+static void swap_points(RatingPoint* a, RatingPoint* b) {
+    RatingPoint t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Quickselect: put the k-th smallest on dimension d at k, with nothing
+// greater before it and nothing smaller after it
+static void select_nth(RatingPoint* points, int lo, int hi, int k, int d) {
+    hi--;
+    while (lo < hi) {
+        // Median of three as the pivot, parked at hi
+        int mid = lo + (hi - lo) / 2;
+        if (points[mid].r[d] < points[lo].r[d]) swap_points(&points[mid], &points[lo]);
+        if (points[hi].r[d] < points[lo].r[d]) swap_points(&points[hi], &points[lo]);
+        if (points[mid].r[d] < points[hi].r[d]) swap_points(&points[mid], &points[hi]);
+        double pivot = points[hi].r[d];
+
+        // Hoare-style partition that splits runs of equal values evenly
+        int i = lo - 1, j = hi;
+        for (;;) {
+            while (points[++i].r[d] < pivot) {}
+            while (j > lo && points[--j].r[d] > pivot) {}
+            if (i >= j) break;
+            swap_points(&points[i], &points[j]);
+        }
+        swap_points(&points[i], &points[hi]);
+        if (i == k) return;
+        if (k < i) hi = i - 1;
+        else lo = i + 1;
+    }
+}
+
+static void build_rec(RatingIndex* idx, int lo, int hi) {
+    if (hi - lo <= RATINGS_LEAF) return;
+    int mid = lo + (hi - lo) / 2;
+    int d = widest_dim(idx->points, lo, hi);
+    select_nth(idx->points, lo, hi, mid, d);
+    idx->dim[mid] = (unsigned char)d;
+    build_rec(idx, lo, mid);
+    build_rec(idx, mid + 1, hi);
+}
+
+RatingIndex* ratings_build(SuppliersDB* db) {
+    RatingIndex* idx = (RatingIndex*)calloc(1, sizeof(RatingIndex));
+    if (!idx) return NULL;
+    int n = suppliers_count(db);
+    idx->points = (RatingPoint*)malloc(sizeof(RatingPoint) * (size_t)(n ? n : 1));
+    idx->dim = (unsigned char*)malloc((size_t)(n ? n : 1));
+    if (!idx->points || !idx->dim) {
+        ratings_destroy(idx);
+        return NULL;
+    }
+    idx->capacity = n;
+    idx->version = suppliers_version(db);
+    suppliers_for_each(db, collect_point, idx);
+    build_rec(idx, 0, idx->count);
+    return idx;
+}
+
+void ratings_destroy(RatingIndex* idx) {
+    if (!idx) return;
+    free(idx->points);
+    free(idx->dim);
+    free(idx);
+}
+
+int ratings_count(const RatingIndex* idx) {
+    return idx ? idx->count : 0;
+}
+
+unsigned long ratings_version(const RatingIndex* idx) {
+    return idx ? idx->version : 0;
+}
+
+void ratings_box_all(RatingBox* box) {
+    for (int d = 0; d < RATING_DIMS; d++) {
+        box->min[d] = -DBL_MAX;
+        box->max[d] = DBL_MAX;
+    }
+}
+
+static bool in_box(const RatingPoint* p, const RatingBox* box) {
+    for (int d = 0; d < RATING_DIMS; d++) {
+        if (p->r[d] < box->min[d] || p->r[d] > box->max[d]) return false;
+    }
+    return true;
+}
+
+static void report(RangeQuery* q, const RatingPoint* p) {
+    if (q->found < q->max) q->out[q->found] = p->supplier;
+    q->found++;
+}
+
+static void range_rec(const RatingIndex* idx, int lo, int hi, RangeQuery* q) {
+    if (hi - lo <= RATINGS_LEAF) {
+        for (int i = lo; i < hi; i++) {
+            if (in_box(&idx->points[i], q->box)) report(q, &idx->points[i]);
+        }
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    const RatingPoint* p = &idx->points[mid];
+    int d = idx->dim[mid];
+    if (in_box(p, q->box)) report(q, p);
+    if (q->box->min[d] <= p->r[d]) range_rec(idx, lo, mid, q);
+    if (q->box->max[d] >= p->r[d]) range_rec(idx, mid + 1, hi, q);
+}
+
+int ratings_range(const RatingIndex* idx, const RatingBox* box, const Supplier** out, int max) {
+    if (!idx || !box) return 0;
+    RangeQuery q = { box, out, out ? max : 0, 0 };
+    range_rec(idx, 0, idx->count, &q);
+    return q.found;
+}
+
+// Skyline candidate: the rating sum is monotone under dominance, so after
+// sorting by it descending nothing can be dominated by a later point
+typedef struct SkylineEntry {
+    double sum;
+    int point;
+} SkylineEntry;
+
+static bool dominates(const double* a, const double* b) {
+    bool better = false;
+    for (int d = 0; d < RATING_DIMS; d++) {
+        if (a[d] < b[d]) return false;
+        if (a[d] > b[d]) better = true;
+    }
+    return better;
+}
+
+static int sum_desc(const void* a, const void* b) {
+    double x = ((const SkylineEntry*)a)->sum;
+    double y = ((const SkylineEntry*)b)->sum;
+    return (x < y) - (x > y);
+}
+
+int ratings_skyline(const RatingIndex* idx, const Supplier** out, int max) {
+    if (!idx) return 0;
+    int n = idx->count;
+    SkylineEntry* order = (SkylineEntry*)malloc(sizeof(SkylineEntry) * (size_t)(n ? n : 1));
+    // Window of skyline points so far, one column per dimension
+    double* window = (double*)malloc(sizeof(double) * RATING_DIMS * (size_t)(n ? n : 1));
+    if (!order || !window) {
+        free(order);
+        free(window);
+        return -1;
+    }
+    int best = 0;
+    double bestSum = -DBL_MAX;
+    for (int i = 0; i < n; i++) {
+        const double* r = idx->points[i].r;
+        double sum = r[0] + r[1] + r[2] + r[3] + r[4];
+        if (sum > bestSum) {
+            best = i;
+            bestSum = sum;
+        }
+    }
+    // The best-sum point is on the skyline; dropping what it dominates
+    // before sorting usually discards most of the input
+    int candidates = 0;
+    for (int i = 0; i < n; i++) {
+        const double* r = idx->points[i].r;
+        if (dominates(idx->points[best].r, r)) continue;
+        order[candidates].sum = r[0] + r[1] + r[2] + r[3] + r[4];
+        order[candidates].point = i;
+        candidates++;
+    }
+    qsort(order, (size_t)candidates, sizeof(SkylineEntry), sum_desc);
+
+    int size = 0;
+    for (int i = 0; i < candidates; i++) {
+        const RatingPoint* p = &idx->points[order[i].point];
+        bool dominated = false;
+        // Earlier window points have larger sums and are the likeliest to
+        // dominate, so scanning from the front exits early
+        for (int w = 0; w < size && !dominated; w++) {
+            bool geq = true, better = false;
+            for (int d = 0; d < RATING_DIMS; d++) {
+                double v = window[(size_t)d * n + w];
+                geq &= v >= p->r[d];
+                better |= v > p->r[d];
+            }
+            dominated = geq && better;
+        }
+        if (dominated) continue;
+        for (int d = 0; d < RATING_DIMS; d++) window[(size_t)d * n + size] = p->r[d];
+        if (out && size < max) out[size] = p->supplier;
+        size++;
+    }
+    free(order);
+    free(window);
+    return size;
+}
@@ -0,0 +1,38 @@
+#ifndef RATINGS_H
+#define RATINGS_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "suppliers.h"
+
+// Multi-criteria supplier queries on the five raw ratings rather than the
+// weighted score: a static 5-D k-d tree for orthogonal range queries and a
+// sort-filter-skyline (SFS) pass for the Pareto-optimal set. The index is
+// a snapshot; rebuild it when suppliers_version changes. Supplier pointers
+// it hands out belong to the SuppliersDB.
+#define RATING_DIMS 5  // quality, deliveryTime, price, reliability, customerService
+
+typedef struct RatingBox {
+    double min[RATING_DIMS];
+    double max[RATING_DIMS];
+} RatingBox;
+
+typedef struct RatingIndex RatingIndex;
+
+RatingIndex* ratings_build(SuppliersDB* db);
+void ratings_destroy(RatingIndex* idx);
+int ratings_count(const RatingIndex* idx);
+// suppliers_version of the database at build time
+unsigned long ratings_version(const RatingIndex* idx);
+
+// Box with every bound open; tighten the dimensions of interest
+void ratings_box_all(RatingBox* box);
+// Suppliers whose ratings all fall inside box (bounds inclusive). Fills up
+// to max of them into out and returns the total number of matches.
+int ratings_range(const RatingIndex* idx, const RatingBox* box, const Supplier** out, int max);
+// Suppliers not dominated by any other (at least as good on every rating
+// and better on one), best rating sum first. Fills up to max into out and
+// returns the size of the skyline, or -1 if out of memory.
+int ratings_skyline(const RatingIndex* idx, const Supplier** out, int max);
+
+#endif // RATINGS_H
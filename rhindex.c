@@ -0,0 +1,87 @@
+#include "rhindex.h"
+#include <stdlib.h>
+
+bool rh_index_init(RhIndex* index, size_t capacity) {
+    index->slots = (RhSlot*)calloc(capacity, sizeof(RhSlot));
+    if (!index->slots) return false;
+    index->capacity = capacity;
+    index->count = 0;
+    index->shift = 64;
+    while (capacity > 1) {
+        capacity >>= 1;
+        index->shift--;
+    }
+    return true;
+}
+
+void rh_index_free(RhIndex* index) {
+    free(index->slots);
+    index->slots = NULL;
+    index->capacity = index->count = 0;
+}
+
+static void place(RhIndex* index, int64_t key, void* value) {
+    size_t mask = index->capacity - 1;
+    size_t i = rh_index_home(index, key);
+    RhSlot entry = { value, key, 0 };
+
+    while (index->slots[i].value) {
+        // Steal the slot from an entry that is closer to its home bucket
+        if (index->slots[i].dist < entry.dist) {
+            RhSlot tmp = index->slots[i];
+            index->slots[i] = entry;
+            entry = tmp;
+        }
+        i = (i + 1) & mask;
+        entry.dist++;
+    }
+    index->slots[i] = entry;
+    index->count++;
+}
+
+static bool grow(RhIndex* index) {
+    RhIndex bigger;
+    if (!rh_index_init(&bigger, index->capacity * 2)) return false;
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (index->slots[i].value) place(&bigger, index->slots[i].key, index->slots[i].value);
+    }
+    free(index->slots);
+    *index = bigger;
+    return true;
+}
+
+bool rh_index_reserve(RhIndex* index, size_t count) {
+    while (count * 4 > index->capacity * 3) {
+        if (!grow(index)) return false;
+    }
+    return true;
+}
+
+bool rh_index_insert(RhIndex* index, int64_t key, void* value) {
+    if (!rh_index_reserve(index, index->count + 1)) return false;
+    place(index, key, value);
+    return true;
+}
+
+void rh_index_erase(RhIndex* index, int64_t key) {
+    size_t mask = index->capacity - 1;
+    size_t i = rh_index_home(index, key);
+
+    for (int dist = 0; ; dist++) {
+        RhSlot* slot = &index->slots[i];
+        if (!slot->value || slot->dist < dist) return;
+        if (slot->key == key) break;
+        i = (i + 1) & mask;
+    }
+
+    size_t next = (i + 1) & mask;
+    while (index->slots[next].value && index->slots[next].dist > 0) {
+        index->slots[i] = index->slots[next];
+        index->slots[i].dist--;
+        i = next;
+        next = (next + 1) & mask;
+    }
+    index->slots[i].value = NULL;
+    index->slots[i].dist = 0;
+    index->count--;
+}
@@ -0,0 +1,65 @@
+#ifndef RHINDEX_H
+#define RHINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Robin Hood hash index from integer ids to non-NULL pointers, used for
+// products, suppliers, scheduled orders and search joins. Linear probing
+// where an insert steals the slot of any entry closer to its home bucket,
+// which keeps probe lengths short and even; a lookup stops at the first
+// empty slot or richer resident. Deletion shifts the rest of the run back
+// a slot, so there are no tombstones. The load factor stays under 3/4.
+typedef struct RhSlot {
+    void* value;  // NULL when the slot is empty
+    int64_t key;
+    int dist;     // Probe distance from the home bucket
+} RhSlot;
+
+typedef struct RhIndex {
+    RhSlot* slots;
+    size_t capacity;  // Always a power of two
+    size_t count;
+    int shift;
+} RhIndex;
+
+// capacity must be a power of two
+bool rh_index_init(RhIndex* index, size_t capacity);
+void rh_index_free(RhIndex* index);
+// Grow ahead of count entries; false if out of memory
+bool rh_index_reserve(RhIndex* index, size_t count);
+// key must not be present; false (and nothing added) if the table could not grow
+bool rh_index_insert(RhIndex* index, int64_t key, void* value);
+void rh_index_erase(RhIndex* index, int64_t key);
+
+static inline size_t rh_index_home(const RhIndex* index, int64_t key) {
+    // Fibonacci hashing spreads sequential ids across the table
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> index->shift);
+}
+
+// Value stored for key, or NULL; *probes receives the slots examined.
+// Inline, since it sits on the product lookup path.
+static inline void* rh_index_probe(const RhIndex* index, int64_t key, int* probes) {
+    size_t mask = index->capacity - 1;
+    size_t i = rh_index_home(index, key);
+    for (int dist = 0; ; dist++, i = (i + 1) & mask) {
+        const RhSlot* slot = &index->slots[i];
+        // An empty slot or a richer resident means the key is absent
+        if (!slot->value || slot->dist < dist) {
+            *probes = dist + 1;
+            return NULL;
+        }
+        if (slot->key == key) {
+            *probes = dist + 1;
+            return slot->value;
+        }
+    }
+}
+
+static inline void* rh_index_find(const RhIndex* index, int64_t key) {
+    int probes;
+    return rh_index_probe(index, key, &probes);
+}
+
+#endif // RHINDEX_H
@@ -0,0 +1,256 @@
+#include "scheduler.h"
+#include "rhindex.h"
+#include "histogram.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+
+#define SCHED_INDEX_INITIAL 64
+
+// Pairing heap node. Children form a doubly linked sibling list so any
+// node can be cut out in O(1).
+typedef struct SchedNode {
+    struct SchedNode* child;
+    struct SchedNode* sibling;
+    struct SchedNode* prev;   // Parent for a first child, else left sibling
+    int priority;
+    long long deadline;       // Monotonic ns; LLONG_MAX without one
+    uint64_t arrival;         // Submission sequence number
+    long long submitted;      // Monotonic ns
+    Order order;              // items points at the trailing array
+    OrderItem items[];
+} SchedNode;
+
+// Dispatch latency in nanoseconds
+typedef struct LatencyHistogram {
+    uint64_t count;
+    double sum;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+} LatencyHistogram;
+
+struct OrderScheduler {
+    SchedNode* root;
+    int count;
+    uint64_t arrivals;
+    SchedNode* retired;       // Last popped node, freed on the next pop
+    RhIndex index;            // Order id -> heap node
+    LatencyHistogram latency[SCHED_CLASSES];
+    long long cancelled[SCHED_CLASSES];
+    long long missed[SCHED_CLASSES];
+};
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Pairing heap functions
+static bool node_before(const SchedNode* a, const SchedNode* b) {
+    if (a->priority != b->priority) return a->priority < b->priority;
+    if (a->deadline != b->deadline) return a->deadline < b->deadline;
+    return a->arrival < b->arrival;
+}
+
+// Link two detached roots; the later one becomes the other's first child
+static SchedNode* meld(SchedNode* a, SchedNode* b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (node_before(b, a)) {
+        SchedNode* t = a;
+        a = b;
+        b = t;
+    }
+    b->prev = a;
+    b->sibling = a->child;
+    if (a->child) a->child->prev = b;
+    a->child = b;
+    return a;
+}
+
+// Two-pass merge of a sibling list into one tree: meld pairs left to
+// right, then fold the results right to left
+static SchedNode* merge_pairs(SchedNode* first) {
+    SchedNode* pairs = NULL;  // Melded pairs, last one first
+    while (first) {
+        SchedNode* a = first;
+        SchedNode* b = a->sibling;
+        first = b ? b->sibling : NULL;
+        a->sibling = a->prev = NULL;
+        if (b) b->sibling = b->prev = NULL;
+        SchedNode* m = meld(a, b);
+        m->sibling = pairs;
+        pairs = m;
+    }
+    SchedNode* root = NULL;
+    while (pairs) {
+        SchedNode* next = pairs->sibling;
+        pairs->sibling = NULL;
+        root = meld(pairs, root);
+        pairs = next;
+    }
+    return root;
+}
+
+// Detach a non-root node (with its subtree) from its parent
+static void cut(SchedNode* n) {
+    if (n->prev->child == n) n->prev->child = n->sibling;
+    else n->prev->sibling = n->sibling;
+    if (n->sibling) n->sibling->prev = n->prev;
+    n->sibling = n->prev = NULL;
+}
+
+// Take n out of the heap, leaving it detached and childless
+static void heap_remove(OrderScheduler* s, SchedNode* n) {
+    SchedNode* children = merge_pairs(n->child);
+    n->child = NULL;
+    if (n == s->root) {
+        s->root = children;
+    } else {
+        cut(n);
+        s->root = meld(s->root, children);
+    }
+}
+
+static long long deadline_of(long long submitted, long long deadlineMs) {
+    if (deadlineMs == SCHED_NO_DEADLINE || deadlineMs > (LLONG_MAX - submitted) / 1000000LL) {
+        return LLONG_MAX;
+    }
+    return submitted + deadlineMs * 1000000LL;
+}
+
+// Latency histogram functions
+static void hist_record(LatencyHistogram* h, long long ns) {
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    h->count++;
+    h->sum += (double)v;
+    if (v > h->max) h->max = v;
+    h->buckets[hist_bucket(v)]++;
+}
+
+static double hist_seconds(const LatencyHistogram* h, double q) {
+    return hist_percentile(h->buckets, h->count, h->max, q) / 1e9;
+}
+
+OrderScheduler* scheduler_create(void) {
+    OrderScheduler* s = (OrderScheduler*)calloc(1, sizeof(OrderScheduler));
+    if (!s) return NULL;
+    if (!rh_index_init(&s->index, SCHED_INDEX_INITIAL)) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void scheduler_destroy(OrderScheduler* s) {
+    if (!s) return;
+    for (size_t i = 0; i < s->index.capacity; i++) free(s->index.slots[i].value);
+    free(s->retired);
+    rh_index_free(&s->index);
+    free(s);
+}
+
+bool scheduler_submit(OrderScheduler* s, Order o, int priority, long long deadlineMs) {
+    if (priority < 0 || priority >= SCHED_CLASSES || deadlineMs < 0 || o.numItems < 0) return false;
+    if (rh_index_find(&s->index, o.id)) return false;
+    SchedNode* n = (SchedNode*)malloc(sizeof(SchedNode) + (size_t)o.numItems * sizeof(OrderItem));
+    if (!n) return false;
+    if (o.numItems) memcpy(n->items, o.items, (size_t)o.numItems * sizeof(OrderItem));
+    n->order = o;
+    n->order.items = n->items;
+    n->child = n->sibling = n->prev = NULL;
+    n->priority = priority;
+    n->arrival = s->arrivals++;
+    n->submitted = now_ns();
+    n->deadline = deadline_of(n->submitted, deadlineMs);
+    if (!rh_index_insert(&s->index, o.id, n)) {
+        free(n);
+        return false;
+    }
+    s->count++;
+    s->root = meld(s->root, n);
+    return true;
+}
+
+bool scheduler_reprioritize(OrderScheduler* s, int orderId, int priority, long long deadlineMs) {
+    if (priority < 0 || priority >= SCHED_CLASSES || deadlineMs < 0) return false;
+    SchedNode* n = (SchedNode*)rh_index_find(&s->index, orderId);
+    if (!n) return false;
+
+    int oldPriority = n->priority;
+    long long oldDeadline = n->deadline;
+    n->priority = priority;
+    n->deadline = deadline_of(n->submitted, deadlineMs);
+    if (priority > oldPriority || (priority == oldPriority && n->deadline > oldDeadline)) {
+        // Less urgent: its children may now belong above it
+        heap_remove(s, n);
+        s->root = meld(s->root, n);
+    } else if (n != s->root) {
+        // More urgent (or unchanged): its subtree stays heap-ordered
+        cut(n);
+        s->root = meld(s->root, n);
+    }
+    return true;
+}
+
+bool scheduler_cancel(OrderScheduler* s, int orderId) {
+    SchedNode* n = (SchedNode*)rh_index_find(&s->index, orderId);
+    if (!n) return false;
+    heap_remove(s, n);
+    rh_index_erase(&s->index, orderId);
+    s->count--;
+    s->cancelled[n->priority]++;
+    free(n);
+    return true;
+}
+
+bool scheduler_contains(OrderScheduler* s, int orderId) {
+    return rh_index_find(&s->index, orderId) != NULL;
+}
+
+int scheduler_count(OrderScheduler* s) {
+    return s->count;
+}
+
+bool scheduler_pop(OrderScheduler* s, Order* out, int* priority) {
+    free(s->retired);
+    s->retired = NULL;
+    SchedNode* n = s->root;
+    if (!n) return false;
+    heap_remove(s, n);
+    rh_index_erase(&s->index, n->order.id);
+    s->count--;
+
+    long long now = now_ns();
+    hist_record(&s->latency[n->priority], now - n->submitted);
+    if (now > n->deadline) s->missed[n->priority]++;
+    s->retired = n;
+    *out = n->order;
+    if (priority) *priority = n->priority;
+    return true;
+}
+
+OrderOutcome scheduler_fulfill_next(OrderScheduler* s, Inventory* inv, Order* order, ProductId* failedProduct) {
+    Order o;
+    if (!scheduler_pop(s, &o, NULL)) return ORDER_QUEUE_EMPTY;
+    if (order) *order = o;
+    return orders_fulfill(inv, &o, failedProduct);
+}
+
+void scheduler_class_stats(OrderScheduler* s, int priority, SchedulerClassStats* out) {
+    memset(out, 0, sizeof(SchedulerClassStats));
+    if (priority < 0 || priority >= SCHED_CLASSES) return;
+    const LatencyHistogram* h = &s->latency[priority];
+    out->dispatched = (long long)h->count;
+    out->cancelled = s->cancelled[priority];
+    out->missed = s->missed[priority];
+    out->mean = h->count ? h->sum / (double)h->count / 1e9 : 0;
+    out->p50 = hist_seconds(h, 0.50);
+    out->p90 = hist_seconds(h, 0.90);
+    out->p99 = hist_seconds(h, 0.99);
+    out->p999 = hist_seconds(h, 0.999);
+    out->max = h->max / 1e9;
+}
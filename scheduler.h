@@ -0,0 +1,53 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "inventory.h"
+#include "orders.h"
+
+// Priority/deadline order scheduler, the alternative to the FIFO
+// OrdersQueue. Orders are dispatched by (priority, deadline, arrival):
+// lower priority classes first, then earlier deadlines, then submission
+// order. Backed by a pairing heap with an order id index, so reprioritize
+// and cancel are O(log n) amortized. Single-threaded.
+#define SCHED_CLASSES 4          // Priority classes 0 (most urgent) .. 3
+#define SCHED_NO_DEADLINE 0      // Deadline argument meaning "none"
+
+typedef struct OrderScheduler OrderScheduler;
+
+// Submission-to-dispatch latency of one priority class, in seconds
+typedef struct SchedulerClassStats {
+    long long dispatched;
+    long long cancelled;
+    long long missed;      // Dispatched after their deadline
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+} SchedulerClassStats;
+
+OrderScheduler* scheduler_create(void);
+void scheduler_destroy(OrderScheduler* s);
+
+// Copies o (items included). deadlineMs counts from submission. Fails if
+// the order id is already scheduled or priority is out of range.
+bool scheduler_submit(OrderScheduler* s, Order o, int priority, long long deadlineMs);
+// Move a scheduled order to another class and/or deadline (still counted
+// from its original submission); it keeps its place among equal keys
+bool scheduler_reprioritize(OrderScheduler* s, int orderId, int priority, long long deadlineMs);
+bool scheduler_cancel(OrderScheduler* s, int orderId);
+bool scheduler_contains(OrderScheduler* s, int orderId);
+int scheduler_count(OrderScheduler* s);
+
+// Remove the most urgent order and record its latency. out->items stays
+// valid until the next pop; priority may be NULL.
+bool scheduler_pop(OrderScheduler* s, Order* out, int* priority);
+// Pop and fulfill like orders_fulfill_next
+OrderOutcome scheduler_fulfill_next(OrderScheduler* s, Inventory* inv, Order* order, ProductId* failedProduct);
+
+void scheduler_class_stats(OrderScheduler* s, int priority, SchedulerClassStats* out);
+
+#endif // SCHEDULER_H
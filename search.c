@@ -1,240 +1,358 @@
 #include "search.h"
+#include "metrics.h"
+#include "rhindex.h"
+#include "textindex.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <limits.h>
 
-// BST Node for price-based searching
-typedef struct PriceNode {
-    double key;
-    int productId;
-    struct PriceNode* left;
-    struct PriceNode* right;
-} PriceNode;
-
-// BST Node for category-based searching
-typedef struct CategoryNode {
-    char category[MAX_CATEGORY_LEN];
-    int* productIds;
+// Qualifying suppliers go in a direct table when their ids span at most
+// this many slots per supplier (plus a little slack), else in a hash
+#define SUPPLIER_SET_DENSITY 4
+#define SUPPLIER_SET_SLACK 1024
+
+// Supplier side of the join: id -> score of every supplier passing the
+// supplier predicates, built once per search and probed per product
+typedef struct SupplierSet {
+    int minId;
+    size_t span;      // Direct table slots, 0 when hashed
+    double* direct;   // Score by id - minId, NAN where absent
+    RhIndex index;    // Id -> entry of scores when hashed
+    double* scores;
+} SupplierSet;
+
+// One page being selected by the index visitors. Hits after the cursor
+// go into the caller's buffer. When the access path yields them in sort
+// order the page is complete at limit; otherwise they are appended until
+// the buffer fills, which then becomes a bounded max-heap of the best so
+// far.
+typedef struct PageSet {
+    const SearchCriteria* criteria;
+    const SupplierSet* suppliers;  // NULL when there is no join
+    bool filterSuppliers;          // Drop products whose supplier is not in the set
+    const SearchCursor* cursor;
+    SearchHit* hits;
+    int limit;
     int count;
-    int capacity;
-    struct CategoryNode* left;
-    struct CategoryNode* right;
-} CategoryNode;
-
-// Result structure for search output
-typedef struct Result {
-    int productId;
-    double price;
-    char name[MAX_NAME_LEN];
-} Result;
-
-// Price BST operations
-static PriceNode* price_insert(PriceNode* root, double key, int productId) {
-    if (!root) {
-        PriceNode* node = (PriceNode*)malloc(sizeof(PriceNode));
-        node->key = key;
-        node->productId = productId;
-        node->left = node->right = NULL;
-        return node;
+    long long matched;             // Matches after the cursor, kept or not
+    long long examined;            // Products offered by the access path
+    bool ordered;
+    bool heaped;
+} PageSet;
+
+// Position of a hit in the result order; ties always break on product id
+typedef struct SortKey {
+    double primary;
+    double secondary;
+    const char* name;
+    ProductId id;
+} SortKey;
+
+// 'p': cheapest first. 's': best supplier first, unknown suppliers last,
+// then cheapest. 'n': by name. Anything else: by product id.
+static SortKey hit_key(char sortBy, const SearchHit* h) {
+    SortKey k = { 0.0, 0.0, h->product->name, h->product->id };
+    if (sortBy == 'p') {
+        k.primary = h->product->price;
+    } else if (sortBy == 's') {
+        k.primary = isnan(h->supplierScore) ? INFINITY : -h->supplierScore;
+        k.secondary = h->product->price;
     }
-    
-    if (key < root->key || (key == root->key && productId < root->productId)) {
-        root->left = price_insert(root->left, key, productId);
+    return k;
+}
+
+static SortKey cursor_key(const SearchCursor* c) {
+    SortKey k = { c->primary, c->secondary, c->name, c->id };
+    return k;
+}
+
+static int key_cmp(char sortBy, const SortKey* a, const SortKey* b) {
+    if (sortBy == 'n') {
+        int c = strcmp(a->name, b->name);
+        if (c) return c;
     } else {
-        root->right = price_insert(root->right, key, productId);
+        if (a->primary != b->primary) return a->primary < b->primary ? -1 : 1;
+        if (a->secondary != b->secondary) return a->secondary < b->secondary ? -1 : 1;
     }
-    
-    return root;
+    return (a->id > b->id) - (a->id < b->id);
 }
 
-static void price_inorder(PriceNode* root, int* arr, int* idx, int maxSize) {
-    if (!root || *idx >= maxSize) return;
-    
-    price_inorder(root->left, arr, idx, maxSize);
-    if (*idx < maxSize) {
-        arr[(*idx)++] = root->productId;
+static int hit_cmp(char sortBy, const SearchHit* a, const SearchHit* b) {
+    SortKey x = hit_key(sortBy, a), y = hit_key(sortBy, b);
+    return key_cmp(sortBy, &x, &y);
+}
+
+// Max-heap on the result order: the worst kept hit sits at the root
+static void hits_sift_down(SearchHit* hits, int count, int i, char sortBy) {
+    for (;;) {
+        int worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && hit_cmp(sortBy, &hits[left], &hits[worst]) > 0) worst = left;
+        if (right < count && hit_cmp(sortBy, &hits[right], &hits[worst]) > 0) worst = right;
+        if (worst == i) return;
+        SearchHit t = hits[i];
+        hits[i] = hits[worst];
+        hits[worst] = t;
+        i = worst;
+    }
+}
+
+// qsort forms for a page that never filled up
+static int hit_cmp_id(const void* a, const void* b) {
+    return hit_cmp(0, (const SearchHit*)a, (const SearchHit*)b);
+}
+
+static int hit_cmp_price(const void* a, const void* b) {
+    return hit_cmp('p', (const SearchHit*)a, (const SearchHit*)b);
+}
+
+static int hit_cmp_name(const void* a, const void* b) {
+    return hit_cmp('n', (const SearchHit*)a, (const SearchHit*)b);
+}
+
+static int hit_cmp_supplier(const void* a, const void* b) {
+    return hit_cmp('s', (const SearchHit*)a, (const SearchHit*)b);
+}
+
+static double supplier_set_find(const SupplierSet* set, int id) {
+    if (set->span) {
+        size_t slot = (size_t)((long long)id - set->minId);
+        return slot < set->span ? set->direct[slot] : NAN;
     }
-    price_inorder(root->right, arr, idx, maxSize);
+    const double* score = (const double*)rh_index_find(&set->index, id);
+    return score ? *score : NAN;
 }
 
-static void free_price_tree(PriceNode* root) {
-    if (!root) return;
-    free_price_tree(root->left);
-    free_price_tree(root->right);
-    free(root);
+static bool supplier_passes(const SupplierRatings* r, const SearchCriteria* c) {
+    if (!c->hasSupplierRatingsMin) return true;
+    const SupplierRatings* m = &c->supplierRatingsMin;
+    return r->quality >= m->quality && r->deliveryTime >= m->deliveryTime && r->price >= m->price &&
+           r->reliability >= m->reliability && r->customerService >= m->customerService;
 }
 
-// Category BST operations
-static CategoryNode* category_search(CategoryNode* root, const char* category) {
-    if (!root) return NULL;
+// Build the supplier set from the score-ordered tree: only suppliers at or
+// above the minimum score are visited
+static bool supplier_set_build(SupplierSet* set, SuppliersDB* sdb, const SearchCriteria* c) {
+    memset(set, 0, sizeof(SupplierSet));
+    int total = suppliers_count(sdb);
+    const Supplier** matches = (const Supplier**)malloc(sizeof(Supplier*) * (size_t)(total ? total : 1));
+    if (!matches) return false;
     
-    int cmp = strcmp(category, root->category);
-    if (cmp == 0) return root;
-    else if (cmp < 0) return category_search(root->left, category);
-    else return category_search(root->right, category);
-}
-
-static CategoryNode* category_insert(CategoryNode* root, const char* category, int productId) {
-    if (!root) {
-        CategoryNode* node = (CategoryNode*)malloc(sizeof(CategoryNode));
-        strncpy(node->category, category, MAX_CATEGORY_LEN - 1);
-        node->category[MAX_CATEGORY_LEN - 1] = '\0';
-        node->capacity = 10;
-        node->productIds = (int*)malloc(sizeof(int) * node->capacity);
-        node->productIds[0] = productId;
-        node->count = 1;
-        node->left = node->right = NULL;
-        return node;
+    SupplierRange it;
+    const Supplier* sup;
+    int count = 0;
+    long long minId = INT_MAX, maxId = INT_MIN;
+    suppliers_range_begin(sdb, c->hasSupplierScoreMin ? c->supplierScoreMin : -DBL_MAX, DBL_MAX, &it);
+    while ((sup = suppliers_range_next(&it)) != NULL) {
+        if (!supplier_passes(&sup->ratings, c)) continue;
+        matches[count++] = sup;
+        if (sup->id < minId) minId = sup->id;
+        if (sup->id > maxId) maxId = sup->id;
     }
     
-    int cmp = strcmp(category, root->category);
-    if (cmp == 0) {
-        // Add product to existing category
-        if (root->count >= root->capacity) {
-            root->capacity *= 2;
-            root->productIds = (int*)realloc(root->productIds, sizeof(int) * root->capacity);
+    size_t span = count ? (size_t)(maxId - minId + 1) : 0;
+    bool ok;
+    if (count && span <= (size_t)count * SUPPLIER_SET_DENSITY + SUPPLIER_SET_SLACK) {
+        set->minId = (int)minId;
+        set->span = span;
+        set->direct = (double*)malloc(sizeof(double) * span);
+        ok = set->direct != NULL;
+        for (size_t i = 0; ok && i < span; i++) set->direct[i] = NAN;
+        for (int i = 0; ok && i < count; i++) {
+            set->direct[matches[i]->id - set->minId] = supplier_overall_score(&matches[i]->ratings);
         }
-        root->productIds[root->count++] = productId;
-    } else if (cmp < 0) {
-        root->left = category_insert(root->left, category, productId);
     } else {
-        root->right = category_insert(root->right, category, productId);
+        set->scores = (double*)malloc(sizeof(double) * (size_t)(count ? count : 1));
+        ok = set->scores && rh_index_init(&set->index, 16) && rh_index_reserve(&set->index, (size_t)count);
+        for (int i = 0; ok && i < count; i++) {
+            set->scores[i] = supplier_overall_score(&matches[i]->ratings);
+            ok = rh_index_insert(&set->index, matches[i]->id, &set->scores[i]);
+        }
     }
-    
-    return root;
+    free(matches);
+    return ok;
 }
 
-static void free_category_tree(CategoryNode* root) {
-    if (!root) return;
-    free_category_tree(root->left);
-    free_category_tree(root->right);
-    free(root->productIds);
-    free(root);
+static void supplier_set_free(SupplierSet* set) {
+    free(set->direct);
+    rh_index_free(&set->index);
+    free(set->scores);
 }
 
-// Comparison functions for sorting results
-static int compare_by_price(const void* a, const void* b) {
-    const Result* x = (const Result*)a;
-    const Result* y = (const Result*)b;
+// Apply the remaining filters and offer a match to the page
+static void collect_match(Product* p, void* ctx) {
+    PageSet* set = (PageSet*)ctx;
+    const SearchCriteria* criteria = set->criteria;
+    set->examined++;
     
-    if (x->price < y->price) return -1;
-    if (x->price > y->price) return 1;
-    return 0;
+    if (criteria->hasCategory && strcmp(p->category, criteria->category) != 0) return;
+    if (criteria->onlyInStock && p->stock <= 0) return;
+    if (criteria->hasPriceMin && p->price < criteria->priceMin) return;
+    if (criteria->hasPriceMax && p->price > criteria->priceMax) return;
+    if (criteria->hasNamePrefix && !text_starts_with(p->name, criteria->namePrefix)) return;
+    if (criteria->hasNameContains && !text_contains(p->name, criteria->nameContains)) return;
+    // Probe the supplier side last, once the cheap product filters passed
+    double supplierScore = set->suppliers ? supplier_set_find(set->suppliers, p->supplierId) : NAN;
+    if (set->filterSuppliers && isnan(supplierScore)) return;
+    
+    char sortBy = criteria->sortBy;
+    SearchHit hit = { p, supplierScore };
+    if (set->cursor->started) {
+        SortKey key = hit_key(sortBy, &hit), last = cursor_key(set->cursor);
+        if (key_cmp(sortBy, &key, &last) <= 0) return;
+    }
+    set->matched++;
+    
+    if (set->count < set->limit) {
+        set->hits[set->count++] = hit;
+        return;
+    }
+    if (set->ordered || set->limit == 0) return;
+    if (!set->heaped) {
+        for (int i = set->count / 2 - 1; i >= 0; i--) hits_sift_down(set->hits, set->count, i, sortBy);
+        set->heaped = true;
+    }
+    if (hit_cmp(sortBy, &hit, &set->hits[0]) < 0) {
+        set->hits[0] = hit;
+        hits_sift_down(set->hits, set->count, 0, sortBy);
+    }
 }
 
-static int compare_by_name(const void* a, const void* b) {
-    const Result* x = (const Result*)a;
-    const Result* y = (const Result*)b;
-    
-    return strcmp(x->name, y->name);
+// Ordered access paths stop at the first match past a full page
+static bool collect_ordered(Product* p, void* ctx) {
+    PageSet* set = (PageSet*)ctx;
+    collect_match(p, set);
+    return set->matched <= set->limit;
 }
 
-// Helper function to collect all products from inventory
-static void collect_all_products(Inventory* inv, int* products, int* count) {
-    *count = 0;
-    
-    // Scan all possible product IDs
-    for (int id = 1; id < MAX_PRODUCTS && *count < MAX_PRODUCTS; id++) {
-        Product* p = inventory_get_product(inv, id);
-        if (p) {
-            products[(*count)++] = id;
-        }
-    }
+static bool joins_suppliers(SuppliersDB* sdb, const SearchCriteria* c) {
+    return sdb && (c->hasSupplierScoreMin || c->hasSupplierRatingsMin || c->sortBy == 's');
 }
 
-void search_build_and_execute(Inventory* inv, SuppliersDB* sdb, SearchCriteria criteria) {
-    if (!inv) {
-        printf("Invalid inventory!\n");
-        return;
+static int page(Inventory* inv, SuppliersDB* sdb, const SearchCriteria* criteria,
+                SearchCursor* cursor, SearchHit* out, int limit) {
+
+    // Supplier side of the join, built once up front
+    SupplierSet suppliers;
+    bool joinSuppliers = joins_suppliers(sdb, criteria);
+    if (joinSuppliers && !supplier_set_build(&suppliers, sdb, criteria)) {
+        supplier_set_free(&suppliers);
+        return -1;
     }
+    PageSet set = { criteria, joinSuppliers ? &suppliers : NULL,
+                    joinSuppliers && (criteria->hasSupplierScoreMin || criteria->hasSupplierRatingsMin),
+                    cursor, out, limit, 0, 0, 0, false, false };
     
-    // Build BST structures for searching
-    PriceNode* priceRoot = NULL;
-    CategoryNode* categoryRoot = NULL;
-    
-    // Collect all products and build search structures
-    int allProducts[MAX_PRODUCTS];
-    int totalProducts = 0;
-    collect_all_products(inv, allProducts, &totalProducts);
-    
-    // Build price BST and category BST
-    for (int i = 0; i < totalProducts; i++) {
-        Product* p = inventory_get_product(inv, allProducts[i]);
-        if (!p) continue;
-        
-        // Add to price BST
-        priceRoot = price_insert(priceRoot, p->price, p->id);
-        
-        // Add to category BST
-        categoryRoot = category_insert(categoryRoot, p->category, p->id);
+    // Pick an access path: the name index for typed text, a selective
+    // category chain, the price index when the output must be price-ordered
+    // anyway (starting at the cursor), otherwise a columnar scan
+    int total = inventory_count(inv);
+    if (criteria->hasNamePrefix) {
+        inventory_for_each_name_prefix(inv, criteria->namePrefix, collect_match, &set);
+    } else if (criteria->hasNameContains) {
+        inventory_for_each_name_containing(inv, criteria->nameContains, collect_match, &set);
+    } else if (criteria->hasCategory && inventory_category_count(inv, criteria->category) * 4 <= total) {
+        inventory_for_each_in_category(inv, criteria->category, collect_match, &set);
+    } else if (criteria->sortBy == 'p') {
+        double minPrice = criteria->hasPriceMin ? criteria->priceMin : -INFINITY;
+        double maxPrice = criteria->hasPriceMax ? criteria->priceMax : INFINITY;
+        if (cursor->started && cursor->primary > minPrice) minPrice = cursor->primary;
+        set.ordered = true;
+        inventory_walk_price_range(inv, minPrice, maxPrice, collect_ordered, &set);
+    } else {
+        ProductFilter filter = {0};
+        filter.hasPriceMin = criteria->hasPriceMin;
+        filter.priceMin = criteria->priceMin;
+        filter.hasPriceMax = criteria->hasPriceMax;
+        filter.priceMax = criteria->priceMax;
+        filter.onlyInStock = criteria->onlyInStock;
+        filter.category = criteria->hasCategory ? criteria->category : NULL;
+        inventory_scan(inv, &filter, collect_match, &set);
     }
+    if (joinSuppliers) supplier_set_free(&suppliers);
     
-    // Collect candidate products based on search criteria
-    int candidates[MAX_PRODUCTS];
-    int candidateCount = 0;
-    
-    if (criteria.hasCategory) {
-        // Search by category using BST
-        CategoryNode* categoryNode = category_search(categoryRoot, criteria.category);
-        if (categoryNode) {
-            for (int i = 0; i < categoryNode->count && candidateCount < MAX_PRODUCTS; i++) {
-                candidates[candidateCount++] = categoryNode->productIds[i];
-            }
+    // Put the kept hits in result order: heap sort a full page, plain sort
+    // one that never filled
+    if (set.heaped) {
+        for (int end = set.count - 1; end > 0; end--) {
+            SearchHit t = out[0];
+            out[0] = out[end];
+            out[end] = t;
+            hits_sift_down(out, end, 0, criteria->sortBy);
         }
-    } else {
-        // Use all products (sorted by price from BST)
-        price_inorder(priceRoot, candidates, &candidateCount, MAX_PRODUCTS);
+    } else if (!set.ordered) {
+        char sortBy = criteria->sortBy;
+        qsort(out, (size_t)set.count, sizeof(SearchHit),
+              sortBy == 'p' ? hit_cmp_price : sortBy == 'n' ? hit_cmp_name :
+              sortBy == 's' ? hit_cmp_supplier : hit_cmp_id);
     }
     
-    // Filter candidates and create results
-    Result results[MAX_PRODUCTS];
-    int resultCount = 0;
-    
-    for (int i = 0; i < candidateCount; i++) {
-        Product* p = inventory_get_product(inv, candidates[i]);
-        if (!p) continue;
-        
-        // Apply filters
-        if (criteria.onlyInStock && p->stock <= 0) continue;
-        if (criteria.hasPriceMin && p->price < criteria.priceMin) continue;
-        if (criteria.hasPriceMax && p->price > criteria.priceMax) continue;
-        
-        // Add to results
-        if (resultCount < MAX_PRODUCTS) {
-            results[resultCount].productId = p->id;
-            results[resultCount].price = p->price;
-            strncpy(results[resultCount].name, p->name, MAX_NAME_LEN - 1);
-            results[resultCount].name[MAX_NAME_LEN - 1] = '\0';
-            resultCount++;
-        }
+    if (set.count > 0) {
+        SortKey last = hit_key(criteria->sortBy, &out[set.count - 1]);
+        cursor->started = true;
+        cursor->primary = last.primary;
+        cursor->secondary = last.secondary;
+        memcpy(cursor->name, last.name, MAX_NAME_LEN);
+        cursor->name[MAX_NAME_LEN - 1] = '\0';
+        cursor->id = last.id;
     }
+    cursor->done = set.matched <= set.count;
+    METRIC_ADD(METRIC_SEARCH_EXAMINED, set.examined);
+    METRIC_ADD(METRIC_SEARCH_HITS, set.matched);
+    return set.count;
+}
+
+int search_page(Inventory* inv, SuppliersDB* sdb, const SearchCriteria* criteria,
+                SearchCursor* cursor, SearchHit* out, int limit) {
+    if (!inv || !criteria || !cursor || (limit > 0 && !out) || limit < 0) return -1;
+    if (cursor->done) return 0;
+    METRIC_START(start);
+    int count = page(inv, sdb, criteria, cursor, out, limit);
+    METRIC_INC(METRIC_SEARCH_PAGES);
+    METRIC_STOP(METRIC_OP_SEARCH_PAGE, start);
+    return count;
+}
+
+void search_print(const SearchHit* hits, int count, bool withSuppliers) {
+    printf("\n-- Search Results (%d items) --\n", count);
     
-    // Sort results based on criteria
-    if (criteria.sortBy == 'p') {
-        qsort(results, resultCount, sizeof(Result), compare_by_price);
-    } else if (criteria.sortBy == 'n') {
-        qsort(results, resultCount, sizeof(Result), compare_by_name);
+    if (count == 0) {
+        printf("No products match your search criteria.\n");
+        return;
     }
+    printf("%-5s %-20s %-12s %-15s %-8s", "ID", "Name", "Price", "Category", "Stock");
+    printf(withSuppliers ? " %-9s %s\n" : "\n", "Supplier", "Score");
+    printf("-------------------------------------------------------------%s\n",
+           withSuppliers ? "----------------" : "");
     
-    // Display results
-    printf("\n-- Search Results (%d items) --\n", resultCount);
+    for (int i = 0; i < count; i++) {
+        const Product* p = hits[i].product;
+        printf("%-5lld %-20s $%-11.2f %-15s %-8d",
+               p->id, p->name, p->price, p->category, p->stock);
+        if (!withSuppliers) putchar('\n');
+        else if (isnan(hits[i].supplierScore)) printf(" %-9d -\n", p->supplierId);
+        else printf(" %-9d %.2f\n", p->supplierId, hits[i].supplierScore);
+    }
+}
+
+void search_build_and_execute(Inventory* inv, SuppliersDB* sdb, SearchCriteria criteria) {
+    if (!inv) {
+        printf("Invalid inventory!\n");
+        return;
+    }
     
-    if (resultCount == 0) {
-        printf("No products match your search criteria.\n");
+    // Everything as a single page
+    int total = inventory_count(inv);
+    SearchHit* hits = (SearchHit*)malloc(sizeof(SearchHit) * (size_t)(total > 0 ? total : 1));
+    SearchCursor cursor = {0};
+    int count = hits ? search_page(inv, sdb, &criteria, &cursor, hits, total) : -1;
+    if (count < 0) {
+        printf("Out of memory!\n");
     } else {
-        printf("%-5s %-20s %-12s %-15s %-8s\n", "ID", "Name", "Price", "Category", "Stock");
-        printf("-------------------------------------------------------------\n");
-        
-        for (int i = 0; i < resultCount; i++) {
-            Product* p = inventory_get_product(inv, results[i].productId);
-            if (p) {
-                printf("%-5d %-20s $%-11.2f %-15s %-8d\n",
-                       p->id, p->name, p->price, p->category, p->stock);
-            }
-        }
+        search_print(hits, count, joins_suppliers(sdb, &criteria));
     }
-    
-    // Cleanup
-    free_price_tree(priceRoot);
-    free_category_tree(categoryRoot);
-}
\ No newline at end of file
+    free(hits);
+}
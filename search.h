@@ -14,9 +14,47 @@ typedef struct SearchCriteria {
 	bool hasCategory;
 	char category[MAX_CATEGORY_LEN];
 	bool onlyInStock;
-	char sortBy; // 'p' price, 'n' name
+	// Name predicates (ASCII case-insensitive), answered from the name index
+	bool hasNamePrefix;
+	char namePrefix[MAX_NAME_LEN];
+	bool hasNameContains;
+	char nameContains[MAX_NAME_LEN];
+	// Supplier predicates, evaluated as a semi-join against SuppliersDB
+	bool hasSupplierScoreMin;
+	double supplierScoreMin;
+	bool hasSupplierRatingsMin;
+	SupplierRatings supplierRatingsMin; // Per-criterion minimums
+	char sortBy; // 'p' price, 'n' name, 's' supplier score (best first)
 } SearchCriteria;
 
+// One result; product stays valid until the inventory changes
+typedef struct SearchHit {
+	Product* product;
+	double supplierScore; // NAN when the supplier is unknown or not joined
+} SearchHit;
+
+// Keyset continuation: zero it for the first page and pass it back with
+// the same criteria for the next. Callers should treat it as opaque.
+typedef struct SearchCursor {
+	bool started;
+	bool done;
+	double primary;
+	double secondary;
+	char name[MAX_NAME_LEN];
+	ProductId id;
+} SearchCursor;
+
+// Next page of up to limit matches in sortBy order (ties by product id;
+// by id alone for any other sortBy, whatever order the access path
+// produced them in) written to out, and the cursor moved
+// past them. Only the page is kept and sorted, in a bounded heap; earlier
+// pages are skipped by key. Returns the page size, 0 once cursor->done,
+// or -1 if out of memory.
+int search_page(Inventory* inv, SuppliersDB* sdb, const SearchCriteria* c,
+                SearchCursor* cursor, SearchHit* out, int limit);
+// Results table on stdout
+void search_print(const SearchHit* hits, int count, bool withSuppliers);
+// Run the whole search as one page and print it
 void search_build_and_execute(Inventory* inv, SuppliersDB* sdb, SearchCriteria c);
 
 #endif // SEARCH_H
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "SCMSSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ENDIAN_TAG 0x01020304u
+#define SNAPSHOT_ALIGN 64
+
+enum { SEC_PRODUCTS, SEC_SUPPLIERS, SEC_ORDERS, SEC_ORDER_ITEMS, SEC_COUNT };
+
+typedef struct SnapSection {
+    uint64_t offset;      // From the start of the file
+    uint64_t count;
+    uint32_t recordSize;
+    uint32_t reserved;
+} SnapSection;
+
+typedef struct SnapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianTag;
+    uint64_t fileSize;
+    uint64_t checksum;    // Over every byte after the header
+    uint64_t walLsn;      // Last write-ahead log record folded in
+    SnapSection sections[SEC_COUNT];
+} SnapHeader;
+
+// On-disk records: fixed-width fields, no pointers
+typedef struct SnapProduct {
+    int64_t id;
+    double price;
+    int32_t supplierId;
+    int32_t stock;
+    char name[MAX_NAME_LEN];
+    char category[MAX_CATEGORY_LEN];
+} SnapProduct;
+
+typedef struct SnapSupplier {
+    int32_t id;
+    int32_t reserved;
+    double ratings[5];    // Q D P R S
+    char name[MAX_SUPPLIER_NAME];
+} SnapSupplier;
+
+typedef struct SnapOrder {
+    int32_t id;
+    uint32_t numItems;
+    uint64_t firstItem;   // Index into the order items section
+    char customer[MAX_NAME_LEN];
+} SnapOrder;
+
+typedef struct SnapOrderItem {
+    int64_t productId;
+    int32_t quantity;
+    int32_t reserved;
+} SnapOrderItem;
+
+// Cursor over a writable mapping while the sections are filled
+typedef struct SnapWriter {
+    unsigned char* base;
+    SnapHeader* header;
+    uint64_t next[SEC_COUNT];
+} SnapWriter;
+
+static uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Four independent multiply-rotate lanes so verification keeps pace with
+// sequential reads of the mapping
+static uint64_t snapshot_checksum(const unsigned char* data, size_t len) {
+    const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t lane[4] = { P1 + P2, P2, 0, 0 - P1 };
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            memcpy(&w, data + i + l * 8, sizeof(w));
+            lane[l] = rotl64(lane[l] + w * P2, 31) * P1;
+        }
+    }
+    
+    uint64_t h = rotl64(lane[0], 1) + rotl64(lane[1], 7) + rotl64(lane[2], 12) + rotl64(lane[3], 18);
+    h += (uint64_t)len;
+    for (; i < len; i++) {
+        h = rotl64(h ^ (data[i] * P1), 11) * P2;
+    }
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    return h;
+}
+
+static uint64_t align_up(uint64_t x) {
+    return (x + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+static void layout_section(SnapHeader* h, int sec, uint64_t count, uint32_t recordSize, uint64_t* offset) {
+    h->sections[sec].offset = *offset;
+    h->sections[sec].count = count;
+    h->sections[sec].recordSize = recordSize;
+    *offset = align_up(*offset + count * recordSize);
+}
+
+static void* section_record(SnapWriter* w, int sec) {
+    const SnapSection* s = &w->header->sections[sec];
+    return w->base + s->offset + (w->next[sec]++) * s->recordSize;
+}
+
+static void copy_string(char* dst, const char* src, size_t size) {
+    memcpy(dst, src, size);
+    dst[size - 1] = '\0';
+}
+
+static void write_product(Product* p, void* ctx) {
+    SnapProduct* r = (SnapProduct*)section_record((SnapWriter*)ctx, SEC_PRODUCTS);
+    r->id = p->id;
+    r->price = p->price;
+    r->supplierId = p->supplierId;
+    r->stock = p->stock;
+    copy_string(r->name, p->name, MAX_NAME_LEN);
+    copy_string(r->category, p->category, MAX_CATEGORY_LEN);
+}
+
+static void write_supplier(const Supplier* s, void* ctx) {
+    SnapSupplier* r = (SnapSupplier*)section_record((SnapWriter*)ctx, SEC_SUPPLIERS);
+    r->id = s->id;
+    r->ratings[0] = s->ratings.quality;
+    r->ratings[1] = s->ratings.deliveryTime;
+    r->ratings[2] = s->ratings.price;
+    r->ratings[3] = s->ratings.reliability;
+    r->ratings[4] = s->ratings.customerService;
+    copy_string(r->name, s->name, MAX_SUPPLIER_NAME);
+}
+
+static void write_order(const Order* o, void* ctx) {
+    SnapWriter* w = (SnapWriter*)ctx;
+    SnapOrder* r = (SnapOrder*)section_record(w, SEC_ORDERS);
+    r->id = o->id;
+    r->numItems = (uint32_t)o->numItems;
+    r->firstItem = w->next[SEC_ORDER_ITEMS];
+    copy_string(r->customer, o->customer, MAX_NAME_LEN);
+    for (int i = 0; i < o->numItems; i++) {
+        SnapOrderItem* it = (SnapOrderItem*)section_record(w, SEC_ORDER_ITEMS);
+        it->productId = o->items[i].productId;
+        it->quantity = o->items[i].quantity;
+    }
+}
+
+static void count_items(const Order* o, void* ctx) {
+    *(uint64_t*)ctx += (uint64_t)o->numItems;
+}
+
+bool snapshot_save(const char* dir, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, uint64_t walLsn) {
+    char path[512], tmp[520];
+    snprintf(path, sizeof(path), "%s/%s", dir, SNAPSHOT_FILE);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    
+    uint64_t itemCount = 0;
+    orders_for_each(oq, count_items, &itemCount);
+    
+    SnapHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.endianTag = SNAPSHOT_ENDIAN_TAG;
+    header.walLsn = walLsn;
+    
+    uint64_t offset = align_up(sizeof(SnapHeader));
+    layout_section(&header, SEC_PRODUCTS, (uint64_t)inventory_count(inv), sizeof(SnapProduct), &offset);
+    layout_section(&header, SEC_SUPPLIERS, (uint64_t)suppliers_count(sdb), sizeof(SnapSupplier), &offset);
+    layout_section(&header, SEC_ORDERS, (uint64_t)orders_count(oq), sizeof(SnapOrder), &offset);
+    layout_section(&header, SEC_ORDER_ITEMS, itemCount, sizeof(SnapOrderItem), &offset);
+    header.fileSize = offset;
+    
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    
+    // The file is sized up front and filled in place; ftruncate zero-fills
+    // padding so the checksum is deterministic
+    unsigned char* map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)header.fileSize) == 0) {
+        map = (unsigned char*)mmap(NULL, header.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        close(fd);
+        unlink(tmp);
+        return false;
+    }
+    
+    SnapWriter w = { map, &header, {0} };
+    inventory_for_each(inv, write_product, &w);
+    suppliers_for_each(sdb, write_supplier, &w);
+    orders_for_each(oq, write_order, &w);
+    
+    size_t headerSpan = (size_t)align_up(sizeof(SnapHeader));
+    header.checksum = snapshot_checksum(map + headerSpan, header.fileSize - headerSpan);
+    memcpy(map, &header, sizeof(header));
+    
+    bool ok = msync(map, header.fileSize, MS_SYNC) == 0;
+    munmap(map, header.fileSize);
+    ok = fsync(fd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) {
+        unlink(tmp);
+        return false;
+    }
+    
+    // The rename is only durable once the directory entry is on disk
+    int dirFd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0) return false;
+    ok = fsync(dirFd) == 0;
+    ok = close(dirFd) == 0 && ok;
+    return ok;
+}
+
+static const char* validate_header(const SnapHeader* h, uint64_t fileSize) {
+    static const uint32_t recordSizes[SEC_COUNT] = {
+        sizeof(SnapProduct), sizeof(SnapSupplier), sizeof(SnapOrder), sizeof(SnapOrderItem)
+    };
+    
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0) return "bad magic";
+    if (h->version != SNAPSHOT_VERSION) return "unsupported version";
+    if (h->endianTag != SNAPSHOT_ENDIAN_TAG) return "byte order mismatch";
+    if (h->fileSize != fileSize) return "truncated file";
+    
+    for (int i = 0; i < SEC_COUNT; i++) {
+        const SnapSection* s = &h->sections[i];
+        if (s->recordSize != recordSizes[i]) return "record layout mismatch";
+        if (s->offset < sizeof(SnapHeader) || s->offset % SNAPSHOT_ALIGN) return "bad section offset";
+        if (s->offset > fileSize || s->count > (fileSize - s->offset) / s->recordSize) {
+            return "section out of bounds";
+        }
+    }
+    if (h->sections[SEC_PRODUCTS].count > INT32_MAX) return "too many products";
+    return NULL;
+}
+
+static const char* load_sections(const unsigned char* map, const SnapHeader* h,
+                                 Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq) {
+    const SnapSection* sec = h->sections;
+    
+    // Validate cross-references before touching the containers
+    const SnapOrder* orders = (const SnapOrder*)(map + sec[SEC_ORDERS].offset);
+    uint64_t itemCount = sec[SEC_ORDER_ITEMS].count;
+    uint32_t maxItems = 1;
+    for (uint64_t i = 0; i < sec[SEC_ORDERS].count; i++) {
+        if (orders[i].numItems > INT32_MAX) return "order has too many items";
+        if (orders[i].numItems > maxItems) maxItems = orders[i].numItems;
+        if (orders[i].firstItem > itemCount || orders[i].numItems > itemCount - orders[i].firstItem) {
+            return "order item reference out of bounds";
+        }
+    }
+    
+    int productCount = (int)sec[SEC_PRODUCTS].count;
+    const SnapProduct* records = (const SnapProduct*)(map + sec[SEC_PRODUCTS].offset);
+    Product* products = (Product*)malloc(sizeof(Product) * (productCount + 1));
+    if (!products) return "out of memory";
+    for (int i = 0; i < productCount; i++) {
+        Product* p = &products[i];
+        p->id = records[i].id;
+        p->price = records[i].price;
+        p->supplierId = records[i].supplierId;
+        p->stock = records[i].stock;
+        copy_string(p->name, records[i].name, MAX_NAME_LEN);
+        copy_string(p->category, records[i].category, MAX_CATEGORY_LEN);
+    }
+    bool loaded = inventory_bulk_load(inv, products, productCount);
+    free(products);
+    if (!loaded) return "out of memory";
+    
+    const SnapSupplier* suppliers = (const SnapSupplier*)(map + sec[SEC_SUPPLIERS].offset);
+    for (uint64_t i = 0; i < sec[SEC_SUPPLIERS].count; i++) {
+        Supplier s;
+        s.id = suppliers[i].id;
+        s.ratings.quality = suppliers[i].ratings[0];
+        s.ratings.deliveryTime = suppliers[i].ratings[1];
+        s.ratings.price = suppliers[i].ratings[2];
+        s.ratings.reliability = suppliers[i].ratings[3];
+        s.ratings.customerService = suppliers[i].ratings[4];
+        copy_string(s.name, suppliers[i].name, MAX_SUPPLIER_NAME);
+        if (!suppliers_insert(sdb, s)) return "out of memory";
+    }
+    
+    const SnapOrderItem* items = (const SnapOrderItem*)(map + sec[SEC_ORDER_ITEMS].offset);
+    OrderItem* scratch = (OrderItem*)malloc(sizeof(OrderItem) * maxItems);
+    if (!scratch) return "out of memory";
+    for (uint64_t i = 0; i < sec[SEC_ORDERS].count; i++) {
+        Order o;
+        memset(&o, 0, sizeof(o));
+        o.items = scratch;
+        o.id = orders[i].id;
+        o.numItems = (int)orders[i].numItems;
+        copy_string(o.customer, orders[i].customer, MAX_NAME_LEN);
+        for (int k = 0; k < o.numItems; k++) {
+            o.items[k].productId = items[orders[i].firstItem + k].productId;
+            o.items[k].quantity = items[orders[i].firstItem + k].quantity;
+        }
+        if (!orders_enqueue(oq, o)) {
+            free(scratch);
+            return "out of memory";
+        }
+    }
+    free(scratch);
+    return NULL;
+}
+
+SnapshotStatus snapshot_load(const char* dir, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, uint64_t* walLsn) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, SNAPSHOT_FILE);
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) return SNAPSHOT_MISSING;
+        fprintf(stderr, "Error: cannot open snapshot %s: %s\n", path, strerror(errno));
+        return SNAPSHOT_INVALID;
+    }
+    
+    struct stat st;
+    const char* error = NULL;
+    unsigned char* map = MAP_FAILED;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(SnapHeader)) {
+        error = "file too small";
+    } else {
+        map = (unsigned char*)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) error = "mmap failed";
+    }
+    close(fd);
+    
+    if (!error) {
+        const SnapHeader* h = (const SnapHeader*)map;
+        uint64_t fileSize = (uint64_t)st.st_size;
+        size_t headerSpan = (size_t)align_up(sizeof(SnapHeader));
+        error = validate_header(h, fileSize);
+        if (!error && fileSize < headerSpan) error = "truncated file";
+        if (!error) {
+            madvise(map, (size_t)fileSize, MADV_SEQUENTIAL);
+            if (snapshot_checksum(map + headerSpan, fileSize - headerSpan) != h->checksum) {
+                error = "checksum mismatch";
+            }
+        }
+        if (!error) error = load_sections(map, h, inv, sdb, oq);
+        if (!error && walLsn) *walLsn = h->walLsn;
+    }
+    
+    if (map != MAP_FAILED) munmap(map, (size_t)st.st_size);
+    if (error) {
+        fprintf(stderr, "Error: cannot load snapshot %s: %s\n", path, error);
+        return SNAPSHOT_INVALID;
+    }
+    return SNAPSHOT_LOADED;
+}
@@ -0,0 +1,32 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inventory.h"
+#include "orders.h"
+#include "suppliers.h"
+
+// Binary snapshot of inventory, suppliers and queued orders.
+// The file is a versioned header followed by sections of fixed-size records;
+// the header stores each section's offset and a checksum of the payload.
+#define SNAPSHOT_FILE "scms.snap"
+
+// Write a snapshot to <dir>/scms.snap (atomically, via a temp file + rename)
+// and sync the directory; false unless the snapshot is durable.
+// walLsn records the last write-ahead log entry the snapshot includes.
+bool snapshot_save(const char* dir, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, uint64_t walLsn);
+
+typedef enum SnapshotStatus {
+    SNAPSHOT_LOADED,
+    SNAPSHOT_MISSING,   // No snapshot yet: a fresh data directory
+    SNAPSHOT_INVALID    // Present but unreadable, corrupt or only partly loaded
+} SnapshotStatus;
+
+// Map and validate <dir>/scms.snap, then load it into empty containers.
+// On SNAPSHOT_INVALID the containers may hold part of the file and must not
+// be used or checkpointed. On success *walLsn (if non-NULL) receives the log
+// position to replay from.
+SnapshotStatus snapshot_load(const char* dir, Inventory* inv, SuppliersDB* sdb, OrdersQueue* oq, uint64_t* walLsn);
+
+#endif // SNAPSHOT_H
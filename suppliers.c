@@ -1,19 +1,59 @@
 #include "suppliers.h"
+#include "metrics.h"
+#include "rhindex.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SUPPLIERS_X86 1
+#include <immintrin.h>
+#endif
+
+#define SUPPLIER_INDEX_INITIAL 64
+// Radix sort digit for suppliers_set_weights
+#define SUPPLIER_RADIX_BITS 11
+#define SUPPLIER_RADIX (1 << SUPPLIER_RADIX_BITS)
+#define SUPPLIER_ID_PASSES ((32 + SUPPLIER_RADIX_BITS - 1) / SUPPLIER_RADIX_BITS)
+#define SUPPLIER_SCORE_PASSES ((64 + SUPPLIER_RADIX_BITS - 1) / SUPPLIER_RADIX_BITS)
 
 typedef struct AVLNode {
 	Supplier supplier;
 	double key; // overall score
 	int height;
+	int size;   // Nodes in this subtree
+	int row;    // Row in the ratings columns
 	struct AVLNode* left;
 	struct AVLNode* right;
 } AVLNode;
 
+// Ratings in structure-of-arrays form, one row per supplier, so a weight
+// change rescores everyone with vector arithmetic
+typedef struct RatingColumns {
+	double* quality;
+	double* deliveryTime;
+	double* price;
+	double* reliability;
+	double* customerService;
+	double* score;
+	int* id;
+	AVLNode** node;  // Row -> owning node
+	int capacity;
+} RatingColumns;
+
 struct SuppliersDB {
 	AVLNode* root;
+	int count;       // Also the number of rating rows
+	unsigned long version;
+	// Id -> tree node. Nodes never move once allocated (rotations relink
+	// them), so only insert and delete touch the index.
+	RhIndex index;
+	RatingColumns columns;
 };
 static int height(AVLNode* n) { return n ? n->height : 0; }
+static int size(const AVLNode* n) { return n ? n->size : 0; }
 #ifdef max
 #undef max
 #endif
@@ -24,6 +64,8 @@ static AVLNode* rotate_right(AVLNode* y) {
 	x->right = y; y->left = T2;
 	y->height = max(height(y->left), height(y->right)) + 1;
 	x->height = max(height(x->left), height(x->right)) + 1;
+	y->size = size(y->left) + size(y->right) + 1;
+	x->size = size(x->left) + size(x->right) + 1;
 	return x;
 }
 
@@ -32,6 +74,8 @@ static AVLNode* rotate_left(AVLNode* x) {
 	y->left = x; x->right = T2;
 	x->height = max(height(x->left), height(x->right)) + 1;
 	y->height = max(height(y->left), height(y->right)) + 1;
+	x->size = size(x->left) + size(x->right) + 1;
+	y->size = size(y->left) + size(y->right) + 1;
 	return y;
 }
 
@@ -41,58 +85,148 @@ static int cmp(double a, double b) {
 	if (a < b) return -1; if (a > b) return 1; return 0;
 }
 
-static AVLNode* avl_insert(AVLNode* node, Supplier s) {
-	double key = supplier_overall_score(&s.ratings);
-	if (!node) {
-		AVLNode* n = (AVLNode*)malloc(sizeof(AVLNode));
-		n->supplier = s; n->key = key; n->height = 1; n->left = n->right = NULL; return n;
-	}
-	int c = cmp(key, node->key);
-	if (c < 0 || (c == 0 && s.id < node->supplier.id)) node->left = avl_insert(node->left, s);
-	else node->right = avl_insert(node->right, s);
-
+static AVLNode* rebalance(AVLNode* node) {
 	node->height = 1 + max(height(node->left), height(node->right));
+	node->size = 1 + size(node->left) + size(node->right);
 	int balance = get_balance(node);
-	if (balance > 1 && cmp(key, node->left->key) < 0) return rotate_right(node);
-	if (balance < -1 && cmp(key, node->right->key) > 0) return rotate_left(node);
-	if (balance > 1 && cmp(key, node->left->key) > 0) { node->left = rotate_left(node->left); return rotate_right(node);}
-	if (balance < -1 && cmp(key, node->right->key) < 0) { node->right = rotate_right(node->right); return rotate_left(node);}
+	// Pick the rotation from the child's balance: with equal scores the id
+	// decides the side, so comparing keys alone can pick the wrong case
+	if (balance > 1 && get_balance(node->left) >= 0) return rotate_right(node);
+	if (balance > 1) { node->left = rotate_left(node->left); return rotate_right(node); }
+	if (balance < -1 && get_balance(node->right) <= 0) return rotate_left(node);
+	if (balance < -1) { node->right = rotate_right(node->right); return rotate_left(node); }
 	return node;
 }
 
-static AVLNode* min_value_node(AVLNode* node) { AVLNode* cur = node; while (cur && cur->left) cur = cur->left; return cur; }
+// Tree order: score, then id
+static bool node_before(double key, int id, const AVLNode* n) {
+	int c = cmp(key, n->key);
+	return c < 0 || (c == 0 && id < n->supplier.id);
+}
+
+static AVLNode* avl_insert(AVLNode* node, AVLNode* n) {
+	if (!node) return n;
+	if (node_before(n->key, n->supplier.id, node)) node->left = avl_insert(node->left, n);
+	else node->right = avl_insert(node->right, n);
+	return rebalance(node);
+}
 
-static AVLNode* avl_delete(AVLNode* root, double key, int id) {
+// Unlink the leftmost node of a subtree into *min; returns the new subtree
+static AVLNode* avl_remove_min(AVLNode* node, AVLNode** min) {
+	if (!node->left) { *min = node; return node->right; }
+	node->left = avl_remove_min(node->left, min);
+	return rebalance(node);
+}
+
+// Unlink the node with this key without freeing it; the in-order successor
+// takes its place rather than having its contents copied, so other nodes
+// stay put
+static AVLNode* avl_unlink(AVLNode* root, double key, int id) {
 	if (!root) return NULL;
-	int c = cmp(key, root->key);
-	if (c < 0 || (c == 0 && id < root->supplier.id)) root->left = avl_delete(root->left, key, id);
-	else if (c > 0 || (c == 0 && id > root->supplier.id)) root->right = avl_delete(root->right, key, id);
+	if (node_before(key, id, root)) root->left = avl_unlink(root->left, key, id);
+	else if (root->supplier.id != id || cmp(key, root->key) != 0) root->right = avl_unlink(root->right, key, id);
 	else {
-		if (!root->left || !root->right) {
-			AVLNode* tmp = root->left ? root->left : root->right;
-			if (!tmp) { free(root); return NULL; } else { *root = *tmp; free(tmp); }
-		} else {
-			AVLNode* tmp = min_value_node(root->right);
-			root->supplier = tmp->supplier; root->key = tmp->key;
-			root->right = avl_delete(root->right, tmp->key, tmp->supplier.id);
-		}
+		AVLNode* left = root->left; AVLNode* right = root->right;
+		if (!left || !right) return left ? left : right;
+		AVLNode* succ;
+		right = avl_remove_min(right, &succ);
+		succ->left = left; succ->right = right;
+		root = succ;
 	}
-	root->height = 1 + max(height(root->left), height(root->right));
-	int balance = get_balance(root);
-	if (balance > 1 && get_balance(root->left) >= 0) return rotate_right(root);
-	if (balance > 1 && get_balance(root->left) < 0) { root->left = rotate_left(root->left); return rotate_right(root);}
-	if (balance < -1 && get_balance(root->right) <= 0) return rotate_left(root);
-	if (balance < -1 && get_balance(root->right) > 0) { root->right = rotate_right(root->right); return rotate_left(root);}
-	return root;
+	return rebalance(root);
 }
 
 static void avl_free(AVLNode* n) { if (!n) return; avl_free(n->left); avl_free(n->right); free(n); }
 
-SuppliersDB* suppliers_create(void) { return (SuppliersDB*)calloc(1, sizeof(SuppliersDB)); }
+#ifndef SCMS_NO_METRICS
+static long long probe_suppliers(void* ctx) { return ((SuppliersDB*)ctx)->count; }
+#endif
 
-void suppliers_destroy(SuppliersDB* db) { if (!db) return; avl_free(db->root); free(db); }
+SuppliersDB* suppliers_create(void) {
+	SuppliersDB* db = (SuppliersDB*)calloc(1, sizeof(SuppliersDB));
+	if (db && !rh_index_init(&db->index, SUPPLIER_INDEX_INITIAL)) { free(db); return NULL; }
+	if (db) METRIC_WATCH(METRIC_GAUGE_SUPPLIERS, probe_suppliers, db);
+	return db;
+}
+
+static void columns_free(RatingColumns* c) {
+	free(c->quality); free(c->deliveryTime); free(c->price); free(c->reliability);
+	free(c->customerService); free(c->score); free(c->id); free(c->node);
+}
 
-bool suppliers_insert(SuppliersDB* db, Supplier s) { if (!db) return false; db->root = avl_insert(db->root, s); return true; }
+void suppliers_destroy(SuppliersDB* db) { if (!db) return; METRIC_UNWATCH(db); avl_free(db->root); rh_index_free(&db->index); columns_free(&db->columns); free(db); }
+
+static bool grow_column(void** col, size_t elem, int capacity) {
+	void* p = realloc(*col, elem * (size_t)capacity);
+	if (p) *col = p;
+	return p != NULL;
+}
+
+static bool columns_reserve(RatingColumns* c, int count) {
+	if (count <= c->capacity) return true;
+	int capacity = c->capacity ? c->capacity * 2 : 256;
+	// Columns that did grow stay valid at the old size too
+	bool ok = grow_column((void**)&c->quality, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->deliveryTime, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->price, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->reliability, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->customerService, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->score, sizeof(double), capacity);
+	ok &= grow_column((void**)&c->id, sizeof(int), capacity);
+	ok &= grow_column((void**)&c->node, sizeof(AVLNode*), capacity);
+	if (ok) c->capacity = capacity;
+	return ok;
+}
+
+static void columns_set(RatingColumns* c, int row, AVLNode* n) {
+	const SupplierRatings* r = &n->supplier.ratings;
+	c->quality[row] = r->quality; c->deliveryTime[row] = r->deliveryTime; c->price[row] = r->price;
+	c->reliability[row] = r->reliability; c->customerService[row] = r->customerService;
+	c->score[row] = n->key; c->id[row] = n->supplier.id; c->node[row] = n; n->row = row;
+}
+
+static bool insert_supplier(SuppliersDB* db, Supplier s) {
+	// An existing id is replaced, like inventory_add_product. Its node is
+	// re-keyed in place, keeping its row and index slot, so a replacement
+	// needs no allocation and cannot fail halfway.
+	AVLNode* n = (AVLNode*)rh_index_find(&db->index, s.id);
+	if (n) {
+		db->root = avl_unlink(db->root, n->key, s.id);
+		n->supplier = s; n->key = supplier_overall_score(&s.ratings); n->height = 1; n->size = 1; n->left = n->right = NULL;
+		columns_set(&db->columns, n->row, n);
+		db->root = avl_insert(db->root, n); db->version++;
+		return true;
+	}
+	if (!columns_reserve(&db->columns, db->count + 1)) return false;
+	n = (AVLNode*)malloc(sizeof(AVLNode));
+	if (!n) return false;
+	n->supplier = s; n->key = supplier_overall_score(&s.ratings); n->height = 1; n->size = 1; n->left = n->right = NULL;
+	if (!rh_index_insert(&db->index, s.id, n)) { free(n); return false; }
+	columns_set(&db->columns, db->count, n);
+	db->root = avl_insert(db->root, n); db->count++; db->version++;
+	return true;
+}
+
+bool suppliers_insert(SuppliersDB* db, Supplier s) {
+	if (!db) return false;
+	METRIC_START(start);
+	bool ok = insert_supplier(db, s);
+	METRIC_STOP(METRIC_OP_SUPPLIER_INSERT, start);
+	return ok;
+}
+
+int suppliers_count(SuppliersDB* db) { return db ? db->count : 0; }
+
+unsigned long suppliers_version(SuppliersDB* db) { return db ? db->version : 0; }
+
+static void for_each_rec(AVLNode* n, SupplierVisitor visit, void* ctx) {
+	if (!n) return;
+	for_each_rec(n->left, visit, ctx);
+	visit(&n->supplier, ctx);
+	for_each_rec(n->right, visit, ctx);
+}
+
+void suppliers_for_each(SuppliersDB* db, SupplierVisitor visit, void* ctx) { if (db && visit) for_each_rec(db->root, visit, ctx); }
 
 static void inorder_desc(AVLNode* n) {
 	if (!n) return;
@@ -107,34 +241,259 @@ static void inorder_desc(AVLNode* n) {
 
 void suppliers_print_ranked(SuppliersDB* db) { printf("\n-- Suppliers Ranked (High to Low) --\n"); inorder_desc(db->root); }
 
-static void inorder_min(AVLNode* n, double minScore) {
-	if (!n) return;
-	if (n->key >= minScore) inorder_min(n->left, minScore);
-	if (n->key >= minScore) {
-		printf("ID:%d Name:%s Score:%.2f\n", n->supplier.id, n->supplier.name, n->key);
+void suppliers_print_min_rating(SuppliersDB* db, double minOverall) {
+	printf("\n-- Suppliers with overall >= %.2f --\n", minOverall);
+	SupplierRange it; const Supplier* s;
+	suppliers_range_begin(db, minOverall, DBL_MAX, &it);
+	while ((s = suppliers_range_next(&it)) != NULL) {
+		printf("ID:%d Name:%s Score:%.2f\n", s->id, s->name, supplier_overall_score(&s->ratings));
 	}
-	inorder_min(n->right, minScore);
 }
 
-void suppliers_print_min_rating(SuppliersDB* db, double minOverall) {
-	printf("\n-- Suppliers with overall >= %.2f --\n", minOverall);
-	inorder_min(db->root, minOverall);
+// Push the path to the best node that is still <= maxScore
+static void range_descend(SupplierRange* it, const AVLNode* n) {
+	while (n) {
+		if (n->key > it->maxScore) { n = n->left; continue; }
+		it->stack[it->depth++] = n; n = n->right;
+	}
 }
 
-static Supplier* find_by_id_rec(AVLNode* n, int id) {
-	if (!n) return NULL;
-	if (n->supplier.id == id) return &n->supplier;
-	Supplier* left = find_by_id_rec(n->left, id); if (left) return left;
-	return find_by_id_rec(n->right, id);
+void suppliers_range_begin(SuppliersDB* db, double minScore, double maxScore, SupplierRange* it) {
+	it->depth = 0; it->minScore = minScore; it->maxScore = maxScore;
+	if (db) range_descend(it, db->root);
 }
 
-Supplier* suppliers_find_by_id(SuppliersDB* db, int supplierId) { return find_by_id_rec(db->root, supplierId); }
+const Supplier* suppliers_range_next(SupplierRange* it) {
+	if (it->depth == 0) return NULL;
+	const AVLNode* n = it->stack[--it->depth];
+	// Everything left on the stack scores lower still
+	if (n->key < it->minScore) { it->depth = 0; return NULL; }
+	range_descend(it, n->left);
+	return &n->supplier;
+}
+
+int suppliers_top_k(SuppliersDB* db, int k, Supplier* out) {
+	METRIC_START(start);
+	SupplierRange it; const Supplier* s; int n = 0;
+	suppliers_range_begin(db, -DBL_MAX, DBL_MAX, &it);
+	while (n < k && (s = suppliers_range_next(&it)) != NULL) out[n++] = *s;
+	METRIC_STOP(METRIC_OP_SUPPLIER_TOP_K, start);
+	return n;
+}
+
+int suppliers_rank_of(SuppliersDB* db, int supplierId) {
+	AVLNode* target = db ? (AVLNode*)rh_index_find(&db->index, supplierId) : NULL;
+	if (!target) return 0;
+	// Count the nodes ordered after the target on the way down to it
+	int rank = 1;
+	for (AVLNode* n = db->root; n != target; ) {
+		if (node_before(target->key, supplierId, n)) { rank += size(n->right) + 1; n = n->left; }
+		else n = n->right;
+	}
+	return rank + size(target->right);
+}
+
+// Suppliers scoring below x (or at most x when inclusive)
+static int count_below(const AVLNode* n, double x, bool inclusive) {
+	int count = 0;
+	while (n) {
+		if (n->key < x || (inclusive && n->key == x)) { count += size(n->left) + 1; n = n->right; }
+		else n = n->left;
+	}
+	return count;
+}
+
+int suppliers_count_in_range(SuppliersDB* db, double minScore, double maxScore) {
+	if (!db || minScore > maxScore) return 0;
+	return count_below(db->root, maxScore, true) - count_below(db->root, minScore, false);
+}
+
+Supplier* suppliers_find_by_id(SuppliersDB* db, int supplierId) {
+	METRIC_START(start);
+	AVLNode* n = db ? (AVLNode*)rh_index_find(&db->index, supplierId) : NULL;
+	METRIC_INC(METRIC_SUPPLIER_LOOKUPS);
+	if (!n) METRIC_INC(METRIC_SUPPLIER_MISSES);
+	METRIC_STOP(METRIC_OP_SUPPLIER_FIND, start);
+	return n ? &n->supplier : NULL;
+}
+
+static bool delete_supplier(SuppliersDB* db, int supplierId) {
+	AVLNode* n = (AVLNode*)rh_index_find(&db->index, supplierId);
+	if (!n) return false;
+	rh_index_erase(&db->index, supplierId);
+	// Swap-remove the rating row
+	int last = db->count - 1;
+	if (n->row != last) columns_set(&db->columns, n->row, db->columns.node[last]);
+	db->root = avl_unlink(db->root, n->key, supplierId);
+	free(n);
+	db->count--; db->version++;
+	return true;
+}
 
 bool suppliers_delete(SuppliersDB* db, int supplierId) {
-	// Need the key; find node first
-	Supplier* s = suppliers_find_by_id(db, supplierId);
-	if (!s) return false;
-	double key = supplier_overall_score(&s->ratings);
-	db->root = avl_delete(db->root, key, supplierId);
+	if (!db) return false;
+	METRIC_START(start);
+	bool ok = delete_supplier(db, supplierId);
+	METRIC_STOP(METRIC_OP_SUPPLIER_DELETE, start);
+	return ok;
+}
+
+// Bulk rescoring kernels: score = weighted sum of the rating columns, in
+// the same operation order as supplier_overall_score
+typedef void (*RescoreKernel)(const RatingColumns* c, int count, const ScoreWeights* w);
+
+static void rescore_scalar(const RatingColumns* c, int count, const ScoreWeights* w) {
+	for (int i = 0; i < count; i++) {
+		c->score[i] = c->quality[i] * w->quality + c->reliability[i] * w->reliability +
+		              c->deliveryTime[i] * w->deliveryTime + c->price[i] * w->price +
+		              c->customerService[i] * w->customerService;
+	}
+}
+
+#ifdef SUPPLIERS_X86
+// 4 suppliers per step; the ragged tail goes through the scalar kernel
+__attribute__((target("avx2")))
+static void rescore_avx2(const RatingColumns* c, int count, const ScoreWeights* w) {
+	__m256d wq = _mm256_set1_pd(w->quality), wr = _mm256_set1_pd(w->reliability);
+	__m256d wd = _mm256_set1_pd(w->deliveryTime), wp = _mm256_set1_pd(w->price);
+	__m256d ws = _mm256_set1_pd(w->customerService);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d sum = _mm256_mul_pd(_mm256_loadu_pd(c->quality + i), wq);
+		sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(c->reliability + i), wr));
+		sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(c->deliveryTime + i), wd));
+		sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(c->price + i), wp));
+		sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(c->customerService + i), ws));
+		_mm256_storeu_pd(c->score + i, sum);
+	}
+	RatingColumns tail = *c;
+	tail.quality += i; tail.deliveryTime += i; tail.price += i; tail.reliability += i;
+	tail.customerService += i; tail.score += i;
+	rescore_scalar(&tail, count - i, w);
+}
+
+// 2 suppliers per step
+__attribute__((target("sse2")))
+static void rescore_sse2(const RatingColumns* c, int count, const ScoreWeights* w) {
+	__m128d wq = _mm_set1_pd(w->quality), wr = _mm_set1_pd(w->reliability);
+	__m128d wd = _mm_set1_pd(w->deliveryTime), wp = _mm_set1_pd(w->price);
+	__m128d ws = _mm_set1_pd(w->customerService);
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d sum = _mm_mul_pd(_mm_loadu_pd(c->quality + i), wq);
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(c->reliability + i), wr));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(c->deliveryTime + i), wd));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(c->price + i), wp));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(c->customerService + i), ws));
+		_mm_storeu_pd(c->score + i, sum);
+	}
+	RatingColumns tail = *c;
+	tail.quality += i; tail.deliveryTime += i; tail.price += i; tail.reliability += i;
+	tail.customerService += i; tail.score += i;
+	rescore_scalar(&tail, count - i, w);
+}
+#endif
+
+static RescoreKernel select_rescore(void) {
+#ifdef SUPPLIERS_X86
+	if (__builtin_cpu_supports("avx2")) return rescore_avx2;
+	if (__builtin_cpu_supports("sse2")) return rescore_sse2;
+#endif
+	return rescore_scalar;
+}
+
+// Sort entry: score mapped to an unsigned key that orders like the double
+typedef struct RankEntry {
+	uint64_t score;
+	uint32_t id;     // Sign bit flipped so ids order as unsigned
+	int row;
+} RankEntry;
+
+static uint64_t score_bits(double score) {
+	if (score == 0) score = 0; // -0.0 compares equal to 0.0, so key it the same
+	uint64_t bits; memcpy(&bits, &score, sizeof(bits));
+	return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+}
+
+static unsigned radix_digit(const RankEntry* e, int pass) {
+	bool onScore = pass >= SUPPLIER_ID_PASSES;
+	int shift = (onScore ? pass - SUPPLIER_ID_PASSES : pass) * SUPPLIER_RADIX_BITS;
+	return (unsigned)((onScore ? e->score : e->id) >> shift) & (SUPPLIER_RADIX - 1);
+}
+
+// LSD radix sort, id digits first and then score digits, so entries end
+// up by score with ties in id order like the tree. Every digit's histogram
+// comes from one read pass; digits that are the same everywhere (such as
+// the exponent bits of scores in a narrow range) cost nothing. Returns
+// whichever buffer holds the result.
+static RankEntry* radix_sort(RankEntry* entries, RankEntry* scratch, int n, size_t (*counts)[SUPPLIER_RADIX]) {
+	enum { PASSES = SUPPLIER_ID_PASSES + SUPPLIER_SCORE_PASSES };
+	memset(counts, 0, sizeof(size_t) * SUPPLIER_RADIX * PASSES);
+	for (int i = 0; i < n; i++) {
+		for (int pass = 0; pass < PASSES; pass++) counts[pass][radix_digit(&entries[i], pass)]++;
+	}
+	for (int pass = 0; pass < PASSES; pass++) {
+		size_t* c = counts[pass];
+		if (n == 0 || c[radix_digit(&entries[0], pass)] == (size_t)n) continue;
+		size_t sum = 0;
+		for (int d = 0; d < SUPPLIER_RADIX; d++) { size_t k = c[d]; c[d] = sum; sum += k; }
+		for (int i = 0; i < n; i++) scratch[c[radix_digit(&entries[i], pass)]++] = entries[i];
+		RankEntry* t = entries; entries = scratch; scratch = t;
+	}
+	return entries;
+}
+
+// Perfectly balanced tree over nodes[lo..hi], already in tree order,
+// picking up each node's new key on the way
+static AVLNode* build_balanced(AVLNode** nodes, const double* score, int lo, int hi) {
+	if (lo > hi) return NULL;
+	int mid = lo + (hi - lo) / 2;
+	AVLNode* n = nodes[mid];
+	n->key = score[n->row];
+	n->left = build_balanced(nodes, score, lo, mid - 1);
+	n->right = build_balanced(nodes, score, mid + 1, hi);
+	n->height = 1 + max(height(n->left), height(n->right));
+	n->size = 1 + size(n->left) + size(n->right);
+	return n;
+}
+
+static bool set_weights(SuppliersDB* db, const ScoreWeights* w) {
+	double sum = w->quality + w->deliveryTime + w->price + w->reliability + w->customerService;
+	if (!(w->quality >= 0 && w->deliveryTime >= 0 && w->price >= 0 && w->reliability >= 0 &&
+	      w->customerService >= 0 && sum > 0)) return false;
+	ScoreWeights norm = { w->quality / sum, w->deliveryTime / sum, w->price / sum,
+	                      w->reliability / sum, w->customerService / sum };
+
+	int n = db->count;
+	RankEntry* entries = (RankEntry*)malloc(sizeof(RankEntry) * (size_t)(n ? n : 1));
+	RankEntry* scratch = (RankEntry*)malloc(sizeof(RankEntry) * (size_t)(n ? n : 1));
+	size_t (*counts)[SUPPLIER_RADIX] = malloc(sizeof(size_t) * SUPPLIER_RADIX * (SUPPLIER_ID_PASSES + SUPPLIER_SCORE_PASSES));
+	AVLNode** order = (AVLNode**)malloc(sizeof(AVLNode*) * (size_t)(n ? n : 1));
+	if (!entries || !scratch || !counts || !order) {
+		free(entries); free(scratch); free(counts); free(order);
+		return false;
+	}
+
+	score_weights_set(&norm);
+	RatingColumns* c = &db->columns;
+	select_rescore()(c, n, &norm);
+	for (int i = 0; i < n; i++) {
+		entries[i].score = score_bits(c->score[i]);
+		entries[i].id = (uint32_t)c->id[i] ^ 0x80000000u;
+		entries[i].row = i;
+	}
+	RankEntry* sorted = radix_sort(entries, scratch, n, counts);
+	for (int i = 0; i < n; i++) order[i] = c->node[sorted[i].row];
+	db->root = build_balanced(order, c->score, 0, n - 1);
+
+	free(entries); free(scratch); free(counts); free(order);
 	return true;
 }
+
+bool suppliers_set_weights(SuppliersDB* db, const ScoreWeights* w) {
+	if (!db || !w) return false;
+	METRIC_START(start);
+	bool ok = set_weights(db, w);
+	METRIC_STOP(METRIC_OP_SET_WEIGHTS, start);
+	return ok;
+}
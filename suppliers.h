@@ -12,6 +12,40 @@ void suppliers_destroy(SuppliersDB* db);
 bool suppliers_insert(SuppliersDB* db, Supplier s);
 bool suppliers_delete(SuppliersDB* db, int supplierId);
 Supplier* suppliers_find_by_id(SuppliersDB* db, int supplierId);
+int suppliers_count(SuppliersDB* db);
+// Changes whenever a supplier is inserted, replaced or deleted
+unsigned long suppliers_version(SuppliersDB* db);
+
+// Visit suppliers in ascending score order
+typedef void (*SupplierVisitor)(const Supplier* s, void* ctx);
+void suppliers_for_each(SuppliersDB* db, SupplierVisitor visit, void* ctx);
+
+// Rescore every supplier under new weights (normalized to sum to 1) and
+// rebuild the tree perfectly balanced in O(n) after a radix sort. Returns
+// false, changing nothing, if a weight is negative or all are zero.
+bool suppliers_set_weights(SuppliersDB* db, const ScoreWeights* w);
+
+// Ranked queries, highest score first (ties by descending id). The tree
+// keeps subtree sizes, so each costs O(log n + k).
+// Copy up to k of the best suppliers into out; returns how many
+int suppliers_top_k(SuppliersDB* db, int k, Supplier* out);
+// 1-based position in the ranking, 0 if the supplier is unknown
+int suppliers_rank_of(SuppliersDB* db, int supplierId);
+// Number of suppliers scoring within [minScore, maxScore]
+int suppliers_count_in_range(SuppliersDB* db, double minScore, double maxScore);
+
+// Iterator over suppliers scoring within [minScore, maxScore], best first.
+// The tree must not change while it is in use.
+#define SUPPLIER_MAX_DEPTH 64 // Far above any AVL height that fits in memory
+typedef struct SupplierRange {
+	const struct AVLNode* stack[SUPPLIER_MAX_DEPTH];
+	int depth;
+	double minScore;
+	double maxScore;
+} SupplierRange;
+void suppliers_range_begin(SuppliersDB* db, double minScore, double maxScore, SupplierRange* it);
+// Next supplier in the range, or NULL when done
+const Supplier* suppliers_range_next(SupplierRange* it);
 
 // Display suppliers sorted by overall rating (descending)
 void suppliers_print_ranked(SuppliersDB* db);
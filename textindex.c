@@ -0,0 +1,756 @@
+#include "textindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_MAX (MAX_NAME_LEN - 1)
+#define GRAM_INITIAL_CAPACITY 1024
+// Pending posting updates are merged into the compressed list once they
+// outnumber an eighth of it, within these bounds
+#define POSTING_PENDING_MIN 16
+#define POSTING_PENDING_MAX 4096
+#define VARINT_MAX_BYTES 10
+// Every this many encoded ids a skip entry lets seeks jump ahead
+#define POSTING_SKIP_STRIDE 64
+
+// Radix tree node; the root has an empty label
+struct TrieNode {
+    TrieNode** children;   // Sorted by first label byte
+    unsigned char* keys;   // First label byte of each child, in the same block
+    int childCount;
+    int childCapacity;
+    ProductId one;         // Sole id while more is NULL
+    ProductId* more;       // Ascending ids once a second text ends here
+    int idCount;
+    int idCapacity;
+    int labelLen;
+    char label[];          // Folded edge label from the parent
+};
+
+// Encoded id number k * POSTING_SKIP_STRIDE and where the next one starts
+typedef struct PostingSkip {
+    ProductId id;
+    size_t offset;
+} PostingSkip;
+
+// Ids of one trigram: ascending varint deltas plus small sorted buffers of
+// the adds and removes not merged in yet
+struct PostingList {
+    uint32_t gram;  // Three folded bytes; 0 marks an empty slot
+    unsigned char* data;
+    size_t bytes;
+    size_t dataCapacity;
+    int count;       // Ids encoded in data
+    ProductId last;  // Largest of them
+    PostingSkip* skips;
+    int skipCount;
+    int skipCapacity;
+    ProductId* adds;
+    int addCount;
+    int addCapacity;
+    ProductId* removes;
+    int removeCount;
+    int removeCapacity;
+};
+
+static char fold_char(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static int text_fold(char* dst, const char* src) {
+    int len = 0;
+    while (len < TEXT_MAX && src[len]) {
+        dst[len] = fold_char(src[len]);
+        len++;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+bool text_starts_with(const char* text, const char* prefix) {
+    for (; *prefix; text++, prefix++) {
+        if (fold_char(*text) != fold_char(*prefix)) return false;
+    }
+    return true;
+}
+
+bool text_contains(const char* text, const char* query) {
+    if (!*query) return true;
+    for (; *text; text++) {
+        if (text_starts_with(text, query)) return true;
+    }
+    return false;
+}
+
+// Distinct trigrams of a folded text. A 64-bit filter of the grams seen
+// so far leaves the duplicate scan to the rare collisions.
+static int text_grams(const char* folded, int len, uint32_t* grams) {
+    int n = 0;
+    uint64_t seen = 0;
+    for (int i = 0; i + 3 <= len; i++) {
+        uint32_t gram = (uint32_t)(unsigned char)folded[i] << 16 |
+                        (uint32_t)(unsigned char)folded[i + 1] << 8 |
+                        (uint32_t)(unsigned char)folded[i + 2];
+        uint64_t bit = 1ULL << ((gram * 0x9E3779B1u) >> 26);
+        if (seen & bit) {
+            int j = 0;
+            while (j < n && grams[j] != gram) j++;
+            if (j < n) continue;
+        }
+        seen |= bit;
+        grams[n++] = gram;
+    }
+    return n;
+}
+
+// Sorted id arrays
+static int ids_lower_bound(const ProductId* ids, int count, ProductId id) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ids[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static bool ids_insert(ProductId** ids, int* count, int* capacity, ProductId id) {
+    int i = ids_lower_bound(*ids, *count, id);
+    if (i < *count && (*ids)[i] == id) return true;
+    if (*count == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 4;
+        ProductId* resized = (ProductId*)realloc(*ids, sizeof(ProductId) * (size_t)grown);
+        if (!resized) return false;
+        *ids = resized;
+        *capacity = grown;
+    }
+    memmove(&(*ids)[i + 1], &(*ids)[i], sizeof(ProductId) * (size_t)(*count - i));
+    (*ids)[i] = id;
+    (*count)++;
+    return true;
+}
+
+static bool ids_erase(ProductId* ids, int* count, ProductId id) {
+    int i = ids_lower_bound(ids, *count, id);
+    if (i == *count || ids[i] != id) return false;
+    memmove(&ids[i], &ids[i + 1], sizeof(ProductId) * (size_t)(*count - i - 1));
+    (*count)--;
+    return true;
+}
+
+// Compressed trie
+
+static TrieNode* trie_node_new(const char* label, int len) {
+    TrieNode* node = (TrieNode*)calloc(1, sizeof(TrieNode) + (size_t)len + 1);
+    if (!node) return NULL;
+    memcpy(node->label, label, (size_t)len);
+    node->label[len] = '\0';
+    node->labelLen = len;
+    return node;
+}
+
+static void trie_node_free(TrieNode* node) {
+    if (!node) return;
+    for (int i = 0; i < node->childCount; i++) trie_node_free(node->children[i]);
+    free(node->children);
+    free(node->more);
+    free(node);
+}
+
+// First child whose label starts at or after byte c
+static int trie_child_pos(const TrieNode* node, char c) {
+    int i = 0;
+    while (i < node->childCount && node->keys[i] < (unsigned char)c) i++;
+    return i;
+}
+
+static TrieNode* trie_child(const TrieNode* node, char c, int* pos) {
+    int i = trie_child_pos(node, c);
+    if (pos) *pos = i;
+    return i < node->childCount && node->keys[i] == (unsigned char)c ? node->children[i] : NULL;
+}
+
+static bool trie_insert_child(TrieNode* node, int pos, TrieNode* child) {
+    if (node->childCount == node->childCapacity) {
+        // Child pointers and their first bytes share one block
+        int capacity = node->childCapacity ? node->childCapacity * 2 : 2;
+        TrieNode** children = (TrieNode**)malloc((sizeof(TrieNode*) + 1) * (size_t)capacity);
+        if (!children) return false;
+        unsigned char* keys = (unsigned char*)(children + capacity);
+        if (node->childCount) {
+            memcpy(children, node->children, sizeof(TrieNode*) * (size_t)node->childCount);
+            memcpy(keys, node->keys, (size_t)node->childCount);
+        }
+        free(node->children);
+        node->children = children;
+        node->keys = keys;
+        node->childCapacity = capacity;
+    }
+    int after = node->childCount - pos;
+    memmove(&node->children[pos + 1], &node->children[pos], sizeof(TrieNode*) * (size_t)after);
+    memmove(&node->keys[pos + 1], &node->keys[pos], (size_t)after);
+    node->children[pos] = child;
+    node->keys[pos] = (unsigned char)child->label[0];
+    node->childCount++;
+    return true;
+}
+
+static void trie_erase_child(TrieNode* node, int pos) {
+    int after = node->childCount - pos - 1;
+    memmove(&node->children[pos], &node->children[pos + 1], sizeof(TrieNode*) * (size_t)after);
+    memmove(&node->keys[pos], &node->keys[pos + 1], (size_t)after);
+    node->childCount--;
+}
+
+static bool trie_node_add_id(TrieNode* node, ProductId id) {
+    if (!node->more) {
+        if (node->idCount == 0) {
+            node->one = id;
+            node->idCount = 1;
+            return true;
+        }
+        if (node->one == id) return true;
+        node->more = (ProductId*)malloc(sizeof(ProductId) * 4);
+        if (!node->more) return false;
+        node->more[0] = node->one;
+        node->idCapacity = 4;
+    }
+    return ids_insert(&node->more, &node->idCount, &node->idCapacity, id);
+}
+
+static bool trie_node_remove_id(TrieNode* node, ProductId id) {
+    if (node->more) return ids_erase(node->more, &node->idCount, id);
+    if (node->idCount == 0 || node->one != id) return false;
+    node->idCount = 0;
+    return true;
+}
+
+static bool trie_add(TextIndex* ti, const char* key, int len, ProductId id) {
+    if (!ti->root && !(ti->root = trie_node_new("", 0))) return false;
+
+    TrieNode* node = ti->root;
+    int pos = 0;
+    while (pos < len) {
+        int i;
+        TrieNode* child = trie_child(node, key[pos], &i);
+        if (!child) {
+            TrieNode* leaf = trie_node_new(key + pos, len - pos);
+            if (!leaf || !trie_insert_child(node, i, leaf)) {
+                free(leaf);
+                return false;
+            }
+            node = leaf;
+            break;
+        }
+        int common = 1;
+        while (common < child->labelLen && pos + common < len &&
+               child->label[common] == key[pos + common]) {
+            common++;
+        }
+        if (common < child->labelLen) {
+            // Split the edge; a new node takes the shared part of the label
+            // and the child keeps the rest in place
+            TrieNode* mid = trie_node_new(child->label, common);
+            if (!mid) return false;
+            memmove(child->label, child->label + common, (size_t)(child->labelLen - common) + 1);
+            child->labelLen -= common;
+            if (!trie_insert_child(mid, 0, child)) {
+                memmove(child->label + common, child->label, (size_t)child->labelLen + 1);
+                memcpy(child->label, mid->label, (size_t)common);
+                child->labelLen += common;
+                free(mid);
+                return false;
+            }
+            node->children[i] = mid;
+            child = mid;
+        }
+        node = child;
+        pos += common;
+    }
+    return trie_node_add_id(node, id);
+}
+
+static void trie_remove(TextIndex* ti, const char* key, int len, ProductId id) {
+    TrieNode* path[MAX_NAME_LEN];
+    int slot[MAX_NAME_LEN];
+    int depth = 0;
+    TrieNode* node = ti->root;
+    if (!node) return;
+
+    int pos = 0;
+    while (pos < len) {
+        int i;
+        TrieNode* child = trie_child(node, key[pos], &i);
+        if (!child || child->labelLen > len - pos ||
+            memcmp(child->label, key + pos, (size_t)child->labelLen) != 0) {
+            return;
+        }
+        path[depth] = node;
+        slot[depth] = i;
+        depth++;
+        node = child;
+        pos += child->labelLen;
+    }
+    if (!trie_node_remove_id(node, id)) return;
+
+    // Drop emptied leaves and fold id-less single-child nodes into their
+    // child so every inner node keeps branching
+    while (depth > 0 && node->idCount == 0) {
+        TrieNode* parent = path[depth - 1];
+        int i = slot[depth - 1];
+        if (node->childCount == 0) {
+            trie_erase_child(parent, i);
+            trie_node_free(node);
+            node = parent;
+            depth--;
+            continue;
+        }
+        if (node->childCount == 1) {
+            TrieNode* child = node->children[0];
+            int labelLen = node->labelLen + child->labelLen;
+            TrieNode* merged = (TrieNode*)realloc(child, sizeof(TrieNode) + (size_t)labelLen + 1);
+            if (!merged) break;
+            memmove(merged->label + node->labelLen, merged->label, (size_t)merged->labelLen + 1);
+            memcpy(merged->label, node->label, (size_t)node->labelLen);
+            merged->labelLen = labelLen;
+            parent->children[i] = merged;
+            node->childCount = 0;
+            trie_node_free(node);
+        }
+        break;
+    }
+}
+
+static bool trie_walk(const TrieNode* node, TextVisitor visit, void* ctx) {
+    const ProductId* ids = node->more ? node->more : &node->one;
+    for (int i = 0; i < node->idCount; i++) {
+        if (!visit(ids[i], ctx)) return false;
+    }
+    for (int i = 0; i < node->childCount; i++) {
+        if (!trie_walk(node->children[i], visit, ctx)) return false;
+    }
+    return true;
+}
+
+// Posting lists
+
+static size_t varint_put(unsigned char* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+static const unsigned char* varint_get(const unsigned char* in, uint64_t* v) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= (uint64_t)(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    *v = value | (uint64_t)*in++ << shift;
+    return in;
+}
+
+// Append an id above every encoded one; deltas are taken modulo 2^64 so
+// negative ids encode too
+static bool posting_append(PostingList* list, ProductId id) {
+    if (list->bytes + VARINT_MAX_BYTES > list->dataCapacity) {
+        size_t capacity = list->dataCapacity ? list->dataCapacity * 2 : 16;
+        unsigned char* data = (unsigned char*)realloc(list->data, capacity);
+        if (!data) return false;
+        list->data = data;
+        list->dataCapacity = capacity;
+    }
+    if (list->count % POSTING_SKIP_STRIDE == 0 && list->skipCount == list->skipCapacity) {
+        int capacity = list->skipCapacity ? list->skipCapacity * 2 : 4;
+        PostingSkip* skips = (PostingSkip*)realloc(list->skips, sizeof(PostingSkip) * (size_t)capacity);
+        if (!skips) return false;
+        list->skips = skips;
+        list->skipCapacity = capacity;
+    }
+    uint64_t delta = list->count ? (uint64_t)id - (uint64_t)list->last : (uint64_t)id;
+    list->bytes += varint_put(list->data + list->bytes, delta);
+    if (list->count % POSTING_SKIP_STRIDE == 0) {
+        list->skips[list->skipCount].id = id;
+        list->skips[list->skipCount].offset = list->bytes;
+        list->skipCount++;
+    }
+    list->last = id;
+    list->count++;
+    return true;
+}
+
+// Ascending walk over the merged view: data plus adds minus removes
+typedef struct PostingCursor {
+    const PostingList* list;
+    const unsigned char* in;
+    int left;          // Encoded ids not decoded yet
+    uint64_t decoded;  // Last decoded id
+    bool held;         // decoded is not delivered yet
+    int add;
+    int remove;
+    ProductId id;      // Current id, valid until done
+    bool done;
+} PostingCursor;
+
+static void cursor_next(PostingCursor* c) {
+    const PostingList* list = c->list;
+    for (;;) {
+        if (!c->held && c->left > 0) {
+            uint64_t delta;
+            c->in = varint_get(c->in, &delta);
+            c->decoded += delta;
+            c->left--;
+            c->held = true;
+        }
+        ProductId id = (ProductId)c->decoded;
+        if (c->add < list->addCount && (!c->held || list->adds[c->add] < id)) {
+            c->id = list->adds[c->add++];
+            return;
+        }
+        if (!c->held) {
+            c->done = true;
+            return;
+        }
+        c->held = false;
+        while (c->remove < list->removeCount && list->removes[c->remove] < id) c->remove++;
+        if (c->remove < list->removeCount && list->removes[c->remove] == id) continue;
+        c->id = id;
+        return;
+    }
+}
+
+static void cursor_begin(PostingCursor* c, const PostingList* list) {
+    memset(c, 0, sizeof(PostingCursor));
+    c->list = list;
+    c->in = list->data;
+    c->left = list->count;
+    cursor_next(c);
+}
+
+// Advance to the first id >= target
+static void cursor_seek(PostingCursor* c, ProductId target) {
+    if (c->done || c->id >= target) return;
+    // Jump to the last skip entry below target that lies ahead; the ids
+    // passed over (the held one included) are all below target
+    const PostingList* list = c->list;
+    int decoded = list->count - c->left;
+    int lo = (decoded + POSTING_SKIP_STRIDE - 1) / POSTING_SKIP_STRIDE, hi = list->skipCount;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (list->skips[mid].id < target) lo = mid + 1;
+        else hi = mid;
+    }
+    int k = lo - 1;
+    if (k >= 0 && k * POSTING_SKIP_STRIDE >= decoded) {
+        c->in = list->data + list->skips[k].offset;
+        c->decoded = (uint64_t)list->skips[k].id;
+        c->left = list->count - k * POSTING_SKIP_STRIDE - 1;
+        c->held = false;
+    }
+    while (!c->done && c->id < target) cursor_next(c);
+}
+
+static bool posting_walk(const PostingList* list, TextVisitor visit, void* ctx) {
+    PostingCursor c;
+    for (cursor_begin(&c, list); !c.done; cursor_next(&c)) {
+        if (!visit(c.id, ctx)) return false;
+    }
+    return true;
+}
+
+static bool posting_collect(ProductId id, void* ctx) {
+    return posting_append((PostingList*)ctx, id);
+}
+
+// Re-encode the merged view and clear the pending buffers
+static void posting_compact(PostingList* list) {
+    PostingList merged = {0};
+    merged.dataCapacity = list->bytes + (size_t)list->addCount * VARINT_MAX_BYTES + VARINT_MAX_BYTES;
+    merged.data = (unsigned char*)malloc(merged.dataCapacity);
+    if (!merged.data) return;
+    if (!posting_walk(list, posting_collect, &merged)) {
+        free(merged.data);
+        free(merged.skips);
+        return;
+    }
+
+    free(list->data);
+    free(list->skips);
+    list->data = merged.data;
+    list->bytes = merged.bytes;
+    list->dataCapacity = merged.dataCapacity;
+    list->skips = merged.skips;
+    list->skipCount = merged.skipCount;
+    list->skipCapacity = merged.skipCapacity;
+    list->count = merged.count;
+    list->last = merged.last;
+    list->addCount = 0;
+    list->removeCount = 0;
+}
+
+static void posting_maybe_compact(PostingList* list) {
+    int limit = list->count / 8;
+    if (limit < POSTING_PENDING_MIN) limit = POSTING_PENDING_MIN;
+    if (limit > POSTING_PENDING_MAX) limit = POSTING_PENDING_MAX;
+    if (list->addCount + list->removeCount > limit) posting_compact(list);
+}
+
+static bool posting_add(PostingList* list, ProductId id) {
+    if (ids_erase(list->removes, &list->removeCount, id)) return true;
+    // Ascending inserts (bulk loads, fresh ids) go straight to the tail
+    if (!list->addCount && !list->removeCount && (!list->count || id > list->last)) {
+        return posting_append(list, id);
+    }
+    if (!ids_insert(&list->adds, &list->addCount, &list->addCapacity, id)) return false;
+    posting_maybe_compact(list);
+    return true;
+}
+
+static void posting_remove(PostingList* list, ProductId id) {
+    if (ids_erase(list->adds, &list->addCount, id)) return;
+    // If this fails the id stays listed; callers verify candidates anyway
+    if (!ids_insert(&list->removes, &list->removeCount, &list->removeCapacity, id)) return;
+    posting_maybe_compact(list);
+}
+
+static int posting_size(const PostingList* list) {
+    return list->count + list->addCount - list->removeCount;
+}
+
+// Trigram hash (linear probing; lists are never deleted, only emptied)
+
+static PostingList* gram_slot(PostingList* lists, size_t capacity, int shift, uint32_t gram) {
+    size_t mask = capacity - 1;
+    size_t i = (size_t)(((uint64_t)gram * 0x9E3779B97F4A7C15ULL) >> shift);
+    while (lists[i].gram != 0 && lists[i].gram != gram) i = (i + 1) & mask;
+    return &lists[i];
+}
+
+static PostingList* gram_find(const TextIndex* ti, uint32_t gram) {
+    if (!ti->capacity) return NULL;
+    PostingList* list = gram_slot(ti->lists, ti->capacity, ti->shift, gram);
+    return list->gram ? list : NULL;
+}
+
+static PostingList* gram_get_or_add(TextIndex* ti, uint32_t gram) {
+    PostingList* list = gram_find(ti, gram);
+    if (list) return list;
+
+    // Keep load factor under 1/2
+    if ((ti->used + 1) * 2 > ti->capacity) {
+        size_t capacity = ti->capacity ? ti->capacity * 2 : GRAM_INITIAL_CAPACITY;
+        int shift = 64 - __builtin_ctzll(capacity);
+        PostingList* lists = (PostingList*)calloc(capacity, sizeof(PostingList));
+        if (!lists) return NULL;
+        for (size_t i = 0; i < ti->capacity; i++) {
+            if (ti->lists[i].gram) *gram_slot(lists, capacity, shift, ti->lists[i].gram) = ti->lists[i];
+        }
+        free(ti->lists);
+        ti->lists = lists;
+        ti->capacity = capacity;
+        ti->shift = shift;
+    }
+
+    list = gram_slot(ti->lists, ti->capacity, ti->shift, gram);
+    list->gram = gram;
+    ti->used++;
+    return list;
+}
+
+void text_index_free(TextIndex* ti) {
+    if (!ti) return;
+    trie_node_free(ti->root);
+    for (size_t i = 0; i < ti->capacity; i++) {
+        free(ti->lists[i].data);
+        free(ti->lists[i].skips);
+        free(ti->lists[i].adds);
+        free(ti->lists[i].removes);
+    }
+    free(ti->lists);
+    memset(ti, 0, sizeof(TextIndex));
+}
+
+static void postings_remove(TextIndex* ti, ProductId id, const uint32_t* grams, int count) {
+    for (int i = 0; i < count; i++) {
+        PostingList* list = gram_find(ti, grams[i]);
+        if (list) posting_remove(list, id);
+    }
+}
+
+// Lists id under every trigram of the text or, out of memory, under none
+static bool postings_add(TextIndex* ti, ProductId id, const char* folded, int len) {
+    uint32_t grams[MAX_NAME_LEN];
+    int count = text_grams(folded, len, grams);
+    for (int i = 0; i < count; i++) {
+        PostingList* list = gram_get_or_add(ti, grams[i]);
+        if (!list || !posting_add(list, id)) {
+            postings_remove(ti, id, grams, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool text_index_add(TextIndex* ti, ProductId id, const char* text) {
+    if (!ti || !text) return false;
+    char folded[MAX_NAME_LEN];
+    int len = text_fold(folded, text);
+    if (!postings_add(ti, id, folded, len)) return false;
+    if (!trie_add(ti, folded, len, id)) {
+        uint32_t grams[MAX_NAME_LEN];
+        postings_remove(ti, id, grams, text_grams(folded, len, grams));
+        return false;
+    }
+    return true;
+}
+
+// Folded text order, then id
+static int text_entry_cmp(const void* a, const void* b) {
+    const TextEntry* x = (const TextEntry*)a;
+    const TextEntry* y = (const TextEntry*)b;
+    for (int i = 0; i < TEXT_MAX; i++) {
+        unsigned char cx = (unsigned char)fold_char(x->text[i]);
+        unsigned char cy = (unsigned char)fold_char(y->text[i]);
+        if (cx != cy) return cx < cy ? -1 : 1;
+        if (!cx) break;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static unsigned char entry_char(const TextEntry* e, int depth) {
+    return depth < TEXT_MAX ? (unsigned char)fold_char(e->text[depth]) : 0;
+}
+
+static void swap_entries(TextEntry* a, TextEntry* b) {
+    TextEntry t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Multikey quicksort (three-way radix quicksort) on folded bytes; entries
+// agree on their first depth bytes
+static void sort_entries(TextEntry* a, int n, int depth) {
+    while (n > 1) {
+        if (n < 16) {
+            for (int i = 1; i < n; i++) {
+                for (int j = i; j > 0 && text_entry_cmp(&a[j - 1], &a[j]) > 0; j--) {
+                    swap_entries(&a[j - 1], &a[j]);
+                }
+            }
+            return;
+        }
+        swap_entries(&a[0], &a[n / 2]);
+        int pivot = entry_char(&a[0], depth);
+        int lt = 0, i = 0, gt = n - 1;
+        while (i <= gt) {
+            int c = entry_char(&a[i], depth);
+            if (c < pivot) swap_entries(&a[lt++], &a[i++]);
+            else if (c > pivot) swap_entries(&a[i], &a[gt--]);
+            else i++;
+        }
+        sort_entries(a, lt, depth);
+        sort_entries(a + gt + 1, n - gt - 1, depth);
+        // Texts that ended here are equal; their order does not matter
+        if (pivot == 0) return;
+        a += lt;
+        n = gt - lt + 1;
+        depth++;
+    }
+}
+
+bool text_index_add_all(TextIndex* ti, TextEntry* entries, int count) {
+    if (!ti || count < 0 || (count && !entries)) return false;
+    char folded[MAX_NAME_LEN];
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        int len = text_fold(folded, entries[i].text);
+        if (!postings_add(ti, entries[i].id, folded, len)) ok = false;
+    }
+    // In text order consecutive inserts share most of their trie path
+    sort_entries(entries, count, 0);
+    for (int i = 0; i < count; i++) {
+        int len = text_fold(folded, entries[i].text);
+        if (!trie_add(ti, folded, len, entries[i].id)) ok = false;
+    }
+    return ok;
+}
+
+void text_index_remove(TextIndex* ti, ProductId id, const char* text) {
+    if (!ti || !text) return;
+    char folded[MAX_NAME_LEN];
+    int len = text_fold(folded, text);
+    trie_remove(ti, folded, len, id);
+
+    uint32_t grams[MAX_NAME_LEN];
+    postings_remove(ti, id, grams, text_grams(folded, len, grams));
+}
+
+void text_index_prefix(const TextIndex* ti, const char* prefix, TextVisitor visit, void* ctx) {
+    if (!ti || !ti->root || !prefix || !visit) return;
+    // Nothing indexed is longer than TEXT_MAX
+    if (strlen(prefix) > TEXT_MAX) return;
+    char folded[MAX_NAME_LEN];
+    int len = text_fold(folded, prefix);
+
+    const TrieNode* node = ti->root;
+    int pos = 0;
+    while (pos < len) {
+        const TrieNode* child = trie_child(node, folded[pos], NULL);
+        if (!child) return;
+        // The prefix may end partway along an edge
+        int n = child->labelLen < len - pos ? child->labelLen : len - pos;
+        if (memcmp(child->label, folded + pos, (size_t)n) != 0) return;
+        node = child;
+        pos += n;
+    }
+    trie_walk(node, visit, ctx);
+}
+
+bool text_index_candidates(const TextIndex* ti, const char* query, TextVisitor visit, void* ctx) {
+    if (!ti || !query || !visit) return false;
+    size_t length = strlen(query);
+    if (length < 3) return false;
+    if (length > TEXT_MAX) return true;
+    char folded[MAX_NAME_LEN];
+    int len = text_fold(folded, query);
+
+    uint32_t grams[MAX_NAME_LEN];
+    int count = text_grams(folded, len, grams);
+    const PostingList* lists[MAX_NAME_LEN];
+    for (int i = 0; i < count; i++) {
+        const PostingList* list = gram_find(ti, grams[i]);
+        if (!list) return true;
+        // Rarest first: it drives the join and the rest only seek
+        int j = i;
+        while (j > 0 && posting_size(lists[j - 1]) > posting_size(list)) {
+            lists[j] = lists[j - 1];
+            j--;
+        }
+        lists[j] = list;
+    }
+
+    // Leapfrog join: every list seeks to the largest id seen until all agree
+    PostingCursor cursors[MAX_NAME_LEN];
+    for (int i = 0; i < count; i++) cursor_begin(&cursors[i], lists[i]);
+    while (!cursors[0].done) {
+        ProductId id = cursors[0].id;
+        bool agree = true;
+        for (int i = 1; i < count; i++) {
+            cursor_seek(&cursors[i], id);
+            if (cursors[i].done) return true;
+            if (cursors[i].id != id) {
+                cursor_seek(&cursors[0], cursors[i].id);
+                agree = false;
+                break;
+            }
+        }
+        if (!agree) continue;
+        if (!visit(id, ctx)) return true;
+        cursor_next(&cursors[0]);
+    }
+    return true;
+}
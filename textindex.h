@@ -0,0 +1,53 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "common.h"
+
+// Text index over product names, case-insensitive for ASCII. A compressed
+// trie (radix tree) answers prefix queries in name order; a trigram
+// inverted index with delta/varint-compressed posting lists narrows
+// substring queries down to candidates. Both are updated incrementally,
+// and a zeroed TextIndex is empty. Texts are indexed up to
+// MAX_NAME_LEN - 1 bytes.
+typedef struct TrieNode TrieNode;
+typedef struct PostingList PostingList;
+
+typedef struct TextIndex {
+    TrieNode* root;
+    PostingList* lists;  // Open-addressing hash by trigram
+    size_t capacity;     // Always a power of two
+    size_t used;
+    int shift;
+} TextIndex;
+
+// Return false to stop the walk
+typedef bool (*TextVisitor)(ProductId id, void* ctx);
+
+void text_index_free(TextIndex* ti);
+// False, with nothing added, if out of memory
+bool text_index_add(TextIndex* ti, ProductId id, const char* text);
+typedef struct TextEntry {
+    ProductId id;
+    const char* text;
+} TextEntry;
+// Batch add that sorts entries by text to fill the trie in order; pass
+// them in ascending id order so posting lists are appended to
+bool text_index_add_all(TextIndex* ti, TextEntry* entries, int count);
+// text must be the one id was added with
+void text_index_remove(TextIndex* ti, ProductId id, const char* text);
+
+// Ids whose text starts with prefix, in text order (ties by id)
+void text_index_prefix(const TextIndex* ti, const char* prefix, TextVisitor visit, void* ctx);
+// Ids, ascending, whose text holds every trigram of query: a superset of
+// the texts containing query, so callers verify with text_contains.
+// Returns false without visiting anything if query has no trigram.
+bool text_index_candidates(const TextIndex* ti, const char* query, TextVisitor visit, void* ctx);
+
+// Case-insensitive matching, as the index applies it
+bool text_starts_with(const char* text, const char* prefix);
+bool text_contains(const char* text, const char* query);
+
+#endif // TEXTINDEX_H
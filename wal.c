@@ -0,0 +1,597 @@
+#include "wal.h"
+#include "inventory.h"
+#include "orders.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WAL_MAGIC "SCMSWAL1"
+#define WAL_HEADER_SIZE 8
+#define WAL_BUFFER_SIZE (64 * 1024)
+// Record header: payload length, checksum, LSN, type
+#define WAL_RECORD_HEADER 17
+#define WAL_MAX_PAYLOAD 4096
+// Order items per record; longer orders continue in REC_ENQUEUE_ITEMS
+#define WAL_ORDER_ITEMS_PER_RECORD 256
+
+typedef enum {
+    REC_PUT_PRODUCT = 1,
+    REC_REMOVE_PRODUCT = 2,
+    REC_UPDATE_STOCK = 3,
+    REC_ENQUEUE_SHORT = 4,  // Older logs: u16 item count, all items inline
+    REC_DEQUEUE = 5,
+    REC_ENQUEUE = 6,
+    REC_ENQUEUE_ITEMS = 7,
+    REC_PROCESS = 8         // Dequeues and stock levels of one processing unit
+} WalRecordType;
+
+// REC_PROCESS payload: dequeue count and stock count, then the stocks
+#define WAL_PROCESS_HEADER 8
+#define WAL_PROCESS_STOCK 12
+
+// Order being reassembled from REC_ENQUEUE and its continuation records
+typedef struct WalPendingOrder {
+    Order order;
+    OrderItem* items;
+    int capacity;
+    int filled;
+    bool active;
+} WalPendingOrder;
+
+struct Wal {
+    int fd;
+    WalDurability durability;
+    int groupRecords;
+    int groupWindowMs;
+    
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t flusher;
+    bool hasFlusher;
+    bool closing;
+    
+    unsigned char* buffer;  // Records not yet written to the file
+    size_t used;
+    int unsynced;           // Records written or buffered since the last fsync
+    uint64_t lastLsn;
+    
+    // Open processing unit (see wal_begin_process); the stock entries
+    // follow WAL_PROCESS_HEADER reserved bytes
+    int unitDepth;
+    unsigned char* unit;
+    size_t unitUsed;
+    size_t unitCapacity;
+    int32_t unitDequeues;
+    int32_t unitStocks;
+};
+
+// Little-endian encoding helpers
+typedef struct WalEncoder {
+    unsigned char data[WAL_MAX_PAYLOAD];
+    size_t len;
+} WalEncoder;
+
+static void put_bytes(WalEncoder* e, const void* src, size_t n) {
+    memcpy(e->data + e->len, src, n);
+    e->len += n;
+}
+
+static void put_u8(WalEncoder* e, uint8_t v) { put_bytes(e, &v, 1); }
+static void put_i32(WalEncoder* e, int32_t v) { put_bytes(e, &v, sizeof(v)); }
+static void put_i64(WalEncoder* e, int64_t v) { put_bytes(e, &v, sizeof(v)); }
+static void put_f64(WalEncoder* e, double v) { put_bytes(e, &v, sizeof(v)); }
+
+static void put_str(WalEncoder* e, const char* s, size_t max) {
+    size_t n = strnlen(s, max - 1);
+    put_u8(e, (uint8_t)n);
+    put_bytes(e, s, n);
+}
+
+typedef struct WalDecoder {
+    const unsigned char* data;
+    size_t len;
+    size_t pos;
+    bool ok;
+} WalDecoder;
+
+static void get_bytes(WalDecoder* d, void* dst, size_t n) {
+    if (!d->ok || d->len - d->pos < n) {
+        d->ok = false;
+        memset(dst, 0, n);
+        return;
+    }
+    memcpy(dst, d->data + d->pos, n);
+    d->pos += n;
+}
+
+static uint8_t get_u8(WalDecoder* d) { uint8_t v; get_bytes(d, &v, 1); return v; }
+static uint16_t get_u16(WalDecoder* d) { uint16_t v; get_bytes(d, &v, sizeof(v)); return v; }
+static int32_t get_i32(WalDecoder* d) { int32_t v; get_bytes(d, &v, sizeof(v)); return v; }
+static int64_t get_i64(WalDecoder* d) { int64_t v; get_bytes(d, &v, sizeof(v)); return v; }
+static double get_f64(WalDecoder* d) { double v; get_bytes(d, &v, sizeof(v)); return v; }
+
+static void get_str(WalDecoder* d, char* dst, size_t max) {
+    size_t n = get_u8(d);
+    if (n >= max) d->ok = false;
+    if (!d->ok) {
+        dst[0] = '\0';
+        return;
+    }
+    get_bytes(d, dst, n);
+    dst[n] = '\0';
+}
+
+// FNV-1a over the LSN, type and payload; detects torn or corrupt records.
+// Start from WAL_CHECKSUM_SEED, or the running value to continue one.
+#define WAL_CHECKSUM_SEED 2166136261u
+static uint32_t record_checksum(uint32_t h, const unsigned char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += (size_t)n;
+    }
+    return true;
+}
+
+// Write out the buffer; caller holds the lock
+static bool wal_write_locked(Wal* wal) {
+    if (!write_all(wal->fd, wal->buffer, wal->used)) return false;
+    wal->used = 0;
+    return true;
+}
+
+static bool wal_sync_locked(Wal* wal) {
+    if (!wal_write_locked(wal)) return false;
+    if (wal->unsynced == 0) return true;
+    if (fdatasync(wal->fd) != 0) return false;
+    wal->unsynced = 0;
+    return true;
+}
+
+// Time-window half of group commit: sync whatever is pending every window
+static void* wal_flusher(void* arg) {
+    Wal* wal = (Wal*)arg;
+    pthread_mutex_lock(&wal->lock);
+    while (!wal->closing) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)wal->groupWindowMs * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&wal->wake, &wal->lock, &deadline);
+        if (wal->unsynced > 0) wal_sync_locked(wal);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return NULL;
+}
+
+bool wal_parse_durability(const char* name, WalDurability* out) {
+    if (strcmp(name, "none") == 0) *out = WAL_DURABILITY_NONE;
+    else if (strcmp(name, "group") == 0) *out = WAL_DURABILITY_GROUP;
+    else if (strcmp(name, "sync") == 0) *out = WAL_DURABILITY_SYNC;
+    else return false;
+    return true;
+}
+
+Wal* wal_open(const char* dir, WalDurability durability, int groupRecords, int groupWindowMs) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, WAL_FILE);
+    
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+    
+    // Stamp a fresh file; reject anything that is not ours
+    char magic[WAL_HEADER_SIZE];
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    if (n == 0) {
+        if (pwrite(fd, WAL_MAGIC, WAL_HEADER_SIZE, 0) != WAL_HEADER_SIZE || fsync(fd) != 0) {
+            close(fd);
+            return NULL;
+        }
+    } else if (n != WAL_HEADER_SIZE || memcmp(magic, WAL_MAGIC, WAL_HEADER_SIZE) != 0) {
+        fprintf(stderr, "Warning: %s is not a write-ahead log\n", path);
+        close(fd);
+        return NULL;
+    }
+    
+    Wal* wal = (Wal*)calloc(1, sizeof(Wal));
+    if (!wal) {
+        close(fd);
+        return NULL;
+    }
+    wal->buffer = (unsigned char*)malloc(WAL_BUFFER_SIZE);
+    if (!wal->buffer) {
+        free(wal);
+        close(fd);
+        return NULL;
+    }
+    wal->fd = fd;
+    wal->durability = durability;
+    wal->groupRecords = groupRecords > 0 ? groupRecords : WAL_GROUP_RECORDS;
+    wal->groupWindowMs = groupWindowMs > 0 ? groupWindowMs : WAL_GROUP_WINDOW_MS;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->wake, NULL);
+    lseek(fd, 0, SEEK_END);
+    
+    if (durability == WAL_DURABILITY_GROUP) {
+        wal->hasFlusher = pthread_create(&wal->flusher, NULL, wal_flusher, wal) == 0;
+    }
+    return wal;
+}
+
+void wal_close(Wal* wal) {
+    if (!wal) return;
+    
+    pthread_mutex_lock(&wal->lock);
+    wal->closing = true;
+    pthread_cond_signal(&wal->wake);
+    pthread_mutex_unlock(&wal->lock);
+    if (wal->hasFlusher) pthread_join(wal->flusher, NULL);
+    
+    wal_sync_locked(wal);
+    close(wal->fd);
+    pthread_cond_destroy(&wal->wake);
+    pthread_mutex_destroy(&wal->lock);
+    free(wal->buffer);
+    free(wal->unit);
+    free(wal);
+}
+
+// Records larger than the buffer bypass it
+static bool wal_append_locked(Wal* wal, WalRecordType type, const unsigned char* payload, size_t len) {
+    size_t size = WAL_RECORD_HEADER + len;
+    if (wal->used + size > WAL_BUFFER_SIZE && !wal_write_locked(wal)) return false;
+    
+    unsigned char header[WAL_RECORD_HEADER];
+    uint32_t len32 = (uint32_t)len;
+    uint64_t lsn = wal->lastLsn + 1;
+    memcpy(header, &len32, 4);
+    memcpy(header + 8, &lsn, 8);
+    header[16] = (unsigned char)type;
+    uint32_t sum = record_checksum(WAL_CHECKSUM_SEED, header + 8, WAL_RECORD_HEADER - 8);
+    sum = record_checksum(sum, payload, len);
+    memcpy(header + 4, &sum, 4);
+    
+    if (size <= WAL_BUFFER_SIZE) {
+        memcpy(wal->buffer + wal->used, header, WAL_RECORD_HEADER);
+        memcpy(wal->buffer + wal->used + WAL_RECORD_HEADER, payload, len);
+        wal->used += size;
+    } else if (!write_all(wal->fd, header, WAL_RECORD_HEADER) || !write_all(wal->fd, payload, len)) {
+        return false;
+    }
+    wal->lastLsn = lsn;
+    wal->unsynced++;
+    
+    // Count half of group commit; the flusher thread covers the window
+    if (wal->durability == WAL_DURABILITY_SYNC ||
+        (wal->durability == WAL_DURABILITY_GROUP && wal->unsynced >= wal->groupRecords)) {
+        return wal_sync_locked(wal);
+    }
+    return true;
+}
+
+// Log the open unit as one REC_PROCESS record and empty it
+static bool unit_flush_locked(Wal* wal) {
+    if (wal->unitDequeues == 0 && wal->unitStocks == 0) return true;
+    // A unit of dequeues alone may never have allocated its buffer
+    unsigned char header[WAL_PROCESS_HEADER];
+    unsigned char* payload = wal->unit ? wal->unit : header;
+    memcpy(payload, &wal->unitDequeues, 4);
+    memcpy(payload + 4, &wal->unitStocks, 4);
+    bool ok = wal_append_locked(wal, REC_PROCESS, payload, wal->unitUsed);
+    wal->unitUsed = WAL_PROCESS_HEADER;
+    wal->unitDequeues = wal->unitStocks = 0;
+    return ok;
+}
+
+// Fold a dequeue or stock record into the open unit. Out of memory, the
+// unit so far is logged on its own and the record follows it separately.
+static bool unit_add_locked(Wal* wal, WalRecordType type, const WalEncoder* payload) {
+    if (type == REC_DEQUEUE) {
+        wal->unitDequeues++;
+        return true;
+    }
+    if (wal->unitUsed + payload->len > wal->unitCapacity) {
+        size_t capacity = wal->unitCapacity ? wal->unitCapacity * 2 : 4096;
+        unsigned char* unit = (unsigned char*)realloc(wal->unit, capacity);
+        if (!unit) {
+            return unit_flush_locked(wal) && wal_append_locked(wal, type, payload->data, payload->len);
+        }
+        wal->unit = unit;
+        wal->unitCapacity = capacity;
+    }
+    memcpy(wal->unit + wal->unitUsed, payload->data, payload->len);
+    wal->unitUsed += payload->len;
+    wal->unitStocks++;
+    return true;
+}
+
+static bool wal_append(Wal* wal, WalRecordType type, const WalEncoder* payload) {
+    if (!wal) return false;
+    
+    pthread_mutex_lock(&wal->lock);
+    bool ok;
+    if (wal->unitDepth > 0 && (type == REC_DEQUEUE || type == REC_UPDATE_STOCK)) {
+        ok = unit_add_locked(wal, type, payload);
+    } else {
+        ok = wal_append_locked(wal, type, payload->data, payload->len);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return ok;
+}
+
+void wal_begin_process(Wal* wal) {
+    if (!wal) return;
+    pthread_mutex_lock(&wal->lock);
+    if (wal->unitDepth++ == 0) {
+        wal->unitUsed = WAL_PROCESS_HEADER;
+        wal->unitDequeues = wal->unitStocks = 0;
+    }
+    pthread_mutex_unlock(&wal->lock);
+}
+
+bool wal_commit_process(Wal* wal) {
+    if (!wal) return false;
+    pthread_mutex_lock(&wal->lock);
+    bool ok = true;
+    if (wal->unitDepth > 0 && --wal->unitDepth == 0) ok = unit_flush_locked(wal);
+    pthread_mutex_unlock(&wal->lock);
+    return ok;
+}
+
+uint64_t wal_last_lsn(Wal* wal) {
+    if (!wal) return 0;
+    pthread_mutex_lock(&wal->lock);
+    uint64_t lsn = wal->lastLsn;
+    pthread_mutex_unlock(&wal->lock);
+    return lsn;
+}
+
+bool wal_flush(Wal* wal) {
+    if (!wal) return false;
+    pthread_mutex_lock(&wal->lock);
+    bool ok = wal_sync_locked(wal);
+    pthread_mutex_unlock(&wal->lock);
+    return ok;
+}
+
+bool wal_checkpoint(Wal* wal) {
+    if (!wal) return false;
+    pthread_mutex_lock(&wal->lock);
+    // Buffered records are already covered by the snapshot
+    wal->used = 0;
+    bool ok = ftruncate(wal->fd, WAL_HEADER_SIZE) == 0 &&
+              lseek(wal->fd, 0, SEEK_END) >= 0 &&
+              fsync(wal->fd) == 0;
+    wal->unsynced = 0;
+    pthread_mutex_unlock(&wal->lock);
+    return ok;
+}
+
+bool wal_log_put_product(Wal* wal, const Product* p) {
+    WalEncoder e = { .len = 0 };
+    put_i64(&e, p->id);
+    put_f64(&e, p->price);
+    put_i32(&e, p->supplierId);
+    put_i32(&e, p->stock);
+    put_str(&e, p->name, MAX_NAME_LEN);
+    put_str(&e, p->category, MAX_CATEGORY_LEN);
+    return wal_append(wal, REC_PUT_PRODUCT, &e);
+}
+
+bool wal_log_remove_product(Wal* wal, ProductId productId) {
+    WalEncoder e = { .len = 0 };
+    put_i64(&e, productId);
+    return wal_append(wal, REC_REMOVE_PRODUCT, &e);
+}
+
+bool wal_log_update_stock(Wal* wal, ProductId productId, int newStock) {
+    WalEncoder e = { .len = 0 };
+    put_i64(&e, productId);
+    put_i32(&e, newStock);
+    return wal_append(wal, REC_UPDATE_STOCK, &e);
+}
+
+bool wal_log_enqueue(Wal* wal, const Order* o) {
+    WalEncoder e = { .len = 0 };
+    put_i32(&e, o->id);
+    put_str(&e, o->customer, MAX_NAME_LEN);
+    put_i32(&e, o->numItems);
+    WalRecordType type = REC_ENQUEUE;
+    int i = 0;
+    bool ok = true;
+    do {
+        for (int n = 0; n < WAL_ORDER_ITEMS_PER_RECORD && i < o->numItems; n++, i++) {
+            put_i64(&e, o->items[i].productId);
+            put_i32(&e, o->items[i].quantity);
+        }
+        ok = wal_append(wal, type, &e) && ok;
+        type = REC_ENQUEUE_ITEMS;
+        e.len = 0;
+    } while (i < o->numItems);
+    return ok;
+}
+
+bool wal_log_dequeue(Wal* wal) {
+    WalEncoder e = { .len = 0 };
+    return wal_append(wal, REC_DEQUEUE, &e);
+}
+
+static void get_items(WalDecoder* d, WalPendingOrder* pending, int count) {
+    for (int i = 0; d->ok && i < count; i++) {
+        OrderItem* it = &pending->items[pending->filled++];
+        it->productId = get_i64(d);
+        it->quantity = get_i32(d);
+    }
+}
+
+// An order left incomplete by a crash mid-append was never queued, so a
+// new one simply replaces it
+static bool pending_begin(WalPendingOrder* pending, int numItems) {
+    if (numItems < 0) return false;
+    if (numItems > pending->capacity) {
+        OrderItem* items = (OrderItem*)realloc(pending->items, (size_t)numItems * sizeof(OrderItem));
+        if (!items) return false;
+        pending->items = items;
+        pending->capacity = numItems;
+    }
+    pending->order.numItems = numItems;
+    pending->order.items = pending->items;
+    pending->filled = 0;
+    pending->active = true;
+    return true;
+}
+
+// Enqueue the pending order once all of its items have been read
+static void pending_finish(WalPendingOrder* pending, OrdersQueue* oq) {
+    if (pending->filled < pending->order.numItems) return;
+    orders_enqueue(oq, pending->order);
+    pending->active = false;
+}
+
+static bool apply_record(WalRecordType type, WalDecoder* d, Inventory* inv, OrdersQueue* oq,
+                         WalPendingOrder* pending) {
+    switch (type) {
+        case REC_PUT_PRODUCT: {
+            Product p;
+            memset(&p, 0, sizeof(p));
+            p.id = get_i64(d);
+            p.price = get_f64(d);
+            p.supplierId = get_i32(d);
+            p.stock = get_i32(d);
+            get_str(d, p.name, MAX_NAME_LEN);
+            get_str(d, p.category, MAX_CATEGORY_LEN);
+            if (d->ok) inventory_add_product(inv, p);
+            break;
+        }
+        case REC_REMOVE_PRODUCT: {
+            ProductId id = get_i64(d);
+            if (d->ok) inventory_remove_product(inv, id);
+            break;
+        }
+        case REC_UPDATE_STOCK: {
+            ProductId id = get_i64(d);
+            int stock = get_i32(d);
+            if (d->ok) inventory_update_stock(inv, id, stock);
+            break;
+        }
+        case REC_ENQUEUE_SHORT:
+        case REC_ENQUEUE: {
+            Order* o = &pending->order;
+            memset(o, 0, sizeof(Order));
+            o->id = get_i32(d);
+            get_str(d, o->customer, MAX_NAME_LEN);
+            int numItems = type == REC_ENQUEUE ? get_i32(d) : get_u16(d);
+            if (!d->ok || !pending_begin(pending, numItems)) return false;
+            int count = numItems;
+            if (type == REC_ENQUEUE && count > WAL_ORDER_ITEMS_PER_RECORD) count = WAL_ORDER_ITEMS_PER_RECORD;
+            get_items(d, pending, count);
+            if (d->ok) pending_finish(pending, oq);
+            break;
+        }
+        case REC_ENQUEUE_ITEMS: {
+            // The head of this order is already in the snapshot
+            if (!pending->active) break;
+            int count = pending->order.numItems - pending->filled;
+            if (count > WAL_ORDER_ITEMS_PER_RECORD) count = WAL_ORDER_ITEMS_PER_RECORD;
+            get_items(d, pending, count);
+            if (d->ok) pending_finish(pending, oq);
+            break;
+        }
+        case REC_DEQUEUE:
+            orders_dequeue(oq, NULL);
+            break;
+        case REC_PROCESS: {
+            // Check the whole unit before applying any of it
+            int dequeues = get_i32(d);
+            int stocks = get_i32(d);
+            if (!d->ok || dequeues < 0 || stocks < 0 ||
+                (d->len - d->pos) / WAL_PROCESS_STOCK < (size_t)stocks) return false;
+            for (int i = 0; i < dequeues; i++) orders_dequeue(oq, NULL);
+            for (int i = 0; i < stocks; i++) {
+                ProductId id = get_i64(d);
+                int stock = get_i32(d);
+                inventory_update_stock(inv, id, stock);
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    return d->ok;
+}
+
+int wal_replay(Wal* wal, Inventory* inv, OrdersQueue* oq, uint64_t afterLsn) {
+    if (!wal) return 0;
+    
+    off_t end = lseek(wal->fd, 0, SEEK_END);
+    if (end < WAL_HEADER_SIZE) return 0;
+    size_t size = (size_t)end - WAL_HEADER_SIZE;
+    unsigned char* data = (unsigned char*)malloc(size + 1);
+    if (!data) return 0;
+    
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = pread(wal->fd, data + got, size - got, WAL_HEADER_SIZE + (off_t)got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    
+    int applied = 0;
+    size_t pos = 0;
+    uint64_t lastLsn = afterLsn;
+    WalPendingOrder pending;
+    memset(&pending, 0, sizeof(pending));
+    while (pos + WAL_RECORD_HEADER <= got) {
+        uint32_t len, sum;
+        uint64_t lsn;
+        memcpy(&len, data + pos, 4);
+        memcpy(&sum, data + pos + 4, 4);
+        memcpy(&lsn, data + pos + 8, 8);
+        if (got - pos - WAL_RECORD_HEADER < len) break;
+        if (record_checksum(WAL_CHECKSUM_SEED, data + pos + 8, WAL_RECORD_HEADER - 8 + len) != sum) break;
+        
+        // Records already folded into the snapshot are skipped
+        if (lsn > afterLsn) {
+            WalDecoder d = { data + pos + WAL_RECORD_HEADER, len, 0, true };
+            if (!apply_record((WalRecordType)data[pos + 16], &d, inv, oq, &pending)) break;
+            applied++;
+        }
+        if (lsn > lastLsn) lastLsn = lsn;
+        pos += WAL_RECORD_HEADER + len;
+    }
+    free(data);
+    free(pending.items);
+    // Replayed changes were made by an earlier session and are durable;
+    // they are not this session's to undo
+    inventory_clear_undo(inv);
+    
+    // Drop a torn or corrupt tail so new records follow the last good one
+    if (pos < size) {
+        fprintf(stderr, "Warning: discarding %zu bytes of damaged write-ahead log\n", size - pos);
+        if (ftruncate(wal->fd, WAL_HEADER_SIZE + (off_t)pos) == 0) fsync(wal->fd);
+    }
+    lseek(wal->fd, 0, SEEK_END);
+    
+    pthread_mutex_lock(&wal->lock);
+    wal->lastLsn = lastLsn;
+    pthread_mutex_unlock(&wal->lock);
+    return applied;
+}
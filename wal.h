@@ -0,0 +1,62 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "common.h"
+
+// Write-ahead log of inventory and order mutations (<dir>/scms.wal).
+// Each record is a compact binary redo entry stamped with a log sequence
+// number (LSN); recovery replays records newer than the snapshot's LSN.
+#define WAL_FILE "scms.wal"
+
+// Group commit defaults: fsync after this many records or this long
+#define WAL_GROUP_RECORDS 64
+#define WAL_GROUP_WINDOW_MS 10
+
+typedef enum {
+    WAL_DURABILITY_NONE,    // Buffered writes, no fsync until checkpoint/close
+    WAL_DURABILITY_GROUP,   // fsync per group of records or per time window
+    WAL_DURABILITY_SYNC     // fsync before every logging call returns
+} WalDurability;
+
+typedef struct Wal Wal;
+
+// Forward declarations to keep this header free of module dependencies
+typedef struct Inventory Inventory;
+typedef struct OrdersQueue OrdersQueue;
+
+Wal* wal_open(const char* dir, WalDurability durability, int groupRecords, int groupWindowMs);
+// Flush, fsync and close the log
+void wal_close(Wal* wal);
+
+// Replay records with LSN > afterLsn into the containers, which must not
+// have the log attached yet. A torn tail is cut off. Returns records applied.
+int wal_replay(Wal* wal, Inventory* inv, OrdersQueue* oq, uint64_t afterLsn);
+
+// LSN of the last record appended (or replayed)
+uint64_t wal_last_lsn(Wal* wal);
+// Force buffered records to disk regardless of the group policy
+bool wal_flush(Wal* wal);
+// Truncate the log once a snapshot covering wal_last_lsn() is durable
+bool wal_checkpoint(Wal* wal);
+
+// Redo records
+bool wal_log_put_product(Wal* wal, const Product* p);
+bool wal_log_remove_product(Wal* wal, ProductId productId);
+bool wal_log_update_stock(Wal* wal, ProductId productId, int newStock);
+bool wal_log_enqueue(Wal* wal, const Order* o);
+// The head of the order queue was consumed (processed or failed)
+bool wal_log_dequeue(Wal* wal);
+
+// Processing units: between begin and commit, dequeue and stock records
+// are held back and then logged as a single record, so recovery never sees
+// an order consumed without its stock deductions or the reverse. Units
+// nest; only the outermost commit writes. Only the queue consumer opens
+// units, and nothing else may log stock changes to this log meanwhile.
+void wal_begin_process(Wal* wal);
+bool wal_commit_process(Wal* wal);
+
+bool wal_parse_durability(const char* name, WalDurability* out);
+
+#endif // WAL_H